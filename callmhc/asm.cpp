@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include "CommandLines.h"
+#include "Assembly.h"
+#include "Overlaps.h"
+#include "htab.h"
+#include "minimap.h"
+#include "kthread.h"
+#include "callmhc.h"
+#include "pipeline.h"
+
+/*************************
+ * Assembly with hifiasm *
+ *************************/
+
+int cm_assemble(const cm_seqs_t *reads, const char *prefix, int n_threads, int bf_shift, int max_cov, cm_seqs_t *utg)
+{
+	ha_mem_reads_t mr;
+	std::vector<int> len;
+	int64_t i;
+	int ret;
+	char name[32];
+
+	mr.n = reads->name.size();
+	if (mr.n == 0) return -1;
+	mr.name = (char**)malloc(mr.n * sizeof(char*));
+	mr.seq = (char**)malloc(mr.n * sizeof(char*));
+	len.resize(mr.n);
+	for (i = 0; i < mr.n; ++i) {
+		mr.name[i] = (char*)reads->name[i].c_str();
+		mr.seq[i] = (char*)reads->seq[i].c_str();
+		len[i] = reads->seq[i].size();
+	}
+	mr.len = len.data();
+
+	yak_reset_realtime();
+	init_opt(&asm_opt);
+	asm_opt.thread_num = n_threads > 0? n_threads : 1;
+	if (bf_shift >= 0) asm_opt.bf_shift = bf_shift; // otherwise fitted to the reads
+	asm_opt.max_cov = max_cov;
+	asm_opt.output_file_name = (char*)prefix;
+	asm_opt.mem_reads = &mr;
+	asm_opt.flag |= HA_F_KEEP_R_UTG | HA_F_TARGETED;
+	asm_opt.skip_gfa = (char*)"noseq,p_utg,p_ctg,a_ctg"; // only r_utg.gfa is kept on disk
+	ret = ha_assemble();
+	destory_opt(&asm_opt);
+	free(mr.name); free(mr.seq);
+	if (ret != 0 || ha_r_utg == 0) return -1;
+
+	for (i = 0; i < (int64_t)ha_r_utg->u.n; ++i) { // named and filtered as gfa2fa on the r_utg GFA
+		ma_utg_t *p = &ha_r_utg->u.a[i];
+		if (p->m == 0 || p->s == 0) continue;
+		sprintf(name, "utg%.6d%c", (int)i + 1, "lc"[p->circ]);
+		utg->name.push_back(name);
+		utg->seq.push_back(std::string(p->s, p->len));
+	}
+	ma_ug_destroy(ha_r_utg);
+	ha_r_utg = 0;
+	return 0;
+}
+
+/*************************
+ * Remap with minimap2   *
+ *************************/
+
+typedef struct {
+	const mm_idx_t *mi;
+	const mm_mapopt_t *mopt;
+	const cm_seqs_t *utg;
+	const char *ctg;
+	mm_tbuf_t **buf;
+	std::vector<std::vector<cm_aln_t> > out; // in minimap2's output order for each unitig
+	std::vector<std::vector<mm_reg1_t> > reg; // the matching hits, without the CIGAR
+} remap_shared_t;
+
+static void cm_revcomp(const char *s, int64_t l, std::string &out)
+{
+	int64_t i;
+	out.resize(l);
+	for (i = 0; i < l; ++i) {
+		int c = s[l - 1 - i];
+		switch (c) {
+			case 'A': case 'a': c = 'T'; break;
+			case 'C': case 'c': c = 'G'; break;
+			case 'G': case 'g': c = 'C'; break;
+			case 'T': case 't': c = 'A'; break;
+			default: c = 'N';
+		}
+		out[i] = c;
+	}
+}
+
+static void cm_reg2aln(const char *qname, const std::string &qseq, const char *ctg, const mm_reg1_t *r, int is_sup, cm_aln_t *a) // as mm_write_sam3()
+{
+	int64_t qlen = qseq.size(), clip[2];
+	uint32_t k;
+	char buf[32];
+	cm_cigar1_t c;
+
+	a->name = qname;
+	a->name += '@';
+	a->name += ctg;
+	snprintf(buf, sizeof(buf), ":%lld", (long long)r->rs + 1);
+	a->name += buf;
+	a->pos = r->rs;
+	a->mq = r->mapq;
+	a->cigar.clear();
+	clip[0] = r->rev? qlen - r->qe : r->qs;
+	clip[1] = r->rev? r->qs : qlen - r->qe;
+	c.op = is_sup? 'H' : 'S';
+	if (clip[0]) c.len = clip[0], a->cigar.push_back(c);
+	for (k = 0; r->p && k < r->p->n_cigar; ++k) {
+		c.op = "MIDNSHP=XB"[r->p->cigar[k] & 0xf];
+		c.len = r->p->cigar[k] >> 4;
+		if (strchr("ISDMXNHP", c.op)) a->cigar.push_back(c);
+	}
+	c.op = is_sup? 'H' : 'S';
+	if (clip[1]) c.len = clip[1], a->cigar.push_back(c);
+	if (is_sup) {
+		if (r->rev) cm_revcomp(qseq.c_str() + r->qs, r->qe - r->qs, a->seq);
+		else a->seq.assign(qseq, r->qs, r->qe - r->qs);
+	} else {
+		if (r->rev) cm_revcomp(qseq.c_str(), qlen, a->seq);
+		else a->seq = qseq;
+	}
+}
+
+static void remap_worker(void *data, long i, int tid)
+{
+	remap_shared_t *s = (remap_shared_t*)data;
+	const std::string &seq = s->utg->seq[i];
+	mm_reg1_t *reg;
+	int j, n_reg;
+
+	reg = mm_map(s->mi, seq.size(), seq.c_str(), &n_reg, s->buf[tid], s->mopt, s->utg->name[i].c_str());
+	for (j = 0; j < n_reg; ++j) {
+		mm_reg1_t *r = &reg[j];
+		if (r->parent == r->id && r->p) { // secondary alignments are skipped by cm_load_alignments() anyway
+			cm_aln_t a;
+			cm_reg2aln(s->utg->name[i].c_str(), seq, s->ctg, r, !r->sam_pri, &a);
+			s->out[i].push_back(a);
+			s->reg[i].push_back(*r);
+			s->reg[i].back().p = 0;
+		}
+		free(r->p);
+	}
+	free(reg);
+}
+
+typedef struct {
+	int64_t pos;
+	int rev;
+	int32_t i, j;
+} cm_remap_key_t;
+
+static bool cm_remap_key_lt(const cm_remap_key_t &x, const cm_remap_key_t &y)
+{
+	return x.pos < y.pos || (x.pos == y.pos && x.rev < y.rev);
+}
+
+static mm_idx_t *cm_remap_idx(const std::string &ref, const char *ctg, const mm_idxopt_t *iopt, const char *fn_idx)
+{
+	const char *seq = ref.c_str();
+	mm_idx_t *mi = 0;
+	FILE *fp;
+
+	if (fn_idx && mm_idx_is_idx(fn_idx) > 0) { // prebuilt; mapped read-only and shared with other processes
+		if ((fp = fopen(fn_idx, "rb")) != 0) {
+			mi = mm_idx_load(fp);
+			fclose(fp);
+		}
+		if (mi == 0) {
+			fprintf(stderr, "[E::%s] failed to load the minimap2 index '%s'\n", __func__, fn_idx);
+			return 0;
+		}
+		if (mi->n_seq != 1 || mi->seq[0].name == 0 || strcmp(mi->seq[0].name, ctg) != 0 || mi->seq[0].len != ref.size()
+			|| mi->k != iopt->k || mi->w != iopt->w || (mi->flag & MM_I_HPC) != (iopt->flag & MM_I_HPC))
+		{
+			fprintf(stderr, "[E::%s] '%s' is not an asm10 index of %s alone in the reference\n", __func__, fn_idx, ctg);
+			mm_idx_destroy(mi);
+			return 0;
+		}
+		if (cm_verbose >= 3)
+			fprintf(stderr, "[M::%s] loaded the index of %s from '%s'%s\n", __func__, ctg, fn_idx, mi->mm? " (memory-mapped)" : "");
+		return mi;
+	}
+	mi = mm_idx_str(iopt->w, iopt->k, iopt->flag & MM_I_HPC, iopt->bucket_bits, 1, &seq, &ctg);
+	if (mi && fn_idx) { // written under a temporary name first as other samples may look for it concurrently
+		std::string tmp = std::string(fn_idx) + ".tmp." + std::to_string((long)getpid());
+		int ret = -1;
+		if ((fp = fopen(tmp.c_str(), "wb")) != 0) {
+			ret = mm_idx_dump_mmap(fp, mi);
+			if (fclose(fp) != 0) ret = -1;
+		}
+		if (ret == 0 && rename(tmp.c_str(), fn_idx) == 0) {
+			if (cm_verbose >= 3) fprintf(stderr, "[M::%s] saved the index of %s to '%s'\n", __func__, ctg, fn_idx);
+		} else {
+			fprintf(stderr, "[W::%s] failed to save the index to '%s'\n", __func__, fn_idx);
+			unlink(tmp.c_str());
+		}
+	}
+	return mi;
+}
+
+int cm_remap(const std::string &ref, const cm_opt_t *opt, const cm_seqs_t *utg, const char *fn_idx, cm_aln_set_t *haps)
+{
+	mm_idxopt_t iopt;
+	mm_mapopt_t mopt;
+	remap_shared_t s;
+	std::vector<cm_remap_key_t> keys;
+	const char *name = opt->ctg.c_str();
+	int j, n_threads = opt->n_threads > 0? opt->n_threads : 1;
+	size_t i, k;
+
+	if (utg->name.empty()) return 0;
+	mm_set_opt(0, &iopt, &mopt);
+	mm_set_opt("asm10", &iopt, &mopt);
+	mopt.flag |= MM_F_OUT_SAM | MM_F_CIGAR;
+	if ((s.mi = cm_remap_idx(ref, name, &iopt, fn_idx)) == 0) return -1;
+	mm_mapopt_update(&mopt, s.mi);
+	s.mopt = &mopt, s.utg = utg, s.ctg = name;
+	s.out.resize(utg->name.size());
+	s.reg.resize(utg->name.size());
+	s.buf = (mm_tbuf_t**)calloc(n_threads, sizeof(mm_tbuf_t*));
+	for (j = 0; j < n_threads; ++j) s.buf[j] = mm_tbuf_init();
+	kt_for(n_threads, remap_worker, &s, utg->name.size());
+	for (j = 0; j < n_threads; ++j) mm_tbuf_destroy(s.buf[j]);
+	free(s.buf);
+	mm_idx_destroy((mm_idx_t*)s.mi);
+
+	for (i = 0; i < s.out.size(); ++i) { // filtered as cm_load_alignments() on `samtools view ctg:st-en`
+		for (k = 0; k < s.out[i].size(); ++k) {
+			const mm_reg1_t *r = &s.reg[i][k];
+			cm_remap_key_t t;
+			if (!r->sam_pri && r->mapq < opt->min_mapq) continue;
+			if (!(r->rs < opt->en && r->re > opt->st - 1)) continue;
+			t.pos = r->rs, t.rev = r->rev, t.i = i, t.j = k;
+			keys.push_back(t);
+		}
+	}
+	std::stable_sort(keys.begin(), keys.end(), cm_remap_key_lt); // as `samtools sort`
+	for (i = 0; i < keys.size(); ++i)
+		cm_aln_set_push(haps, s.out[keys[i].i][keys[i].j]);
+	if (cm_verbose >= 3)
+		fprintf(stderr, "[M::%s] %ld alignments of %ld unitigs overlap the region\n", __func__, (long)haps->a.size(), (long)utg->name.size());
+	return 0;
+}
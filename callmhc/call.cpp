@@ -0,0 +1,206 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ketopt.h"
+#include "callmhc.h"
+#include "event.h"
+
+static ko_longopt_t call_long_options[] = {
+	{ "reads",            ko_required_argument, 300 },
+	{ "info",             ko_no_argument,       301 },
+	{ "verbose",          ko_no_argument,       302 },
+	{ "max-mnp-distance", ko_required_argument, 303 },
+	{ "sample-name",      ko_required_argument, 304 },
+	{ "min-map-qual",     ko_required_argument, 305 },
+	{ "max-merge-dist",   ko_required_argument, 306 },
+	{ "max-alt-alleles",  ko_required_argument, 307 },
+	{ "maf",              ko_required_argument, 308 },
+	{ "rescue-win",       ko_required_argument, 309 },
+	{ "rescue-flank",     ko_required_argument, 310 },
+	{ 0, 0, 0 }
+};
+
+static int call_usage(FILE *fp, const cm_opt_t *opt)
+{
+	fprintf(fp, "Usage: callmhc call [options] -i <hap.bam> -R <ref.fa> -o <out.vcf>\n");
+	fprintf(fp, "Options:\n");
+	fprintf(fp, "  -i FILE                   input haplotype-to-ref bam file, required\n");
+	fprintf(fp, "  -o FILE                   output vcf, required\n");
+	fprintf(fp, "  -R FILE                   reference fasta holding the region's contig, required\n");
+	fprintf(fp, "  -L STR                    mhc region [%s:%lld-%lld]\n", opt->ctg.c_str(), (long long)opt->st, (long long)opt->en);
+	fprintf(fp, "  -t INT                    number of threads for rescuing gap regions [%d]\n", opt->n_threads);
+	fprintf(fp, "  --reads FILE              aligned reads in BAM format to rescue gap regions\n");
+	fprintf(fp, "  --rescue-win INT          max window size when rescuing gap regions [%lld]\n", (long long)opt->rescue_win);
+	fprintf(fp, "  --rescue-flank INT        fetch reads at least this many bases around each rescue window [%lld]\n", (long long)opt->rescue_flank);
+	fprintf(fp, "  --info                    output AC and SH to INFO\n");
+	fprintf(fp, "  --sample-name STR         sample name [hg002]\n");
+	fprintf(fp, "  --min-map-qual INT        min mapping quality of supplementary haplotype alignments [%d]\n", opt->min_mapq);
+	fprintf(fp, "  --max-mnp-distance INT    max mnp distance [%d]\n", opt->max_mnp_dist);
+	fprintf(fp, "  --max-merge-dist INT      max distance of adjacent variants to be merged [%d]\n", opt->max_merge_dist);
+	fprintf(fp, "  --max-alt-alleles INT     max alternative alleles [%d]\n", opt->max_alt_alleles);
+	fprintf(fp, "  --maf FLOAT               min alleles' fraction [%g]\n", opt->maf);
+	fprintf(fp, "  --verbose                 show warning messages during calling\n");
+	return fp == stdout? 0 : 1;
+}
+
+static void write_vcf_header(FILE *fp, const cm_opt_t *opt, int64_t ctg_len, const char *sample, int output_info)
+{
+	char date[16];
+	time_t t = time(0);
+	strftime(date, sizeof(date), "%Y-%m-%d", localtime(&t));
+	fprintf(fp, "##fileformat=VCFv4.2\n");
+	fprintf(fp, "##fileDate=%s\n", date);
+	fprintf(fp, "##source=callmhc %s\n", CM_VERSION);
+	fprintf(fp, "##CL=%s\n", cm_cmdline);
+	fprintf(fp, "##contig=<ID=%s,length=%lld,assembly=hg38,species=\"Homo sapiens\">\n", opt->ctg.c_str(), (long long)ctg_len);
+	if (output_info) {
+		fprintf(fp, "##INFO=<ID=AC,Number=A,Type=Integer,Description=\"Allele count observed in haplotype set\">\n");
+		fprintf(fp, "##INFO=<ID=SH,Number=.,Type=String,Description=\"haplotypes support alternative alleles\">\n");
+	}
+	fprintf(fp, "##FORMAT=<ID=GT,Number=1,Type=String,Description=\"Genotype\">\n");
+	fprintf(fp, "#CHROM\tPOS\tID\tREF\tALT\tQUAL\tFILTER\tINFO\tFORMAT\t%s\n", sample);
+}
+
+static void write_vcf_record(FILE *fp, const cm_opt_t *opt, const cm_var_t *v, int output_info)
+{
+	size_t i;
+	fprintf(fp, "%s\t%lld\t.\t%s\t", opt->ctg.c_str(), (long long)v->start + 1, v->ref.c_str());
+	for (i = 0; i < v->alt.size(); ++i)
+		fprintf(fp, "%s%s", i? "," : "", v->alt[i].c_str());
+	fprintf(fp, "\t.\t%s\t", v->filter.c_str());
+	if (output_info) {
+		fputs("AC=", fp);
+		for (i = 0; i < v->ac.size(); ++i)
+			fprintf(fp, "%s%d", i? "," : "", v->ac[i]);
+		fputs(";SH=", fp);
+		for (i = 0; i < v->sh.size(); ++i)
+			fprintf(fp, "%s%s", i? "," : "", v->sh[i].c_str());
+	} else fputc('.', fp);
+	fprintf(fp, "\tGT\t%s\n", v->gt.c_str());
+}
+
+static int write_vcf(const char *fn, const cm_callset_t &vcs, const cm_opt_t *opt, int64_t ctg_len, const char *sample, int output_info)
+{
+	cm_callset_t::const_iterator it;
+	FILE *fp;
+	if ((fp = fopen(fn, "w")) == 0) return -1;
+	write_vcf_header(fp, opt, ctg_len, sample, output_info);
+	for (it = vcs.begin(); it != vcs.end(); ++it) {
+		const cm_var_t *v = &it->second;
+		if (v->start + 1 < opt->st || v->start >= opt->en) continue; // vc not in MHC region
+		if (v->filter == ".") continue;
+		write_vcf_record(fp, opt, v, output_info);
+	}
+	return fclose(fp) == 0? 0 : -1;
+}
+
+static int write_bed(const char *fn, const std::vector<cm_region_t> &regs)
+{
+	FILE *fp;
+	size_t i;
+	if ((fp = fopen(fn, "w")) == 0) return -1;
+	for (i = 0; i < regs.size(); ++i)
+		fprintf(fp, "%s\t%lld\t%lld\t%d\n", regs[i].ctg.c_str(), (long long)regs[i].start, (long long)regs[i].stop, regs[i].dep);
+	return fclose(fp) == 0? 0 : -1;
+}
+
+int cm_call_haps(const cm_opt_t *opt, const std::string &ref, cm_aln_set_t &haps, const char *fn_reads, const char *fn_vcf, const char *sample, int output_info)
+{
+	cm_pos2var_t pos2var;
+	cm_hapcov_t hap_cov;
+	std::vector<cm_cluster_t> clusters;
+	std::vector<cm_region_t> lt2;
+	cm_callset_t merged, rescued;
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] build event map for %ld haplotype alignments\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9), (long)haps.a.size());
+	cm_build_event_map(&haps, ref, opt->max_mnp_dist, pos2var, &hap_cov);
+	if (opt->verbose) cm_stat_variants(pos2var);
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] cluster adjacent variants\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9));
+	cm_cluster_adjacent_variants(pos2var, opt->max_merge_dist, clusters);
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] merge variants and genotyping\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9));
+	cm_merge_and_genotype(ref, clusters, &hap_cov, haps, opt, 0.0, merged);
+
+	if (fn_reads) { // rescue variants in regions where assembly failed or mapping failed
+		std::string fn_bed = fn_vcf;
+		if (fn_bed.size() >= 4 && fn_bed.compare(fn_bed.size() - 4, 4, ".vcf") == 0)
+			fn_bed.resize(fn_bed.size() - 4);
+		fn_bed += ".hap_lt2.bed";
+		cm_hap_lt2_regions(&hap_cov, opt->ctg, opt->st, opt->en, lt2);
+		if (write_bed(fn_bed.c_str(), lt2) < 0) {
+			fprintf(stderr, "[E::%s] failed to write '%s'\n", __func__, fn_bed.c_str());
+			return -1;
+		}
+		if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] rescue variants in %ld poorly-assembled regions\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9), (long)lt2.size());
+		if (cm_rescue_regions(fn_reads, ref, opt, lt2, rescued) < 0) {
+			fprintf(stderr, "[E::%s] failed to read alignments from '%s'\n", __func__, fn_reads);
+			return -1;
+		}
+	}
+	cm_merge_callset(merged, rescued, lt2);
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] write vcf file\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9));
+	if (write_vcf(fn_vcf, merged, opt, ref.size(), sample, output_info) < 0) {
+		fprintf(stderr, "[E::%s] failed to write '%s'\n", __func__, fn_vcf);
+		return -1;
+	}
+	return 0;
+}
+
+int main_call(int argc, char *argv[])
+{
+	ketopt_t o = KETOPT_INIT;
+	cm_opt_t opt;
+	const char *fn_hap = 0, *fn_vcf = 0, *fn_ref = 0, *fn_reads = 0, *sample = "hg002";
+	std::string reg, ref;
+	int c, output_info = 0;
+	cm_aln_set_t haps;
+
+	cm_opt_init(&opt);
+	reg = "chr6:28510020-33480577";
+	while ((c = ketopt(&o, argc, argv, 1, "i:o:R:L:r:s:t:vh", call_long_options)) >= 0) {
+		if (c == 'i') fn_hap = o.arg;
+		else if (c == 'o') fn_vcf = o.arg;
+		else if (c == 'R') fn_ref = o.arg;
+		else if (c == 'L') reg = o.arg;
+		else if (c == 'r' || c == 300) fn_reads = o.arg;
+		else if (c == 301) output_info = 1;
+		else if (c == 'v' || c == 302) opt.verbose = 1;
+		else if (c == 303) opt.max_mnp_dist = atoi(o.arg);
+		else if (c == 's' || c == 304) sample = o.arg;
+		else if (c == 305) opt.min_mapq = atoi(o.arg);
+		else if (c == 306) opt.max_merge_dist = atoi(o.arg);
+		else if (c == 307) opt.max_alt_alleles = atoi(o.arg);
+		else if (c == 308) opt.maf = atof(o.arg);
+		else if (c == 't') opt.n_threads = atoi(o.arg);
+		else if (c == 309) opt.rescue_win = atoll(o.arg);
+		else if (c == 310) opt.rescue_flank = atoll(o.arg);
+		else if (c == 'h') return call_usage(stdout, &opt);
+		else {
+			fprintf(stderr, "[E::%s] unknown option or missing argument\n", __func__);
+			return 1;
+		}
+	}
+	if (fn_hap == 0 || fn_vcf == 0 || fn_ref == 0) return call_usage(stderr, &opt);
+	if (cm_parse_region(reg.c_str(), opt.ctg, &opt.st, &opt.en) < 0) {
+		fprintf(stderr, "[E::%s] failed to parse reg_start and reg_stop from region string '%s'\n", __func__, reg.c_str());
+		return 1;
+	}
+	if (opt.st > opt.en) {
+		fprintf(stderr, "[E::%s] region start > region stop\n", __func__);
+		return 1;
+	}
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] load input data\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9));
+	if (cm_load_ref(fn_ref, opt.ctg.c_str(), ref) < 0) {
+		fprintf(stderr, "[E::%s] parse %s sequence from file %s failed\n", __func__, opt.ctg.c_str(), fn_ref);
+		return 1;
+	}
+	if (cm_load_alignments(fn_hap, reg.c_str(), opt.min_mapq, &haps) < 0) {
+		fprintf(stderr, "[E::%s] failed to read alignments from '%s'\n", __func__, fn_hap);
+		return 1;
+	}
+
+	return cm_call_haps(&opt, ref, haps, fn_reads, fn_vcf, sample, output_info) < 0? 1 : 0;
+}
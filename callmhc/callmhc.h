@@ -0,0 +1,18 @@
+#ifndef __CALLMHC_H__
+#define __CALLMHC_H__
+
+#define CM_VERSION "1.0.0"
+
+extern int cm_verbose;
+extern char *cm_cmdline;
+
+void cm_reset_realtime(void);
+double cm_realtime(void);
+double cm_cputime(void);
+double cm_peakrss_in_gb(void);
+void cm_fatal(const char *msg);
+
+int main_call(int argc, char *argv[]);
+int main_run(int argc, char *argv[]);
+
+#endif
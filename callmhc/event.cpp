@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <unistd.h>
+#include <set>
+#include <algorithm>
+#include "htslib/sam.h"
+#include "htslib/faidx.h"
+#include "kseq.h"
+#include "callmhc.h"
+#include "event.h"
+
+KSEQ_INIT(gzFile, gzread)
+
+void cm_opt_init(cm_opt_t *opt)
+{
+	opt->st = 28510020, opt->en = 33480577;
+	opt->ctg = "chr6";
+	opt->max_mnp_dist = 1;
+	opt->max_merge_dist = 1;
+	opt->max_alt_alleles = 2;
+	opt->min_mapq = 10;
+	opt->verbose = 0;
+	opt->n_threads = 1;
+	opt->rescue_win = 200000;
+	opt->rescue_flank = 1000;
+	opt->maf = 0.4;
+}
+
+int cm_parse_region(const char *str, std::string &ctg, int64_t *st, int64_t *en)
+{
+	const char *p, *q;
+	char *r;
+	p = strrchr(str, ':');
+	if (p == 0 || p == str) return -1;
+	for (q = str; q < p; ++q)
+		if (*q == ' ' || *q == '\t' || *q == '\n') return -1;
+	if (p[1] < '0' || p[1] > '9') return -1;
+	*st = strtoll(p + 1, &r, 10);
+	if (*r != '-' || r[1] < '0' || r[1] > '9') return -1;
+	*en = strtoll(r + 1, &r, 10);
+	if (*r != 0) return -1;
+	ctg.assign(str, p - str);
+	return 0;
+}
+
+/*********************
+ * Input and helpers *
+ *********************/
+
+// substr() with Perl's out-of-range behaviour: an empty string instead of an exception
+static inline std::string cm_substr(const std::string &s, int64_t off, int64_t len)
+{
+	if (off < 0 || off >= (int64_t)s.size() || len <= 0) return std::string();
+	return s.substr(off, len);
+}
+
+static inline std::string cm_substr(const std::string &s, int64_t off)
+{
+	if (off < 0 || off >= (int64_t)s.size()) return std::string();
+	return s.substr(off);
+}
+
+static inline int cm_is_acgt(const std::string &s) // /^[ACGT]+$/
+{
+	size_t i;
+	if (s.empty()) return 0;
+	for (i = 0; i < s.size(); ++i)
+		if (s[i] != 'A' && s[i] != 'C' && s[i] != 'G' && s[i] != 'T') return 0;
+	return 1;
+}
+
+static inline int cm_is_acgt1(const std::string &s) // /^[ACGT]$/
+{
+	return s.size() == 1 && cm_is_acgt(s);
+}
+
+int cm_load_ref(const char *fn, const char *ctg, std::string &seq)
+{
+	gzFile fp;
+	kseq_t *ks;
+	faidx_t *fai;
+	seq.clear();
+	if (access((std::string(fn) + ".fai").c_str(), R_OK) == 0 && (fai = fai_load3(fn, 0, 0, 0)) != 0) { // indexed: fetch the contig without scanning the whole genome
+		hts_pos_t len;
+		char *s = faidx_has_seq(fai, ctg)? faidx_fetch_seq64(fai, ctg, 0, HTS_POS_MAX, &len) : 0;
+		if (s) seq.assign(s, len);
+		free(s);
+		fai_destroy(fai);
+		return seq.empty()? -1 : 0;
+	}
+	if ((fp = gzopen(fn, "r")) == 0) return -1;
+	ks = kseq_init(fp);
+	while (kseq_read(ks) >= 0) // the script concatenates every record named exactly $ctg
+		if (strcmp(ks->name.s, ctg) == 0 && ks->comment.l == 0)
+			seq.append(ks->seq.s, ks->seq.l);
+	kseq_destroy(ks);
+	gzclose(fp);
+	return seq.empty()? -1 : 0;
+}
+
+static void cm_bam2aln(const sam_hdr_t *h, const bam1_t *b, cm_aln_t *a)
+{
+	const uint32_t *cigar = bam_get_cigar(b);
+	const uint8_t *s = bam_get_seq(b);
+	char buf[32];
+	uint32_t i;
+	a->name = bam_get_qname(b);
+	a->name += '@';
+	a->name += b->core.tid >= 0? sam_hdr_tid2name(h, b->core.tid) : "*";
+	snprintf(buf, sizeof(buf), ":%lld", (long long)b->core.pos + 1);
+	a->name += buf;
+	a->pos = b->core.pos;
+	a->mq = b->core.qual;
+	a->cigar.clear();
+	for (i = 0; i < b->core.n_cigar; ++i) {
+		cm_cigar1_t c;
+		c.op = bam_cigar_opchr(cigar[i]);
+		c.len = bam_cigar_oplen(cigar[i]);
+		if (strchr("ISDMXNHP", c.op) == 0) continue;
+		a->cigar.push_back(c);
+	}
+	if (b->core.l_qseq == 0) {
+		a->seq = "*";
+	} else {
+		a->seq.resize(b->core.l_qseq);
+		for (i = 0; i < (uint32_t)b->core.l_qseq; ++i)
+			a->seq[i] = seq_nt16_str[bam_seqi(s, i)];
+	}
+}
+
+struct cm_bam_s {
+	samFile *fp;
+	sam_hdr_t *h;
+	hts_idx_t *idx;
+	bam1_t *b;
+};
+
+cm_bam_t *cm_bam_open(const char *fn)
+{
+	cm_bam_t *b;
+	b = (cm_bam_t*)calloc(1, sizeof(cm_bam_t));
+	if ((b->fp = sam_open(fn, "r")) == 0) goto fail;
+	if ((b->h = sam_hdr_read(b->fp)) == 0) goto fail;
+	if ((b->idx = sam_index_load(b->fp, fn)) == 0) {
+		fprintf(stderr, "[E::%s] failed to load the index of '%s'\n", __func__, fn);
+		goto fail;
+	}
+	b->b = bam_init1();
+	return b;
+fail:
+	cm_bam_close(b);
+	return 0;
+}
+
+void cm_bam_close(cm_bam_t *b)
+{
+	if (b == 0) return;
+	if (b->b) bam_destroy1(b->b);
+	if (b->idx) hts_idx_destroy(b->idx);
+	if (b->h) sam_hdr_destroy(b->h);
+	if (b->fp) sam_close(b->fp);
+	free(b);
+}
+
+void cm_aln_set_push(cm_aln_set_t *as, const cm_aln_t &a)
+{
+	std::unordered_map<std::string, int32_t>::iterator it = as->name2id.find(a.name);
+	if (it != as->name2id.end()) { // same key: the later record wins
+		as->a[it->second] = a;
+	} else {
+		as->name2id[a.name] = as->a.size();
+		as->a.push_back(a);
+	}
+}
+
+static void cm_aln_set_add(cm_aln_set_t *as, const sam_hdr_t *h, const bam1_t *b, int min_mapq)
+{
+	cm_aln_t a;
+	if (b->core.flag & BAM_FSECONDARY) return;
+	if ((b->core.flag & BAM_FSUPPLEMENTARY) && b->core.qual < min_mapq) return;
+	cm_bam2aln(h, b, &a);
+	cm_aln_set_push(as, a);
+}
+
+int cm_bam_load(cm_bam_t *b, const char *ctg, int64_t beg, int64_t end, int min_mapq, cm_aln_set_t *as) // [beg,end), 0-based
+{
+	hts_itr_t *itr;
+	int tid, ret;
+	if ((tid = sam_hdr_name2tid(b->h, ctg)) < 0) return -1;
+	if ((itr = sam_itr_queryi(b->idx, tid, beg, end)) == 0) return -1;
+	while ((ret = sam_itr_next(b->fp, itr, b->b)) >= 0)
+		cm_aln_set_add(as, b->h, b->b, min_mapq);
+	hts_itr_destroy(itr);
+	return ret < -1? -1 : 0;
+}
+
+int cm_load_alignments(const char *fn, const char *reg, int min_mapq, cm_aln_set_t *as)
+{
+	samFile *fp;
+	sam_hdr_t *h;
+	hts_idx_t *idx = 0;
+	hts_itr_t *itr = 0;
+	bam1_t *b;
+	int ret;
+
+	if ((fp = sam_open(fn, "r")) == 0) return -1;
+	if ((h = sam_hdr_read(fp)) == 0) {
+		sam_close(fp);
+		return -1;
+	}
+	if (reg && *reg) {
+		if ((idx = sam_index_load(fp, fn)) == 0 || (itr = sam_itr_querys(idx, h, reg)) == 0) {
+			fprintf(stderr, "[E::%s] failed to query region '%s' in file '%s'\n", __func__, reg, fn);
+			if (idx) hts_idx_destroy(idx);
+			sam_hdr_destroy(h);
+			sam_close(fp);
+			return -1;
+		}
+	}
+	b = bam_init1();
+	while ((ret = itr? sam_itr_next(fp, itr, b) : sam_read1(fp, h, b)) >= 0)
+		cm_aln_set_add(as, h, b, min_mapq);
+	bam_destroy1(b);
+	if (itr) hts_itr_destroy(itr);
+	if (idx) hts_idx_destroy(idx);
+	sam_hdr_destroy(h);
+	sam_close(fp);
+	return ret < -1? -1 : 0;
+}
+
+/*************
+ * Event map *
+ *************/
+
+static inline int cm_var_is_snp(const cm_var_t *v)
+{
+	size_t i;
+	if (v->alt.empty()) return 0;
+	for (i = 0; i < v->alt.size(); ++i)
+		if (v->ref.size() != 1 || v->alt[i].size() != 1) return 0;
+	return 1;
+}
+
+static inline int cm_var_is_simple_indel(const cm_var_t *v)
+{
+	const std::string *alt;
+	size_t i;
+	if (v->alt.size() != 1) return 0;
+	for (i = 0; i < v->alt.size(); ++i) // "Indel" only if no allele has the reference length
+		if (v->alt[i].size() == v->ref.size()) return 0;
+	alt = &v->alt[0];
+	if (v->ref.empty() || alt->empty() || v->ref[0] != (*alt)[0]) return 0;
+	return v->ref.size() == 1 || alt->size() == 1;
+}
+
+static inline int cm_var_is_simple_ins(const cm_var_t *v) { return cm_var_is_simple_indel(v) && v->ref.size() == 1; }
+static inline int cm_var_is_simple_del(const cm_var_t *v) { return cm_var_is_simple_indel(v) && v->alt[0].size() == 1; }
+
+/*
+ * Merge two events of one haplotype that start at the same position. vc1 is
+ * the event already in the map and is always a SNP when this succeeds. The
+ * script compared against $vc2->{$ref}, an undefined key, so the "same ref"
+ * branch never fires: the result takes vc2's ref and stop and vc1's alt.
+ */
+static int cm_make_block(const cm_var_t *vc1, const cm_var_t *vc2, cm_var_t *m)
+{
+	if (vc1->start != vc2->start) cm_fatal("can not merge two vc with diff start pos.");
+	if (vc1->alt.size() != 1) cm_fatal("vc1 must be biallelic.");
+	if (!cm_var_is_snp(vc1)) {
+		if ((cm_var_is_simple_ins(vc1) && cm_var_is_simple_del(vc2)) || (cm_var_is_simple_del(vc1) && cm_var_is_simple_ins(vc2)))
+			fprintf(stderr, "[ERROR] can not merge ins with del (or vice versa).");
+		return -1;
+	}
+	if (cm_var_is_snp(vc2)) cm_fatal("vc1 and vc2 are booth snps, which implies there's been some terrible bug in the cigar.");
+	*m = *vc1;
+	m->ref = vc2->ref;
+	m->stop = vc2->stop;
+	m->alt.clear();
+	if (m->ref != vc1->alt[0]) m->alt.push_back(vc1->alt[0]);
+	return 0;
+}
+
+static inline void cm_var_set(cm_var_t *v, int64_t start, int64_t stop, const std::string &ref, const std::string &alt, int32_t hap)
+{
+	v->start = start, v->stop = stop;
+	v->ref = ref;
+	v->alt.assign(1, alt);
+	v->hap = hap;
+	v->mixed = 0;
+}
+
+static void cm_process_cigar(const cm_aln_t *a, int32_t hap, const std::string &ref, int max_mnp_dist, std::map<int64_t, cm_var_t> &evt, cm_hapcov_t *cov)
+{
+	const std::string &seq = a->seq;
+	std::vector<cm_var_t> proposed;
+	std::vector<int64_t> mm;
+	int64_t ref_pos = a->pos, aln_pos = 0, i, k, n_ops = a->cigar.size();
+
+	if (ref_pos < 0) cm_fatal("ref pos is negative.");
+	for (i = 0; i < n_ops; ++i) {
+		char op = a->cigar[i].op;
+		int64_t len = a->cigar[i].len;
+		if (op == 'I') {
+			if (ref_pos > 0) {
+				int64_t ist = ref_pos - 1; // left aligned
+				std::string rb = cm_substr(ref, ist, 1);
+				// if the insertion isn't completely resolved in the haplotype, skip it
+				if (cm_is_acgt1(rb) && i != 0 && i != n_ops - 1) {
+					std::string ib = rb + cm_substr(seq, aln_pos, len);
+					if (cm_is_acgt(ib)) {
+						cm_var_t v;
+						cm_var_set(&v, ist, ist, rb, ib, hap);
+						proposed.push_back(v);
+					}
+				}
+			}
+			aln_pos += len;
+		} else if (op == 'S') {
+			aln_pos += len;
+		} else if (op == 'D') {
+			if (ref_pos > 0) {
+				int64_t dst = ref_pos - 1;
+				std::string db = cm_substr(ref, dst, len + 1), rb = cm_substr(ref, dst, 1);
+				if (cm_is_acgt1(rb) && cm_is_acgt(db)) {
+					cm_var_t v;
+					cm_var_set(&v, dst, dst + len, db, rb, hap);
+					proposed.push_back(v);
+				}
+			}
+			ref_pos += len;
+		} else if (op == 'M' || op == 'X') {
+			mm.clear();
+			for (k = 0; k < len; ++k) {
+				int64_t rp = ref_pos + k, ap = aln_pos + k;
+				if (rp < (int64_t)ref.size() && ap < (int64_t)seq.size()) {
+					char rb = ref[rp], ab = seq[ap];
+					if (rb != ab && strchr("ACGT", rb) && strchr("ACGT", ab)) mm.push_back(k);
+				}
+			}
+			cm_hapcov_add(cov, hap, ref_pos, ref_pos + len);
+			for (k = 0; k < (int64_t)mm.size();) {
+				int64_t st = mm[k], en = st;
+				cm_var_t v;
+				for (++k; k < (int64_t)mm.size() && mm[k] - en <= max_mnp_dist; ++k)
+					en = mm[k];
+				cm_var_set(&v, ref_pos + st, ref_pos + en, cm_substr(ref, ref_pos + st, en - st + 1), cm_substr(seq, aln_pos + st, en - st + 1), hap);
+				proposed.push_back(v);
+			}
+			ref_pos += len, aln_pos += len;
+		} // N, H and P are skipped without moving either coordinate
+	}
+
+	for (i = 0; i < (int64_t)proposed.size(); ++i) {
+		cm_var_t *vc = &proposed[i];
+		std::map<int64_t, cm_var_t>::iterator it = evt.find(vc->start);
+		if (it != evt.end()) {
+			cm_var_t m;
+			if (cm_make_block(&it->second, vc, &m) < 0) {
+				evt.erase(it);
+				continue;
+			}
+			if (!m.alt.empty()) it->second = m;
+		} else {
+			evt[vc->start] = *vc;
+		}
+	}
+}
+
+void cm_build_event_map(cm_aln_set_t *as, const std::string &ref, int max_mnp_dist, cm_pos2var_t &pos2var, cm_hapcov_t *cov)
+{
+	size_t i;
+	for (i = 0; i < as->a.size(); ++i) {
+		std::map<int64_t, cm_var_t> evt;
+		std::map<int64_t, cm_var_t>::iterator it;
+		cm_process_cigar(&as->a[i], i, ref, max_mnp_dist, evt, cov);
+		for (it = evt.begin(); it != evt.end(); ++it)
+			pos2var[it->first].push_back(it->second);
+	}
+	cm_hapcov_index(cov);
+}
+
+void cm_stat_variants(const cm_pos2var_t &pos2var)
+{
+	std::map<size_t, int64_t> stat;
+	std::map<size_t, int64_t>::iterator it;
+	cm_pos2var_t::const_iterator p;
+	fprintf(stderr, "[INFO] total candidate variants: %ld\n", (long)pos2var.size());
+	for (p = pos2var.begin(); p != pos2var.end(); ++p)
+		++stat[p->second.size()];
+	for (it = stat.begin(); it != stat.end(); ++it)
+		fprintf(stderr, "[INFO] variants covered by %ld haplotypes: %ld\n", (long)it->first, (long)it->second);
+}
+
+void cm_cluster_adjacent_variants(const cm_pos2var_t &pos2var, int max_merge_dist, std::vector<cm_cluster_t> &clusters)
+{
+	cm_pos2var_t::const_iterator p;
+	int64_t last_stop = -1;
+	for (p = pos2var.begin(); p != pos2var.end(); ++p) {
+		int64_t pos = p->first, stop = -1;
+		size_t i;
+		for (i = 0; i < p->second.size(); ++i)
+			if (p->second[i].stop > stop) stop = p->second[i].stop;
+		if (stop == -1) {
+			fprintf(stderr, "[ERROR] no variant at pos: %lld\n", (long long)pos);
+			exit(1);
+		}
+		if (!clusters.empty() && pos - last_stop <= max_merge_dist) { // merge adjacent variant
+			cm_cluster_t &last = clusters.back();
+			if (stop > last.stop) last.stop = stop;
+			last.vc.insert(last.vc.end(), p->second.begin(), p->second.end());
+			last.mixed = 1;
+			last_stop = last.stop;
+		} else {
+			cm_cluster_t c;
+			c.start = pos, c.stop = stop, c.mixed = 0;
+			c.vc = p->second;
+			clusters.push_back(c);
+			last_stop = stop;
+		}
+	}
+}
+
+/************************
+ * Merge and genotyping *
+ ************************/
+
+static void cm_set_sh(const cm_aln_set_t &as, const std::vector<int32_t> &haps, cm_var_t *v)
+{
+	size_t i;
+	v->sh.clear();
+	for (i = 0; i < haps.size(); ++i)
+		v->sh.push_back(as.a[haps[i]].name);
+	std::sort(v->sh.begin(), v->sh.end());
+}
+
+static void cm_simple_merge(cm_cluster_t *c, const cm_hapcov_t *cov, const cm_aln_set_t &as, cm_var_t *m)
+{
+	std::map<std::string, int> cnt;
+	std::map<std::string, int>::iterator it;
+	std::vector<int32_t> haps;
+	std::string ref;
+	int alt_haps = 0, diff;
+	size_t i, j;
+
+	for (i = 0; i < c->vc.size(); ++i) // the longest reference allele; they all start at the same base
+		if (c->vc[i].ref.size() > ref.size()) ref = c->vc[i].ref;
+	for (i = 0; i < c->vc.size(); ++i) {
+		cm_var_t *vc = &c->vc[i];
+		if (vc->start != c->start) cm_fatal("Bug: try to merge variants at difference pos using simple merge strategy.");
+		if (vc->ref != ref) {
+			std::string extra = cm_substr(ref, vc->ref.size());
+			vc->ref = ref;
+			vc->stop = vc->start + ref.size() - 1;
+			for (j = 0; j < vc->alt.size(); ++j)
+				vc->alt[j] += extra;
+		}
+		++cnt[vc->alt[0]];
+		++alt_haps;
+	}
+	*m = c->vc[0];
+	m->alt.clear();
+	m->ac.assign(1, 0);
+	for (it = cnt.begin(); it != cnt.end(); ++it)
+		m->alt.push_back(it->first), m->ac.push_back(it->second);
+	cm_hapcov_haps(cov, m->start, m->start, haps);
+	cm_set_sh(as, haps, m);
+	diff = (int)haps.size() - alt_haps;
+	if (diff < 0) cm_fatal("Bug: total haplotype depth < altnative haplotype depth.");
+	m->ac[0] = diff;
+}
+
+static std::string cm_parse_alt_allele(const cm_aln_t *a, int64_t start, int64_t stop)
+{
+	std::string alt;
+	int64_t ref_pos = a->pos, aln_pos = 0, i, n_ops = a->cigar.size();
+	if (ref_pos < 0) cm_fatal("ref pos is negative.");
+	if (start < ref_pos) return alt; // incomplete allele for merged var
+	for (i = 0; i < n_ops; ++i) {
+		char op = a->cigar[i].op;
+		int64_t len = a->cigar[i].len;
+		if (op == 'I') {
+			if (ref_pos >= start && ref_pos <= stop + 1)
+				alt += cm_substr(a->seq, aln_pos, len);
+			if (ref_pos > stop) break;
+			aln_pos += len;
+		} else if (op == 'S') {
+			aln_pos += len;
+		} else if (op == 'D') {
+			if (ref_pos > stop) break;
+			ref_pos += len;
+		} else if (op == 'M' || op == 'X') {
+			int64_t s, e;
+			if (ref_pos > stop) break;
+			if (ref_pos + len < start) {
+				ref_pos += len, aln_pos += len;
+				continue;
+			}
+			s = start - ref_pos, e = stop - ref_pos;
+			if (s < 0) s = 0;
+			if (e >= len) e = len - 1;
+			alt += cm_substr(a->seq, aln_pos + s, e - s + 1);
+			ref_pos += len, aln_pos += len;
+			if (ref_pos > stop + 1) break;
+		}
+	}
+	if (ref_pos < stop && i == n_ops) alt.clear();
+	return alt;
+}
+
+static void cm_complex_merge(cm_cluster_t *c, const std::string &refseq, const cm_hapcov_t *cov, const cm_aln_set_t &as, cm_var_t *m)
+{
+	int64_t ref_start = 300000000, ref_stop = -1, shift_len = 0, min_alt_len = 5000000, i;
+	std::set<int32_t> alt_hap;
+	std::set<int32_t>::iterator h;
+	std::vector<int32_t> all_hap;
+	int n_ref_hap = 0;
+	std::map<std::string, int> cnt;
+	std::map<std::string, int>::iterator it;
+	std::string ref;
+	size_t j;
+
+	if (!c->mixed) cm_fatal("Bug: try to merge simple variants using complex strategy.");
+	for (j = 0; j < c->vc.size(); ++j) {
+		if (c->vc[j].start < ref_start) ref_start = c->vc[j].start;
+		if (c->vc[j].stop > ref_stop) ref_stop = c->vc[j].stop;
+		alt_hap.insert(c->vc[j].hap);
+	}
+	ref = cm_substr(refseq, ref_start, ref_stop - ref_start + 1);
+	for (h = alt_hap.begin(); h != alt_hap.end();) {
+		std::string alt = cm_parse_alt_allele(&as.a[*h], ref_start, ref_stop);
+		if (alt.empty() || alt == ref) {
+			alt_hap.erase(h++);
+			continue;
+		}
+		++cnt[alt];
+		if ((int64_t)alt.size() < min_alt_len) min_alt_len = alt.size();
+		++h;
+	}
+	// left trim alleles (right shift). Like the script's `foreach (%alt_allele_count)`, this
+	// scans both the alleles and their counts, so it only shifts when no alt allele is left.
+	for (i = 0; i < ref_stop - ref_start + 1; ++i) {
+		std::string rb = cm_substr(ref, i, 1);
+		int right_shift = 1;
+		for (it = cnt.begin(); it != cnt.end() && right_shift; ++it) {
+			char buf[16];
+			snprintf(buf, sizeof(buf), "%d", it->second);
+			if (cm_substr(it->first, i, 1) != rb || cm_substr(buf, i, 1) != rb)
+				right_shift = 0;
+		}
+		if (!right_shift) break;
+		++shift_len;
+	}
+	if (shift_len > 0 && shift_len < min_alt_len) { // perform right shift
+		std::map<std::string, int> trimmed;
+		ref_start += shift_len;
+		ref = cm_substr(ref, shift_len);
+		for (it = cnt.begin(); it != cnt.end(); ++it)
+			trimmed[cm_substr(it->first, shift_len)] = it->second;
+		cnt.swap(trimmed);
+	}
+	// construct merged vc
+	*m = c->vc[0];
+	m->start = ref_start, m->stop = ref_stop;
+	m->ref = ref;
+	m->alt.clear();
+	cm_hapcov_haps(cov, ref_start, ref_stop, all_hap); // detect ref haplotype
+	for (j = 0; j < all_hap.size(); ++j)
+		if (alt_hap.find(all_hap[j]) == alt_hap.end())
+			++n_ref_hap;
+	m->ac.assign(1, n_ref_hap);
+	for (it = cnt.begin(); it != cnt.end(); ++it)
+		m->alt.push_back(it->first), m->ac.push_back(it->second);
+	cm_set_sh(as, all_hap, m);
+	m->mixed = 1;
+}
+
+static void cm_genotype(cm_var_t *vc, const cm_opt_t *opt, double maf)
+{
+	std::vector<int> good, hits, ac;
+	std::vector<std::string> alt;
+	char buf[32];
+	int64_t sum = 0;
+	size_t i;
+
+	for (i = 0; i < vc->ac.size(); ++i)
+		sum += vc->ac[i];
+	if (sum == 0) { // invalid merged vc is caused by cigar like: 3D3I
+		vc->gt = "./.", vc->filter = ".";
+		return;
+	}
+	for (i = 1; i < vc->ac.size(); ++i) // filter allele by maf
+		if ((double)vc->ac[i] / sum > maf) good.push_back(i);
+	if ((int)good.size() > opt->max_alt_alleles) {
+		vc->gt = "./.", vc->filter = ".";
+		return;
+	}
+	ac.push_back(vc->ac[0]);
+	for (i = 0; i < good.size(); ++i)
+		alt.push_back(vc->alt[good[i] - 1]), ac.push_back(vc->ac[good[i]]);
+	vc->alt.swap(alt);
+	vc->ac.swap(ac);
+
+	for (i = 0; i < vc->ac.size(); ++i)
+		if ((double)vc->ac[i] / sum > maf) hits.push_back(i);
+	if (hits.size() == 1) {
+		snprintf(buf, sizeof(buf), "%d/%d", hits[0], hits[0]);
+		vc->gt = buf;
+	} else if (hits.size() == 2) {
+		snprintf(buf, sizeof(buf), "%d/%d", hits[0], hits[1]);
+		vc->gt = buf;
+	} else {
+		if (opt->verbose) {
+			fprintf(stderr, "[WARN] Too many alternative alleles, failed to genotyping variants: (%s, %lld, %s, ", opt->ctg.c_str(), (long long)vc->start, vc->ref.c_str());
+			for (i = 0; i < vc->alt.size(); ++i)
+				fprintf(stderr, "%s%s", i? ";" : "", vc->alt[i].c_str());
+			fprintf(stderr, ").\n");
+		}
+		vc->gt = "./.";
+	}
+	vc->filter = vc->gt != "./." && vc->gt != "0/0"? "PASS" : ".";
+}
+
+void cm_merge_and_genotype(const std::string &ref, std::vector<cm_cluster_t> &clusters, const cm_hapcov_t *cov, const cm_aln_set_t &as,
+						   const cm_opt_t *opt, double maf, cm_callset_t &out)
+{
+	size_t i;
+	for (i = 0; i < clusters.size(); ++i) {
+		cm_var_t m;
+		if (clusters[i].mixed) cm_complex_merge(&clusters[i], ref, cov, as, &m);
+		else cm_simple_merge(&clusters[i], cov, as, &m);
+		cm_genotype(&m, opt, maf);
+		out[m.start] = m;
+	}
+}
+
+/***********************
+ * Rescue bookkeeping *
+ ***********************/
+
+void cm_hap_lt2_regions(const cm_hapcov_t *cov, const std::string &ctg, int64_t st, int64_t en, std::vector<cm_region_t> &regs)
+{
+	int64_t pos, next;
+	if (st > en) cm_fatal("region start > region stop.");
+	for (pos = st - 1; pos <= en; pos = next) { // st is 1-based; the scan keeps the script's inclusive end
+		cm_region_t r;
+		next = cm_hapcov_next_change(cov, pos);
+		r.ctg = ctg, r.start = pos, r.stop = next - 1 < en? next - 1 : en;
+		r.dep = cm_hapcov_depth(cov, pos);
+		if (r.dep < 2 && r.stop - r.start > 100) // filter small hom-del regions
+			regs.push_back(r);
+		next = r.stop + 1;
+	}
+}
+
+void cm_filter_to_regions(const cm_callset_t &in, const std::vector<cm_region_t> &regs, cm_callset_t &out)
+{
+	size_t i;
+	for (i = 0; i < regs.size(); ++i) {
+		cm_callset_t::const_iterator it = in.lower_bound(regs[i].start), end = in.upper_bound(regs[i].stop);
+		for (; it != end; ++it)
+			out[it->first] = it->second;
+	}
+}
+
+void cm_merge_callset(cm_callset_t &vcs, const cm_callset_t &rescued, const std::vector<cm_region_t> &regs)
+{
+	cm_callset_t::const_iterator it;
+	size_t i;
+	if (rescued.empty() || regs.empty()) return;
+	for (i = 0; i < regs.size(); ++i)
+		vcs.erase(vcs.lower_bound(regs[i].start), vcs.upper_bound(regs[i].stop));
+	for (it = rescued.begin(); it != rescued.end(); ++it)
+		vcs[it->first] = it->second;
+}
@@ -0,0 +1,98 @@
+#ifndef __CM_EVENT_H__
+#define __CM_EVENT_H__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include "hapcov.h"
+
+/*
+ * Event building and genotyping, ported from the Perl build_event_and_call.
+ * Positions are 0-based throughout; only the VCF writer converts to 1-based.
+ */
+
+typedef struct {
+	char op;     // one of ISDMXNHP; '=' and 'B' are dropped, as the Perl regex did
+	int64_t len;
+} cm_cigar1_t;
+
+typedef struct {
+	std::string name; // qname@chr:pos, the key used by the Perl script
+	int64_t pos;      // 0-based leftmost reference position
+	int mq;
+	std::vector<cm_cigar1_t> cigar;
+	std::string seq;  // "*" if the record has no sequence
+} cm_aln_t;
+
+typedef struct {
+	std::vector<cm_aln_t> a;
+	std::unordered_map<std::string, int32_t> name2id;
+} cm_aln_set_t;
+
+typedef struct {
+	int64_t start, stop;
+	std::string ref;
+	std::vector<std::string> alt;
+	int32_t hap; // index into cm_aln_set_t::a
+	int mixed;
+	std::vector<int> ac;          // INFO/AC; ac[0] is the reference count
+	std::vector<std::string> sh;  // INFO/SH
+	std::string gt, filter;
+} cm_var_t;
+
+typedef struct {
+	int64_t start, stop;
+	int mixed;
+	std::vector<cm_var_t> vc;
+} cm_cluster_t;
+
+typedef struct {
+	std::string ctg;
+	int64_t start, stop;
+	int dep;
+} cm_region_t;
+
+typedef std::map<int64_t, std::vector<cm_var_t> > cm_pos2var_t;
+typedef std::map<int64_t, cm_var_t> cm_callset_t;
+
+typedef struct {
+	std::string ctg;    // contig of the target region
+	int64_t st, en;     // region as written, i.e. 1-based inclusive
+	int max_mnp_dist;
+	int max_merge_dist;
+	int max_alt_alleles;
+	int min_mapq;
+	int verbose;
+	int n_threads;
+	int64_t rescue_win;   // max window size when rescuing hap<2 regions
+	int64_t rescue_flank; // reads are fetched from this many bases around a window
+	double maf;
+} cm_opt_t;
+
+void cm_opt_init(cm_opt_t *opt);
+int cm_parse_region(const char *str, std::string &ctg, int64_t *st, int64_t *en);
+
+struct cm_bam_s;
+typedef struct cm_bam_s cm_bam_t;
+
+int cm_load_ref(const char *fn, const char *ctg, std::string &seq);
+cm_bam_t *cm_bam_open(const char *fn);
+void cm_bam_close(cm_bam_t *b);
+int cm_bam_load(cm_bam_t *b, const char *ctg, int64_t beg, int64_t end, int min_mapq, cm_aln_set_t *as);
+int cm_load_alignments(const char *fn, const char *reg, int min_mapq, cm_aln_set_t *as);
+void cm_aln_set_push(cm_aln_set_t *as, const cm_aln_t &a);
+
+void cm_build_event_map(cm_aln_set_t *as, const std::string &ref, int max_mnp_dist, cm_pos2var_t &pos2var, cm_hapcov_t *cov);
+void cm_stat_variants(const cm_pos2var_t &pos2var);
+void cm_cluster_adjacent_variants(const cm_pos2var_t &pos2var, int max_merge_dist, std::vector<cm_cluster_t> &clusters);
+void cm_merge_and_genotype(const std::string &ref, std::vector<cm_cluster_t> &clusters, const cm_hapcov_t *cov, const cm_aln_set_t &as,
+						   const cm_opt_t *opt, double maf, cm_callset_t &out);
+void cm_hap_lt2_regions(const cm_hapcov_t *cov, const std::string &ctg, int64_t st, int64_t en, std::vector<cm_region_t> &regs);
+void cm_filter_to_regions(const cm_callset_t &in, const std::vector<cm_region_t> &regs, cm_callset_t &out);
+int cm_rescue_regions(const char *fn, const std::string &ref, const cm_opt_t *opt, const std::vector<cm_region_t> &regs, cm_callset_t &rescued);
+void cm_merge_callset(cm_callset_t &vcs, const cm_callset_t &rescued, const std::vector<cm_region_t> &regs);
+int cm_call_haps(const cm_opt_t *opt, const std::string &ref, cm_aln_set_t &haps, const char *fn_reads, const char *fn_vcf, const char *sample, int output_info);
+
+#endif
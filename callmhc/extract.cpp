@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+#include "htslib/sam.h"
+#include "htslib/thread_pool.h"
+#include "callmhc.h"
+#include "pipeline.h"
+
+/*
+ * Reads overlapping the region, collected the same way as `samtools fastq`
+ * in region mode: a primary record is taken when first seen and the longest
+ * supplementary of a read is only used if its primary is outside the region.
+ * Sequences are in the original read orientation.
+ */
+
+typedef struct {
+	int done;    // bit i set if readpart i has been taken from a primary record
+	int sup[3];  // index of the kept supplementary in the pending list, or -1
+} cm_seen_t;
+
+static inline int cm_readpart(const bam1_t *b)
+{
+	int f = b->core.flag & (BAM_FREAD1 | BAM_FREAD2);
+	return f == BAM_FREAD1? 1 : f == BAM_FREAD2? 2 : 0;
+}
+
+static void cm_bam2seq(const bam1_t *b, std::string &s)
+{
+	static const char comp[] = "=TGKCYSBAWRDMHVN";
+	const uint8_t *q = bam_get_seq(b);
+	int i, l = b->core.l_qseq;
+	s.resize(l);
+	if (b->core.flag & BAM_FREVERSE) {
+		for (i = 0; i < l; ++i)
+			s[l - 1 - i] = comp[bam_seqi(q, i)];
+	} else {
+		for (i = 0; i < l; ++i)
+			s[i] = seq_nt16_str[bam_seqi(q, i)];
+	}
+}
+
+static void cm_get_sample(const sam_hdr_t *h, std::string &sample) // SM of the last @RG line, as the script did
+{
+	kstring_t sm = { 0, 0, 0 };
+	int i, n_rg = sam_hdr_count_lines((sam_hdr_t*)h, "RG");
+	for (i = 0; i < n_rg; ++i)
+		if (sam_hdr_find_tag_pos((sam_hdr_t*)h, "RG", i, "SM", &sm) == 0)
+			sample = sm.s;
+	free(sm.s);
+}
+
+int cm_extract_reads(const char *fn, const char *reg, int n_threads, cm_seqs_t *reads, std::string &sample)
+{
+	samFile *fp;
+	sam_hdr_t *h = 0;
+	hts_idx_t *idx = 0;
+	hts_itr_t *itr = 0;
+	htsThreadPool p = { 0, 0 };
+	bam1_t *b;
+	std::unordered_map<std::string, cm_seen_t> seen;
+	std::vector<bam1_t*> pend;
+	int64_t n_aln = 0, n_dups = 0, n_sups = 0;
+	size_t i;
+	int ret = -1;
+	std::string s;
+
+	if ((fp = sam_open(fn, "r")) == 0) return -1;
+	if (n_threads > 1 && (p.pool = hts_tpool_init(n_threads)) != 0)
+		hts_set_opt(fp, HTS_OPT_THREAD_POOL, &p);
+	hts_set_opt(fp, CRAM_OPT_REQUIRED_FIELDS, SAM_QNAME | SAM_FLAG | SAM_RNAME | SAM_POS | SAM_CIGAR | SAM_SEQ);
+	if ((h = sam_hdr_read(fp)) == 0) goto end;
+	if ((idx = sam_index_load(fp, fn)) == 0 || (itr = sam_itr_querys(idx, h, reg)) == 0) {
+		fprintf(stderr, "[E::%s] failed to query region '%s' in file '%s'\n", __func__, reg, fn);
+		goto end;
+	}
+	cm_get_sample(h, sample);
+
+	b = bam_init1();
+	while ((ret = sam_itr_next(fp, itr, b)) >= 0) {
+		if ((b->core.flag & BAM_FSECONDARY) || b->core.l_qseq == 0) continue;
+		++n_aln;
+		int rp = cm_readpart(b);
+		std::pair<std::unordered_map<std::string, cm_seen_t>::iterator, bool> it;
+		cm_seen_t z;
+		z.done = 0, z.sup[0] = z.sup[1] = z.sup[2] = -1;
+		it = seen.insert(std::make_pair(std::string(bam_get_qname(b)), z));
+		cm_seen_t *v = &it.first->second;
+		if (v->done >> rp & 1) { ++n_dups; continue; }
+		if (b->core.flag & BAM_FSUPPLEMENTARY) {
+			if (v->sup[rp] < 0) {
+				v->sup[rp] = pend.size();
+				pend.push_back(b);
+				b = bam_init1();
+			} else {
+				if (pend[v->sup[rp]]->core.l_qseq < b->core.l_qseq)
+					std::swap(pend[v->sup[rp]], b);
+				++n_dups;
+			}
+			continue;
+		}
+		cm_bam2seq(b, s);
+		reads->name.push_back(bam_get_qname(b));
+		reads->seq.push_back(s);
+		v->done |= 1 << rp;
+		if (v->sup[rp] >= 0) { // the primary supersedes what was kept aside
+			bam_destroy1(pend[v->sup[rp]]);
+			pend[v->sup[rp]] = 0;
+			v->sup[rp] = -1;
+			++n_dups;
+		}
+	}
+	bam_destroy1(b);
+	for (i = 0; i < pend.size(); ++i) {
+		if (pend[i] == 0) continue;
+		cm_bam2seq(pend[i], s);
+		reads->name.push_back(bam_get_qname(pend[i]));
+		reads->seq.push_back(s);
+		bam_destroy1(pend[i]);
+		++n_sups;
+	}
+	if (ret < -1) {
+		fprintf(stderr, "[E::%s] failed to read alignments from '%s'\n", __func__, fn);
+	} else {
+		ret = 0;
+		if (cm_verbose >= 3)
+			fprintf(stderr, "[M::%s] collected %ld reads (%ld from supplementary alignments) from %ld alignments; %ld duplicates skipped\n",
+					__func__, (long)reads->name.size(), (long)n_sups, (long)n_aln, (long)n_dups);
+	}
+
+end:
+	if (itr) hts_itr_destroy(itr);
+	if (idx) hts_idx_destroy(idx);
+	if (h) sam_hdr_destroy(h);
+	sam_close(fp);
+	if (p.pool) hts_tpool_destroy(p.pool);
+	return ret < 0? -1 : 0;
+}
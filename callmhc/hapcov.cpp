@@ -0,0 +1,127 @@
+#include <assert.h>
+#include <algorithm>
+#include "hapcov.h"
+
+void cm_hapcov_add(cm_hapcov_t *c, int32_t hap, int64_t st, int64_t en)
+{
+	if (st >= en) return;
+	if (!c->a.empty() && c->a.back().hap == hap && c->a.back().en == st) { // M/X blocks only split by an insertion
+		c->a.back().en = en;
+		return;
+	}
+	cm_covintv_t t;
+	t.st = st, t.en = en, t.max = en, t.hap = hap;
+	c->a.push_back(t);
+}
+
+static bool cm_covintv_lt(const cm_covintv_t &x, const cm_covintv_t &y)
+{
+	return x.st < y.st || (x.st == y.st && x.hap < y.hap);
+}
+
+static int cm_intv_index_core(cm_covintv_t *a, int64_t n)
+{
+	int64_t i, last_i = 0, last = 0;
+	int k;
+	if (n <= 0) return -1;
+	for (i = 0; i < n; i += 2) last_i = i, last = a[i].max = a[i].en;
+	for (k = 1; 1LL<<k <= n; ++k) {
+		int64_t x = 1LL<<(k-1), i0 = (x<<1) - 1, step = x<<2;
+		for (i = i0; i < n; i += step) {
+			int64_t el = a[i - x].max;
+			int64_t er = i + x < n? a[i + x].max : last;
+			int64_t e = a[i].en;
+			e = e > el? e : el;
+			e = e > er? e : er;
+			a[i].max = e;
+		}
+		last_i = last_i>>k&1? last_i - x : last_i + x;
+		if (last_i < n && a[last_i].max > last)
+			last = a[last_i].max;
+	}
+	return k - 1;
+}
+
+void cm_hapcov_index(cm_hapcov_t *c)
+{
+	std::vector<std::pair<int64_t, int32_t> > ev;
+	size_t i;
+	int32_t dep = 0;
+
+	std::sort(c->a.begin(), c->a.end(), cm_covintv_lt);
+	c->max_level = cm_intv_index_core(c->a.data(), c->a.size());
+
+	ev.reserve(c->a.size() * 2);
+	for (i = 0; i < c->a.size(); ++i) {
+		ev.push_back(std::make_pair(c->a[i].st, 1));
+		ev.push_back(std::make_pair(c->a[i].en, -1));
+	}
+	std::sort(ev.begin(), ev.end());
+	c->run.clear();
+	for (i = 0; i < ev.size();) {
+		int64_t pos = ev[i].first;
+		for (; i < ev.size() && ev[i].first == pos; ++i)
+			dep += ev[i].second;
+		if (c->run.empty() || c->run.back().dep != dep) {
+			cm_covrun_t r;
+			r.st = pos, r.dep = dep;
+			c->run.push_back(r);
+		}
+	}
+	assert(dep == 0);
+}
+
+static inline int64_t cm_hapcov_run_idx(const cm_hapcov_t *c, int64_t pos) // the last run starting at or before pos
+{
+	int64_t lo = 0, hi = c->run.size();
+	while (lo < hi) {
+		int64_t mid = (lo + hi) >> 1;
+		if (c->run[mid].st <= pos) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo - 1;
+}
+
+int32_t cm_hapcov_depth(const cm_hapcov_t *c, int64_t pos)
+{
+	int64_t i = cm_hapcov_run_idx(c, pos);
+	return i < 0? 0 : c->run[i].dep;
+}
+
+int64_t cm_hapcov_next_change(const cm_hapcov_t *c, int64_t pos) // first position after pos with a different depth
+{
+	int64_t i = cm_hapcov_run_idx(c, pos) + 1;
+	return i < (int64_t)c->run.size()? c->run[i].st : INT64_MAX;
+}
+
+void cm_hapcov_haps(const cm_hapcov_t *c, int64_t st, int64_t en, std::vector<int32_t> &haps) // haplotypes covering any base in [st,en]
+{
+	const cm_covintv_t *a = c->a.data();
+	int64_t n = c->a.size(), i;
+	int t = 0;
+	struct { int64_t x; int k, w; } stack[64], z;
+
+	haps.clear();
+	if (n == 0 || st > en) return;
+	++en; // half-open from here on
+	stack[t].k = c->max_level, stack[t].x = (1LL<<c->max_level) - 1, stack[t++].w = 0;
+	while (t) {
+		z = stack[--t];
+		if (z.k <= 3) { // small subtree: a linear scan is faster
+			int64_t i0 = z.x >> z.k << z.k, i1 = i0 + (1LL<<(z.k+1)) - 1;
+			if (i1 >= n) i1 = n;
+			for (i = i0; i < i1 && a[i].st < en; ++i)
+				if (st < a[i].en) haps.push_back(a[i].hap);
+		} else if (z.w == 0) { // descend into the left child first
+			int64_t y = z.x - (1LL<<(z.k-1));
+			stack[t].k = z.k, stack[t].x = z.x, stack[t++].w = 1;
+			if (y >= n || a[y].max > st)
+				stack[t].k = z.k - 1, stack[t].x = y, stack[t++].w = 0;
+		} else if (z.x < n && a[z.x].st < en) {
+			if (st < a[z.x].en) haps.push_back(a[z.x].hap);
+			stack[t].k = z.k - 1, stack[t].x = z.x + (1LL<<(z.k-1)), stack[t++].w = 0;
+		}
+	}
+	std::sort(haps.begin(), haps.end());
+	haps.erase(std::unique(haps.begin(), haps.end()), haps.end());
+}
@@ -0,0 +1,42 @@
+#ifndef __CM_HAPCOV_H__
+#define __CM_HAPCOV_H__
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Haplotype coverage track. Each alignment contributes the reference
+ * intervals covered by its M/X operations (adjacent blocks separated by
+ * insertions are merged), so memory is proportional to the number of
+ * alignments and deletions rather than to the bases they span.
+ *
+ * Intervals are kept sorted by start with an implicit augmented interval
+ * tree on top (as in cgranges) to find the haplotypes spanning [st,en], and
+ * a run-length depth array answers depth queries by binary search.
+ */
+
+typedef struct {
+	int64_t st, en;  // half-open [st,en)
+	int64_t max;     // max end in the implicit subtree; set by cm_hapcov_index()
+	int32_t hap;
+} cm_covintv_t;
+
+typedef struct {
+	int64_t st;      // run covers [st, next run's st)
+	int32_t dep;
+} cm_covrun_t;
+
+typedef struct {
+	std::vector<cm_covintv_t> a;
+	std::vector<cm_covrun_t> run; // adjacent runs always differ in depth
+	int max_level;
+} cm_hapcov_t;
+
+void cm_hapcov_add(cm_hapcov_t *c, int32_t hap, int64_t st, int64_t en);
+void cm_hapcov_index(cm_hapcov_t *c);
+
+int32_t cm_hapcov_depth(const cm_hapcov_t *c, int64_t pos);
+int64_t cm_hapcov_next_change(const cm_hapcov_t *c, int64_t pos);
+void cm_hapcov_haps(const cm_hapcov_t *c, int64_t st, int64_t en, std::vector<int32_t> &haps);
+
+#endif
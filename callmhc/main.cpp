@@ -0,0 +1,46 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include "callmhc.h"
+
+static int usage(FILE *fp)
+{
+	fprintf(fp, "Usage: callmhc <command> <arguments>\n");
+	fprintf(fp, "Commands:\n");
+	fprintf(fp, "  run         extract, assemble and remap reads in the region, then call variants\n");
+	fprintf(fp, "  call        build events from haplotype alignments and call variants\n");
+	fprintf(fp, "  version     print version number\n");
+	return fp == stdout? 0 : 1;
+}
+
+int main(int argc, char *argv[])
+{
+	std::string cmd;
+	int i, ret = 0;
+
+	cm_reset_realtime();
+	if (argc == 1) return usage(stderr);
+	for (i = 0; i < argc; ++i) {
+		if (i) cmd += ' ';
+		cmd += argv[i];
+	}
+	cm_cmdline = (char*)cmd.c_str();
+	if (strcmp(argv[1], "call") == 0) ret = main_call(argc - 1, argv + 1);
+	else if (strcmp(argv[1], "run") == 0) ret = main_run(argc - 1, argv + 1);
+	else if (strcmp(argv[1], "version") == 0) {
+		puts(CM_VERSION);
+		return 0;
+	} else if (strcmp(argv[1], "help") == 0 || strcmp(argv[1], "-h") == 0) {
+		return usage(stdout);
+	} else {
+		fprintf(stderr, "[E::%s] unknown command '%s'\n", __func__, argv[1]);
+		return 1;
+	}
+	if (ret == 0 && cm_verbose >= 3) {
+		fprintf(stderr, "[M::%s] Version: %s\n", __func__, CM_VERSION);
+		fprintf(stderr, "[M::%s] CMD: %s\n", __func__, cm_cmdline);
+		fprintf(stderr, "[M::%s] Real time: %.3f sec; CPU: %.3f sec; Peak RSS: %.3f GB\n", __func__, cm_realtime(), cm_cputime(), cm_peakrss_in_gb());
+	}
+	return ret;
+}
@@ -0,0 +1,23 @@
+#ifndef __CM_PIPELINE_H__
+#define __CM_PIPELINE_H__
+
+#include <string>
+#include <vector>
+#include "event.h"
+
+/*
+ * In-process pipeline for `callmhc run`: reads in the region are pulled
+ * out of the input BAM/CRAM, assembled by hifiasm linked as a library and
+ * the raw unitigs are mapped back to the region's contig with minimap2.
+ * Reads, unitigs and alignments never go through intermediate files.
+ */
+
+typedef struct {
+	std::vector<std::string> name, seq;
+} cm_seqs_t;
+
+int cm_extract_reads(const char *fn, const char *reg, int n_threads, cm_seqs_t *reads, std::string &sample);
+int cm_assemble(const cm_seqs_t *reads, const char *prefix, int n_threads, int bf_shift, int max_cov, cm_seqs_t *utg);
+int cm_remap(const std::string &ref, const cm_opt_t *opt, const cm_seqs_t *utg, const char *fn_idx, cm_aln_set_t *haps);
+
+#endif
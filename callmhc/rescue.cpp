@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "kthread.h"
+#include "callmhc.h"
+#include "event.h"
+
+/*
+ * Rescue of regions covered by fewer than two haplotypes. Regions are cut
+ * into windows of at most opt->rescue_win bases and each window is called
+ * on its own from the reads overlapping it plus opt->rescue_flank bases on
+ * both sides. Only the calls starting inside the window are kept, hence peak
+ * memory is that of the largest window per thread.
+ *
+ * Clusters may chain well past the flank through merges or long deletions.
+ * A cluster is only settled if no event outside the fetched reads could join
+ * it: it must start at least max_merge_dist bases after the first fetched
+ * base and end max_merge_dist bases before the last. Otherwise the fetch is
+ * widened around it and the window is called again, so each call sees the
+ * same events and haplotypes as in a whole-region run.
+ */
+
+typedef struct {
+	const std::string *ref;
+	const cm_opt_t *opt;
+	int64_t lo, hi;                 // reads are only fetched from the target region [lo,hi)
+	std::vector<cm_region_t> win;
+	std::vector<cm_callset_t> out;  // calls of each window
+	std::vector<int64_t> n_reads;
+	std::vector<int> n_widen;       // times the fetch of each window was widened
+	cm_bam_t **fp;                  // one handle per thread
+	volatile int failed;
+} rescue_shared_t;
+
+static int rescue_settled(const rescue_shared_t *s, const cm_region_t *w, const std::vector<cm_cluster_t> &clusters, int64_t *beg, int64_t *end)
+{
+	const cm_opt_t *opt = s->opt;
+	int64_t d = opt->max_merge_dist > 0? opt->max_merge_dist : 0, b = *beg, e = *end;
+	size_t i;
+	for (i = 0; i < clusters.size(); ++i) { // clusters are sorted and disjoint
+		const cm_cluster_t *c = &clusters[i];
+		if (c->start > w->stop || c->stop + 1 < w->start) continue; // a right-shifted call may start at c->stop + 1
+		if (c->start - d < *beg && c->start - d - opt->rescue_flank < b) b = c->start - d - opt->rescue_flank;
+		if (c->stop + d + 1 > *end && c->stop + d + 1 + opt->rescue_flank > e) e = c->stop + d + 1 + opt->rescue_flank;
+	}
+	if (b < s->lo) b = s->lo;
+	if (e > s->hi) e = s->hi;
+	if (b == *beg && e == *end) return 1;
+	*beg = b, *end = e;
+	return 0;
+}
+
+static void rescue_worker(void *data, long i, int tid)
+{
+	rescue_shared_t *s = (rescue_shared_t*)data;
+	const cm_opt_t *opt = s->opt;
+	std::vector<cm_region_t> w(1, s->win[i]);
+	int64_t beg, end;
+
+	beg = w[0].start - opt->rescue_flank, end = w[0].stop + 1 + opt->rescue_flank;
+	if (beg < s->lo) beg = s->lo;
+	if (end > s->hi) end = s->hi;
+	for (;;) {
+		cm_aln_set_t reads;
+		cm_pos2var_t cand;
+		cm_hapcov_t read_cov;
+		std::vector<cm_cluster_t> clusters;
+		cm_callset_t merged;
+		if (cm_bam_load(s->fp[tid], opt->ctg.c_str(), beg, end, opt->min_mapq, &reads) < 0) {
+			s->failed = 1;
+			return;
+		}
+		cm_build_event_map(&reads, *s->ref, opt->max_mnp_dist, cand, &read_cov);
+		cm_cluster_adjacent_variants(cand, opt->max_merge_dist, clusters);
+		if (!rescue_settled(s, &w[0], clusters, &beg, &end)) {
+			++s->n_widen[i];
+			continue;
+		}
+		s->n_reads[i] = reads.a.size();
+		cm_merge_and_genotype(*s->ref, clusters, &read_cov, reads, opt, opt->maf, merged);
+		cm_filter_to_regions(merged, w, s->out[i]);
+		break;
+	}
+}
+
+int cm_rescue_regions(const char *fn, const std::string &ref, const cm_opt_t *opt, const std::vector<cm_region_t> &regs, cm_callset_t &rescued)
+{
+	rescue_shared_t s;
+	cm_callset_t::iterator it;
+	int64_t n_reads = 0, n_widen = 0;
+	size_t i;
+	int j, n_threads = opt->n_threads > 0? opt->n_threads : 1;
+
+	for (i = 0; i < regs.size(); ++i) {
+		int64_t st;
+		for (st = regs[i].start; st <= regs[i].stop; st += opt->rescue_win) {
+			cm_region_t w = regs[i];
+			w.start = st;
+			if (opt->rescue_win > 0 && w.start + opt->rescue_win - 1 < w.stop)
+				w.stop = w.start + opt->rescue_win - 1;
+			s.win.push_back(w);
+			if (opt->rescue_win <= 0) break;
+		}
+	}
+	if (s.win.empty()) return 0;
+	if (n_threads > (int)s.win.size()) n_threads = s.win.size();
+
+	s.ref = &ref, s.opt = opt, s.failed = 0;
+	s.lo = opt->st - 1, s.hi = opt->en; // as `samtools view in.bam ctg:st-en`
+	s.out.resize(s.win.size());
+	s.n_reads.assign(s.win.size(), 0);
+	s.n_widen.assign(s.win.size(), 0);
+	s.fp = (cm_bam_t**)calloc(n_threads, sizeof(cm_bam_t*));
+	for (j = 0; j < n_threads; ++j)
+		if ((s.fp[j] = cm_bam_open(fn)) == 0) s.failed = 1;
+	if (!s.failed) kt_for(n_threads, rescue_worker, &s, s.win.size());
+	for (j = 0; j < n_threads; ++j)
+		cm_bam_close(s.fp[j]);
+	free(s.fp);
+	if (s.failed) return -1;
+
+	for (i = 0; i < s.out.size(); ++i) {
+		for (it = s.out[i].begin(); it != s.out[i].end(); ++it)
+			rescued[it->first] = it->second;
+		n_reads += s.n_reads[i];
+		n_widen += s.n_widen[i] > 0;
+	}
+	if (cm_verbose >= 3)
+		fprintf(stderr, "[M::%s] rescued %ld calls in %ld windows (%ld widened for clusters past the flank) from %ld read alignments\n", __func__,
+				(long)rescued.size(), (long)s.win.size(), (long)n_widen, (long)n_reads);
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ketopt.h"
+#include "callmhc.h"
+#include "event.h"
+#include "pipeline.h"
+
+static ko_longopt_t run_long_options[] = {
+	{ "info",             ko_no_argument,       301 },
+	{ "verbose",          ko_no_argument,       302 },
+	{ "max-mnp-distance", ko_required_argument, 303 },
+	{ "sample-name",      ko_required_argument, 304 },
+	{ "min-map-qual",     ko_required_argument, 305 },
+	{ "max-merge-dist",   ko_required_argument, 306 },
+	{ "max-alt-alleles",  ko_required_argument, 307 },
+	{ "maf",              ko_required_argument, 308 },
+	{ "rescue-win",       ko_required_argument, 309 },
+	{ "rescue-flank",     ko_required_argument, 310 },
+	{ "max-cov",          ko_required_argument, 311 },
+	{ 0, 0, 0 }
+};
+
+static int run_usage(FILE *fp, const cm_opt_t *opt)
+{
+	fprintf(fp, "Usage: callmhc run [options] -i <reads.bam> -R <ref.fa> -o <prefix>\n");
+	fprintf(fp, "Options:\n");
+	fprintf(fp, "  -i FILE                   indexed BAM/CRAM of reads aligned to the reference, required\n");
+	fprintf(fp, "  -o STR                    output prefix of <prefix>.vcf and the assembly <prefix>.mhc.hifiasm.*, required\n");
+	fprintf(fp, "  -R FILE                   reference fasta holding the region's contig, required\n");
+	fprintf(fp, "  -L STR                    mhc region [%s:%lld-%lld]\n", opt->ctg.c_str(), (long long)opt->st, (long long)opt->en);
+	fprintf(fp, "  -d FILE                   minimap2 index of the region's contig; mapped if FILE exists, or built and saved\n");
+	fprintf(fp, "  -t INT                    number of threads [%d]\n", opt->n_threads);
+	fprintf(fp, "  -s STR                    sample name [SM of the input's @RG]\n");
+	fprintf(fp, "  -f INT                    bits for hifiasm's bloom filter; 0 to disable [fitted to the reads]\n");
+	fprintf(fp, "  --max-cov INT             downsample reads in windows covered by >INT reads; 0 to disable [0]\n");
+	fprintf(fp, "  --rescue-win INT          max window size when rescuing gap regions [%lld]\n", (long long)opt->rescue_win);
+	fprintf(fp, "  --rescue-flank INT        fetch reads at least this many bases around each rescue window [%lld]\n", (long long)opt->rescue_flank);
+	fprintf(fp, "  --info                    output AC and SH to INFO\n");
+	fprintf(fp, "  --min-map-qual INT        min mapping quality of supplementary haplotype alignments [%d]\n", opt->min_mapq);
+	fprintf(fp, "  --max-mnp-distance INT    max mnp distance [%d]\n", opt->max_mnp_dist);
+	fprintf(fp, "  --max-merge-dist INT      max distance of adjacent variants to be merged [%d]\n", opt->max_merge_dist);
+	fprintf(fp, "  --max-alt-alleles INT     max alternative alleles [%d]\n", opt->max_alt_alleles);
+	fprintf(fp, "  --maf FLOAT               min alleles' fraction [%g]\n", opt->maf);
+	fprintf(fp, "  --verbose                 show warning messages during calling\n");
+	return fp == stdout? 0 : 1;
+}
+
+int main_run(int argc, char *argv[])
+{
+	ketopt_t o = KETOPT_INIT;
+	cm_opt_t opt;
+	const char *fn_reads = 0, *prefix = 0, *fn_ref = 0, *fn_idx = 0, *sample_opt = 0;
+	std::string reg, ref, sample, fn_asm, fn_vcf;
+	int c, output_info = 0, bf_shift = -1, max_cov = 0;
+	cm_seqs_t reads, utg;
+	cm_aln_set_t haps;
+
+	cm_opt_init(&opt);
+	reg = "chr6:28510020-33480577";
+	while ((c = ketopt(&o, argc, argv, 1, "i:o:R:L:d:s:t:f:vh", run_long_options)) >= 0) {
+		if (c == 'i') fn_reads = o.arg;
+		else if (c == 'o') prefix = o.arg;
+		else if (c == 'R') fn_ref = o.arg;
+		else if (c == 'L') reg = o.arg;
+		else if (c == 'd') fn_idx = o.arg;
+		else if (c == 't') opt.n_threads = atoi(o.arg);
+		else if (c == 'f') bf_shift = atoi(o.arg);
+		else if (c == 301) output_info = 1;
+		else if (c == 'v' || c == 302) opt.verbose = 1;
+		else if (c == 303) opt.max_mnp_dist = atoi(o.arg);
+		else if (c == 's' || c == 304) sample_opt = o.arg;
+		else if (c == 305) opt.min_mapq = atoi(o.arg);
+		else if (c == 306) opt.max_merge_dist = atoi(o.arg);
+		else if (c == 307) opt.max_alt_alleles = atoi(o.arg);
+		else if (c == 308) opt.maf = atof(o.arg);
+		else if (c == 309) opt.rescue_win = atoll(o.arg);
+		else if (c == 310) opt.rescue_flank = atoll(o.arg);
+		else if (c == 311) max_cov = atoi(o.arg);
+		else if (c == 'h') return run_usage(stdout, &opt);
+		else {
+			fprintf(stderr, "[E::%s] unknown option or missing argument\n", __func__);
+			return 1;
+		}
+	}
+	if (fn_reads == 0 || prefix == 0 || fn_ref == 0) return run_usage(stderr, &opt);
+	if (cm_parse_region(reg.c_str(), opt.ctg, &opt.st, &opt.en) < 0) {
+		fprintf(stderr, "[E::%s] failed to parse reg_start and reg_stop from region string '%s'\n", __func__, reg.c_str());
+		return 1;
+	}
+	if (opt.st > opt.en) {
+		fprintf(stderr, "[E::%s] region start > region stop\n", __func__);
+		return 1;
+	}
+	fn_asm = std::string(prefix) + ".mhc.hifiasm";
+	fn_vcf = std::string(prefix) + ".vcf";
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] extract reads in %s\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9), reg.c_str());
+	if (cm_extract_reads(fn_reads, reg.c_str(), opt.n_threads, &reads, sample) < 0) {
+		fprintf(stderr, "[E::%s] failed to extract reads from '%s'\n", __func__, fn_reads);
+		return 1;
+	}
+	if (sample_opt) sample = sample_opt; // sample name in BAM file is not always correct
+	if (sample.empty()) {
+		fprintf(stderr, "[E::%s] failed to parse sample name from '%s'; please use -s\n", __func__, fn_reads);
+		return 1;
+	}
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] assemble %ld reads\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9), (long)reads.name.size());
+	if (cm_assemble(&reads, fn_asm.c_str(), opt.n_threads, bf_shift, max_cov, &utg) < 0) {
+		fprintf(stderr, "[E::%s] failed to assemble reads in the region\n", __func__);
+		return 1;
+	}
+	std::vector<std::string>().swap(reads.name); // reads are not needed any more
+	std::vector<std::string>().swap(reads.seq);
+
+	if (cm_verbose >= 3) fprintf(stderr, "[M::%s::%.3f*%.2f] remap %ld unitigs\n", __func__, cm_realtime(), cm_cputime() / (cm_realtime() + 1e-9), (long)utg.name.size());
+	if (cm_load_ref(fn_ref, opt.ctg.c_str(), ref) < 0) {
+		fprintf(stderr, "[E::%s] parse %s sequence from file %s failed\n", __func__, opt.ctg.c_str(), fn_ref);
+		return 1;
+	}
+	if (cm_remap(ref, &opt, &utg, fn_idx, &haps) < 0) {
+		fprintf(stderr, "[E::%s] failed to map unitigs to %s\n", __func__, opt.ctg.c_str());
+		return 1;
+	}
+
+	return cm_call_haps(&opt, ref, haps, fn_reads, fn_vcf.c_str(), sample.c_str(), output_info) < 0? 1 : 0;
+}
@@ -0,0 +1,51 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include "callmhc.h"
+
+int cm_verbose = 3;
+char *cm_cmdline = 0;
+
+static double cm_realtime0;
+
+static inline double cm_realtime_core(void)
+{
+	struct timeval tp;
+	gettimeofday(&tp, 0);
+	return tp.tv_sec + tp.tv_usec * 1e-6;
+}
+
+void cm_reset_realtime(void)
+{
+	cm_realtime0 = cm_realtime_core();
+}
+
+double cm_realtime(void)
+{
+	return cm_realtime_core() - cm_realtime0;
+}
+
+double cm_cputime(void)
+{
+	struct rusage r;
+	getrusage(RUSAGE_SELF, &r);
+	return r.ru_utime.tv_sec + r.ru_stime.tv_sec + 1e-6 * (r.ru_utime.tv_usec + r.ru_stime.tv_usec);
+}
+
+double cm_peakrss_in_gb(void)
+{
+	struct rusage r;
+	getrusage(RUSAGE_SELF, &r);
+#ifdef __linux__
+	return r.ru_maxrss * 1024 / 1073741824.0;
+#else
+	return r.ru_maxrss / 1073741824.0;
+#endif
+}
+
+void cm_fatal(const char *msg)
+{
+	fprintf(stderr, "[ERROR] %s\n", msg);
+	exit(1);
+}
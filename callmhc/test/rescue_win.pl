@@ -0,0 +1,68 @@
+#!/usr/bin/env perl
+
+# Rescue windows must give the same calls as a whole-region run, including
+# for clusters that chain past --rescue-flank. The haplotype BAM is empty, so
+# the whole region is rescued from the reads. Two reads carry a 500bp deletion
+# starting inside the first window; two reads that only start 250bp past the
+# window flank carry a SNP right after the deletion, which joins the cluster.
+
+use strict;
+use warnings;
+use FindBin qw($Bin);
+use File::Temp qw(tempdir);
+
+my $callmhc = $ENV{CALLMHC} // "$Bin/../callmhc";
+my $samtools = $ENV{SAMTOOLS} // "$Bin/../../samtools/samtools";
+my $tmp = tempdir(CLEANUP => 1);
+
+srand(11);
+my $ref = join("", map { (qw(A C G T))[int(rand(4))] } 1 .. 3000);
+my @reads = ( # [name, 0-based pos, CIGAR, 0-based SNP position or -1]
+	["del1", 800,  "150M500D300M",   -1],
+	["del2", 800,  "150M500D300M",   -1],
+	["snp1", 1300, "1000M",          1450],
+	["snp2", 1300, "1000M",          1450]);
+
+open(my $fh, ">", "$tmp/ref.fa") or die;
+print $fh ">chr6\n$ref\n";
+close($fh);
+
+open($fh, ">", "$tmp/reads.sam") or die;
+print $fh "\@HD\tVN:1.6\tSO:coordinate\n\@SQ\tSN:chr6\tLN:", length($ref), "\n";
+for my $r (@reads) {
+	my ($name, $pos, $cigar, $snp) = @$r;
+	my ($seq, $p) = ("", $pos);
+	while ($cigar =~ /(\d+)([MD])/g) {
+		$seq .= substr($ref, $p, $1) if $2 eq 'M';
+		$p += $1;
+	}
+	substr($seq, $snp - $pos, 1) =~ tr/ACGT/CGTA/ if $snp >= 0;
+	print $fh join("\t", $name, 0, "chr6", $pos + 1, 60, $cigar, "*", 0, 0, $seq, "*"), "\n";
+}
+close($fh);
+open($fh, ">", "$tmp/haps.sam") or die;
+print $fh "\@HD\tVN:1.6\tSO:coordinate\n\@SQ\tSN:chr6\tLN:", length($ref), "\n";
+close($fh);
+
+for my $f ("reads", "haps") {
+	system("$samtools view -b -o $tmp/$f.bam $tmp/$f.sam && $samtools index $tmp/$f.bam") == 0 or die "[ERROR] failed to convert $f.sam\n";
+}
+
+sub call_vcf {
+	my ($out, $opt) = @_;
+	system("$callmhc call -i $tmp/haps.bam --reads $tmp/reads.bam -R $tmp/ref.fa -L chr6:1-3000 -t 2 --info -o $tmp/$out.vcf $opt 2> $tmp/$out.log") == 0
+		or die "[ERROR] callmhc call failed; see below\n", `cat $tmp/$out.log`;
+	open(my $fh, "<", "$tmp/$out.vcf") or die;
+	my @vcf = grep { !/^#/ } <$fh>;
+	close($fh);
+	return @vcf;
+}
+
+my @whole = call_vcf("whole", "--rescue-win 0 --rescue-flank 3000");
+my @win = call_vcf("win", "--rescue-win 1000 --rescue-flank 50");
+die "[ERROR] expected the deletion to be merged with the SNP after it\n" unless grep { (split /\t/)[1] == 950 && length((split /\t/)[3]) == 502 } @whole;
+if (join("", @whole) ne join("", @win)) {
+	print STDERR "[ERROR] windowed calls differ from the whole-region run\n< ", join("< ", @whole), "> ", join("> ", @win);
+	exit 1;
+}
+print STDERR "[M::rescue_win] windowed calls match the whole-region run\n";
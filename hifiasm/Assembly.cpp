@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <zlib.h>
+#include <unistd.h>
 #include "Assembly.h"
 #include "Process_Read.h"
 #include "CommandLines.h"
@@ -10,11 +11,16 @@
 #include "Correct.h"
 #include "htab.h"
 #include "kthread.h"
+#include "ksort.h"
 
 void ha_get_new_candidates(ha_abuf_t *ab, int64_t rid, UC_Read *ucr, overlap_region_alloc *overlap_list, Candidates_list *cl, double bw_thres, int max_n_chain, int keep_whole_chain);
+uint64_t ha_get_n_anchors(ha_abuf_t *ab, int64_t rid, UC_Read *ucr);
 
 All_reads R_INF;
 
+#define generic_key(x) (x)
+KRADIX_SORT_INIT(ec64, uint64_t, generic_key, 8)
+
 void get_corrected_read_from_cigar(Cigar_record* cigar, char* pre_read, int pre_length, char* new_read, int* new_length)
 {
     int i, j;
@@ -437,12 +443,8 @@ static int64_t ha_Graph_mem(const Graph *g)
 {
 	int64_t i, mem = 0;
 	mem = sizeof(Graph) + g->node_q.size * 8 + g->g_nodes.size * sizeof(Node);
-	for (i = 0; i < (int64_t)g->g_nodes.size; ++i) {
-		Node *n = &g->g_nodes.list[i];
-		mem += n->mismatch_edges.size * sizeof(Edge);
-		mem += n->deletion_edges.size * sizeof(Edge);
-		mem += n->insertion_edges.size * sizeof(Edge);
-	}
+	for (i = 0; i < (int64_t)g->g_edges.n_blk; ++i)
+		mem += g->g_edges.blk_size[i] * sizeof(Edge);
 	mem += g->g_nodes.sort.size * 9;
 	return mem;
 }
@@ -470,12 +472,66 @@ int64_t ha_ovec_mem(const ha_ovec_buf_t *b)
 	return mem;
 }
 
+/*
+ * The cost of a read in overlapping and correction is roughly proportional to
+ * its number of anchors (minimizer hits), which varies by orders of magnitude
+ * between repeat-rich and unique reads. Reads are scheduled in decreasing
+ * order of their anchor count in the previous pass, so that the heaviest are
+ * not left to a single thread at the end. Without a previous pass, e.g. in the
+ * first round, the counts are estimated from the hits of each read in the
+ * index just built, which only takes a lookup per minimizer.
+ */
+static uint32_t *ha_read_cost;
+
+static void worker_read_cost(void *data, long i, int tid)
+{
+	ha_ovec_buf_t *b = ((ha_ovec_buf_t**)data)[tid];
+	uint64_t n_a = ha_get_n_anchors(b->ab, i, &b->self_read);
+	ha_read_cost[i] = n_a < UINT32_MAX? n_a : UINT32_MAX;
+}
+
+static uint32_t *ha_read_order(ha_ovec_buf_t **b)
+{
+	uint64_t i, n = R_INF.total_reads, *a;
+	uint32_t *order;
+	if (ha_read_cost == 0) {
+		CALLOC(ha_read_cost, n);
+		kt_for(asm_opt.thread_num, worker_read_cost, b, n);
+	}
+	MALLOC(a, n);
+	for (i = 0; i < n; ++i)
+		a[i] = (uint64_t)(UINT32_MAX - ha_read_cost[i]) << 32 | i;
+	radix_sort_ec64(a, a + n);
+	MALLOC(order, n);
+	for (i = 0; i < n; ++i) order[i] = (uint32_t)a[i];
+	free(a);
+	return order;
+}
+
+static void ha_sched_report(const char *func, double rt, const double *busy)
+{
+	int i, n = asm_opt.thread_num;
+	double min = rt, max = 0.0, sum = 0.0;
+	for (i = 0; i < n; ++i) {
+		sum += busy[i];
+		min = min < busy[i]? min : busy[i];
+		max = max > busy[i]? max : busy[i];
+	}
+	fprintf(stderr, "[M::%s::%.3f*%.2f] ==> %d threads busy for %.2f-%.2f sec (mean %.2f) in %.2f sec; %.1f%% idle\n",
+			func, yak_realtime(), yak_cpu_usage(), n, min, max, sum / n, rt, rt > 0.0? 100.0 * (1.0 - sum / (rt * n)) : 0.0);
+	fprintf(stderr, "[M::%s] busy/idle sec per thread:", func);
+	for (i = 0; i < n; ++i)
+		fprintf(stderr, " %.2f/%.2f", busy[i], rt > busy[i]? rt - busy[i] : 0.0);
+	fputc('\n', stderr);
+}
+
 static void worker_ovec(void *data, long i, int tid)
 {
 	ha_ovec_buf_t *b = ((ha_ovec_buf_t**)data)[tid];
 	int fully_cov, abnormal;
 
 	ha_get_new_candidates(b->ab, i, &b->self_read, &b->olist, &b->clist, 0.02, asm_opt.max_n_chain, 1);
+	ha_read_cost[i] = b->clist.length < UINT32_MAX? b->clist.length : UINT32_MAX;
 
 	clear_Cigar_record(&b->cigar1);
 	clear_Round2_alignment(&b->round2);
@@ -554,7 +610,7 @@ static void worker_ec_save(void *data, long i, int tid)
 	uint64_t N_occ;
 
 	char *new_read;
-	int new_read_length;
+	int new_read_length, changed, flipped = 0;
 
 	recover_UC_Read(&e->g_read, &R_INF, i);
 
@@ -585,24 +641,33 @@ static void worker_ec_save(void *data, long i, int tid)
 
 	new_read = e->second_round_read;
 	new_read_length = second_round_read_length;
+	changed = (new_read_length != (int)e->g_read.length || memcmp(new_read, e->g_read.seq, new_read_length) != 0);
 
 	if (asm_opt.roundID != asm_opt.number_of_round - 1)
 	{
 		///need modification
 		reverse_complement(new_read, new_read_length);
+		flipped = 1;
 	}
 	else if(asm_opt.number_of_round % 2 == 0)
 	{
 		///need modification
 		reverse_complement(new_read, new_read_length);
+		flipped = 1;
 	}
+	if (flipped && R_INF.N_site[i] && R_INF.N_site[i][0]) changed = 1; // reverse_complement() doesn't preserve N
+	ha_mzc_mark(i, changed, flipped); // cached minimizers are reused only if the read is unchanged
 
 	N_occ = get_N_occ(new_read, new_read_length);
 
 	if ((long long)R_INF.read_size[i] < new_read_length) {
+		uint8_t *s = ha_rs_in_blk(&R_INF, R_INF.read_sperate[i])? 0 : R_INF.read_sperate[i];
 		R_INF.read_size[i] = new_read_length;
-		REALLOC(R_INF.read_sperate[i], R_INF.read_size[i]/4+1);
+		REALLOC(s, R_INF.read_size[i]/4+1);
+		R_INF.read_sperate[i] = s;
 	}
+	if (R_INF.N_site[i] && !ha_rs_in_blk(&R_INF, R_INF.N_site[i]))
+		free(R_INF.N_site[i]);
 	R_INF.read_length[i] = new_read_length;
 	ha_compress_base(Get_READ(R_INF, i), new_read, new_read_length, &R_INF.N_site[i], N_occ);
 }
@@ -643,10 +708,16 @@ void ha_overlap_and_correct(int round)
 	ha_idx = ha_pt_gen(&asm_opt, ha_flt_tab, round == 0? 0 : 1, &R_INF, &hom_cov); // build the index
 	if (round == 0 && ha_flt_tab == 0) // then asm_opt.hom_cov hasn't been updated
 		ha_opt_update_cov(&asm_opt, hom_cov);
-	if (asm_opt.required_read_name)
+	if (asm_opt.required_read_name) {
 		kt_for(asm_opt.thread_num, worker_ovec_related_reads, b, R_INF.total_reads);
-	else
-		kt_for(asm_opt.thread_num, worker_ovec, b, R_INF.total_reads);
+	} else {
+		uint32_t *order = ha_read_order(b);
+		double *busy, rt;
+		CALLOC(busy, asm_opt.thread_num);
+		rt = kt_for_order(asm_opt.thread_num, worker_ovec, b, R_INF.total_reads, order, busy);
+		ha_sched_report(__func__, rt, busy);
+		free(order); free(busy);
+	}
 	ha_pt_destroy(ha_idx);
 	ha_idx = 0;
 
@@ -957,6 +1028,7 @@ static void worker_ov_final(void *data, long i, int tid)
 
 	//get_new_candidates(i, &g_read, &overlap_list, &array_list, &l, 0.001, 0);
 	ha_get_new_candidates(b->ab, i, &b->self_read, &b->olist, &b->clist, 0.001, asm_opt.max_n_chain, 0);
+	ha_read_cost[i] = b->clist.length < UINT32_MAX? b->clist.length : UINT32_MAX;
 
 	/**
 	  correct_overlap(&overlap_list, &R_INF, &g_read, &correct, &overlap_read, &POA_Graph, &DAGCon,
@@ -1145,22 +1217,121 @@ void ha_overlap_final(void)
 {
 	int i, hom_cov;
 	ha_ovec_buf_t **b;
+	uint32_t *order;
+	double *busy, rt;
 	CALLOC(b, asm_opt.thread_num);
 	for (i = 0; i < asm_opt.thread_num; ++i)
 		b[i] = ha_ovec_init(1, 1);
 	ha_idx = ha_pt_gen(&asm_opt, ha_flt_tab, 1, &R_INF, &hom_cov); // build the index
-	kt_for(asm_opt.thread_num, worker_ov_final, b, R_INF.total_reads);
+	order = ha_read_order(b);
+	CALLOC(busy, asm_opt.thread_num);
+	rt = kt_for_order(asm_opt.thread_num, worker_ov_final, b, R_INF.total_reads, order, busy);
+	ha_sched_report(__func__, rt, busy);
+	free(order); free(busy);
+	free(ha_read_cost);
+	ha_read_cost = 0;
 	ha_pt_destroy(ha_idx);
 	ha_idx = 0;
+	ha_mzc_destroy();
 	for (i = 0; i < asm_opt.thread_num; ++i)
 		ha_ovec_destroy(b[i]);
 	free(b);
 }
 
+/*
+ * Checkpoint of the corrected reads after round r (counting from 1), with the
+ * high-frequency k-mers and the coverage needed by later rounds. The last
+ * round also saves overlaps for ha_overlap_final(). Only the latest round is
+ * kept on disk and all are removed once the final overlaps are saved.
+ */
+static char *ha_ec_ckpt_name(int r)
+{
+	char *fn;
+	MALLOC(fn, strlen(asm_opt.output_file_name) + 32);
+	sprintf(fn, "%s.ec.r%d.bin", asm_opt.output_file_name, r);
+	return fn;
+}
+
+static void ha_ec_ckpt_write(int r)
+{
+	char *fn = ha_ec_ckpt_name(r);
+	int has_ov = (r == asm_opt.number_of_round);
+	FILE *fp;
+	if ((fp = fopen(fn, "wb")) == 0) {
+		fprintf(stderr, "[W::%s] failed to open '%s' for writing\n", __func__, fn);
+		free(fn);
+		return;
+	}
+	fwrite(&asm_opt.hom_cov, sizeof(int), 1, fp);
+	fwrite(&asm_opt.max_n_chain, sizeof(int), 1, fp);
+	fwrite(&has_ov, sizeof(int), 1, fp);
+	ha_ft_dump(ha_flt_tab, fp);
+	write_All_reads_fp(&R_INF, fp);
+	if (has_ov) {
+		write_ma_hit_ts_fp(R_INF.paf, R_INF.total_reads, fp);
+		write_ma_hit_ts_fp(R_INF.reverse_paf, R_INF.total_reads, fp);
+	}
+	if (fclose(fp) == 0 && ha_ckpt_seal(fn, HA_CKPT_EC) == 0) {
+		fprintf(stderr, "[M::%s::%.3f*%.2f] ==> saved corrected reads of round %d to '%s'\n", __func__, yak_realtime(), yak_cpu_usage(), r, fn);
+		if (r > 1) { // superseded
+			char *fn0 = ha_ec_ckpt_name(r - 1);
+			unlink(fn0);
+			free(fn0);
+		}
+	}
+	free(fn);
+}
+
+static int ha_ec_ckpt_load(void) // return the number of rounds restored
+{
+	int r, i, has_ov, ret = 0;
+	for (r = asm_opt.number_of_round; r > 0 && ret == 0; --r) {
+		char *fn = ha_ec_ckpt_name(r);
+		FILE *fp;
+		if (ha_ckpt_check(fn, HA_CKPT_EC) && (fp = fopen(fn, "rb")) != 0) {
+			if (fread(&asm_opt.hom_cov, sizeof(int), 1, fp) == 1 && fread(&asm_opt.max_n_chain, sizeof(int), 1, fp) == 1
+				&& fread(&has_ov, sizeof(int), 1, fp) == 1 && (has_ov || r < asm_opt.number_of_round))
+			{
+				ha_flt_tab = ha_ft_load(fp);
+				load_All_reads_fp(&R_INF, fp);
+				if (r == asm_opt.number_of_round) {
+					load_ma_hit_ts_fp(&R_INF.paf, fp);
+					load_ma_hit_ts_fp(&R_INF.reverse_paf, fp);
+				} else {
+					MALLOC(R_INF.paf, R_INF.total_reads);
+					MALLOC(R_INF.reverse_paf, R_INF.total_reads);
+					for (i = 0; i < (int)R_INF.total_reads; ++i) {
+						init_ma_hit_t_alloc(&R_INF.paf[i]);
+						init_ma_hit_t_alloc(&R_INF.reverse_paf[i]);
+					}
+				}
+				fprintf(stderr, "[M::%s::%.3f*%.2f] ==> loaded corrected reads of round %d from '%s'\n", __func__,
+						yak_realtime(), yak_cpu_usage(), r, fn);
+				ret = r;
+			}
+			fclose(fp);
+		}
+		free(fn);
+	}
+	return ret;
+}
+
+static void ha_ec_ckpt_remove(void)
+{
+	int r;
+	for (r = 1; r <= asm_opt.number_of_round; ++r) {
+		char *fn = ha_ec_ckpt_name(r);
+		unlink(fn);
+		free(fn);
+	}
+}
+
 int ha_assemble(void)
 {
 	extern void ha_extract_print_list(const All_reads *rs, int n_rounds, const char *o);
-	int r, hom_cov = -1, ovlp_loaded = 0;
+	extern void write_all_data_to_disk(ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources, All_reads *RNF, char* output_file_name);
+	int r, r0 = 0, hom_cov = -1, ovlp_loaded = 0;
+	ha_ckpt_init(&asm_opt);
 	if (asm_opt.load_index_from_disk && load_all_data_from_disk(&R_INF.paf, &R_INF.reverse_paf, asm_opt.output_file_name)) {
 		ovlp_loaded = 1;
 		fprintf(stderr, "[M::%s::%.3f*%.2f] ==> loaded corrected reads and overlaps from disk\n", __func__, yak_realtime(), yak_cpu_usage());
@@ -1174,14 +1345,22 @@ int ha_assemble(void)
 		if (asm_opt.flag & HA_F_WRITE_PAF) Output_PAF();
 	}
 	if (!ovlp_loaded) {
-		// construct hash table for high occurrence k-mers
-		if (!(asm_opt.flag & HA_F_NO_KMER_FLT)) {
-			ha_flt_tab = ha_ft_gen(&asm_opt, &R_INF, &hom_cov);
-			ha_opt_update_cov(&asm_opt, hom_cov);
+		// resume after the last saved round of correction
+		if (asm_opt.load_index_from_disk)
+			r0 = ha_ec_ckpt_load();
+		if (r0 == 0) {
+			// estimate coverage, downsample and shrink the bloom filter for reads from a small region
+			if (asm_opt.flag & HA_F_TARGETED)
+				ha_targeted_prep(&asm_opt);
+			// construct hash table for high occurrence k-mers
+			if (!(asm_opt.flag & HA_F_NO_KMER_FLT)) {
+				ha_flt_tab = ha_ft_gen(&asm_opt, &R_INF, &hom_cov);
+				ha_opt_update_cov(&asm_opt, hom_cov);
+			}
 		}
 		// error correction
 		assert(asm_opt.number_of_round > 0);
-		for (r = 0; r < asm_opt.number_of_round; ++r) {
+		for (r = r0; r < asm_opt.number_of_round; ++r) {
 			ha_opt_reset_to_round(&asm_opt, r); // this update asm_opt.roundID and a few other fields
 			ha_overlap_and_correct(r);
 			fprintf(stderr, "[M::%s::%.3f*%.2f@%.3fGB] ==> corrected reads for round %d\n", __func__, yak_realtime(),
@@ -1189,21 +1368,30 @@ int ha_assemble(void)
 			fprintf(stderr, "[M::%s] # bases: %lld; # corrected bases: %lld; # recorrected bases: %lld\n", __func__,
 					asm_opt.num_bases, asm_opt.num_corrected_bases, asm_opt.num_recorrected_bases);
 			fprintf(stderr, "[M::%s] size of buffer: %.3fGB\n", __func__, asm_opt.mem_buf / 1073741824.0);
+			if (asm_opt.write_index_to_disk) ha_ec_ckpt_write(r + 1);
 		}
 		if (asm_opt.flag & HA_F_WRITE_EC) Output_corrected_reads();
 		// overlap between corrected reads
 		ha_opt_reset_to_round(&asm_opt, asm_opt.number_of_round);
 		ha_overlap_final();
+		R_INF.paf = ma_hit_pack(R_INF.paf, R_INF.total_reads);
+		R_INF.reverse_paf = ma_hit_pack(R_INF.reverse_paf, R_INF.total_reads);
 		fprintf(stderr, "[M::%s::%.3f*%.2f@%.3fGB] ==> found overlaps for the final round\n", __func__, yak_realtime(),
 				yak_cpu_usage(), yak_peakrss_in_gb());
 		ha_print_ovlp_stat(R_INF.paf, R_INF.reverse_paf, R_INF.total_reads);
 		ha_ft_destroy(ha_flt_tab);
 		if (asm_opt.flag & HA_F_WRITE_PAF) Output_PAF();
 		ha_triobin(&asm_opt);
+		if (asm_opt.write_index_to_disk) {
+			write_all_data_to_disk(R_INF.paf, R_INF.reverse_paf, &R_INF, asm_opt.output_file_name);
+			ha_ec_ckpt_remove();
+		}
 	}
 	build_string_graph_without_clean(asm_opt.min_overlap_coverage, R_INF.paf, R_INF.reverse_paf, 
 			R_INF.total_reads, R_INF.read_length, asm_opt.min_overlap_Len, asm_opt.max_hang_Len, asm_opt.clean_round, 
-			asm_opt.gap_fuzz, asm_opt.min_drop_rate, asm_opt.max_drop_rate, asm_opt.output_file_name, asm_opt.large_pop_bubble_size, 0, !ovlp_loaded);
+			asm_opt.gap_fuzz, asm_opt.min_drop_rate, asm_opt.max_drop_rate, asm_opt.output_file_name, asm_opt.large_pop_bubble_size, 0);
 	destory_All_reads(&R_INF);
+	free(ha_rd_drop);
+	ha_rd_drop = 0;
 	return 0;
 }
@@ -19,6 +19,13 @@ static ko_longopt_t long_options[] = {
 	{ "max-od-final",  ko_no_argument, 306 },
 	{ "ex-list",       ko_required_argument, 307 },
 	{ "ex-iter",       ko_required_argument, 308 },
+	{ "targeted",      ko_no_argument, 309 },
+	{ "max-cov",       ko_required_argument, 310 },
+	{ "gfa-gz",        ko_no_argument, 311 },
+	{ "gfa-idx",       ko_no_argument, 312 },
+	{ "skip-gfa",      ko_required_argument, 313 },
+	{ "trio-dump",     ko_required_argument, 314 },
+	{ "trio-idx",      ko_required_argument, 315 },
 	{ 0, 0, 0 }
 };
 
@@ -43,6 +50,8 @@ void Print_H(hifiasm_opt_t* asm_opt)
 	fprintf(stderr, "    -f INT        number of bits for bloom filter; 0 to disable [%d]\n", asm_opt->bf_shift);
 	fprintf(stderr, "    -D FLOAT      drop k-mers occuring >FLOAT*coverage times [%.1f]\n", asm_opt->high_factor);
 	fprintf(stderr, "    -N INT        consider up to max(-D*coverage,-N) overlaps for each oriented read [%d]\n", asm_opt->max_n_chain);
+	fprintf(stderr, "    --targeted    reads from a small region; fit -f to the input and estimate coverage from it\n");
+	fprintf(stderr, "    --max-cov INT with --targeted, downsample windows covered by >INT reads; 0 to disable [%d]\n", asm_opt->max_cov);
     fprintf(stderr, "    -i            ignore saved overlaps in *.ovlp* files\n");
     fprintf(stderr, "    -z INT        length of adapters that should be removed [%d]\n", asm_opt->adapterLen);
     fprintf(stderr, "    -m INT        size of popped large bubbles for contig graph [%lld]\n", asm_opt->large_pop_bubble_size);
@@ -53,6 +62,11 @@ void Print_H(hifiasm_opt_t* asm_opt)
     fprintf(stderr, "    --version     show version number\n");
     fprintf(stderr, "    -h            show help information\n");
 
+	fprintf(stderr, "  Output:\n");
+	fprintf(stderr, "    --gfa-gz      write GFA files BGZF-compressed (*.gfa.gz)\n");
+	fprintf(stderr, "    --gfa-idx     write FILE.gfai with the name, length and offset of each segment\n");
+	fprintf(stderr, "    --skip-gfa STR  comma-separated GFA files not to write, e.g. noseq,p_utg,a_ctg []\n");
+
     fprintf(stderr, "  Trio-partition:\n");
     fprintf(stderr, "    -1 FILE       hap1/paternal k-mer dump generated by \"yak count\" []\n");
     fprintf(stderr, "    -2 FILE       hap2/maternal k-mer dump generated by \"yak count\" []\n");
@@ -60,6 +74,8 @@ void Print_H(hifiasm_opt_t* asm_opt)
 	fprintf(stderr, "    -4 FILE       list of hap2/maternal read names []\n");
     fprintf(stderr, "    -c INT        lower bound of the binned k-mer's frequency [%d]\n", asm_opt->min_cnt);
     fprintf(stderr, "    -d INT        upper bound of the binned k-mer's frequency [%d]\n", asm_opt->mid_cnt);
+	fprintf(stderr, "    --trio-dump FILE  save -1/-2 k-mers that pass -c/-d to a compact table FILE and exit\n");
+	fprintf(stderr, "    --trio-idx FILE   memory-map a table from --trio-dump instead of -1/-2\n");
 
     fprintf(stderr, "  Purge-dups:\n");
     fprintf(stderr, "    -l INT        level of purge-dup. In default, [%d] for non-trio; [%d] for trio (see hifiasm.1 for details)\n", 
@@ -136,7 +152,10 @@ void ha_opt_reset_to_round(hifiasm_opt_t* asm_opt, int round)
 
 void ha_opt_update_cov(hifiasm_opt_t *opt, int hom_cov)
 {
-	int max_n_chain = (int)(hom_cov * opt->high_factor + .499);
+	int max_n_chain;
+	if (hom_cov <= 0 && (opt->flag & HA_F_TARGETED)) // no clear peak; keep the estimate from ha_targeted_prep()
+		hom_cov = opt->hom_cov;
+	max_n_chain = (int)(hom_cov * opt->high_factor + .499);
 	opt->hom_cov = hom_cov;
 	if (opt->max_n_chain < max_n_chain)
 		opt->max_n_chain = max_n_chain;
@@ -280,6 +299,12 @@ int check_option(hifiasm_opt_t* asm_opt)
 		return 0;
 	}
 
+    if(asm_opt->max_cov < 0)
+    {
+        fprintf(stderr, "[ERROR] the max coverage to downsample to must be >= 0 (--max-cov)\n");
+        return 0;
+    }
+
     if(asm_opt->max_short_tip < 0)
     {
         fprintf(stderr, "[ERROR] the length of removal tips must be >= 0 (-n)\n");
@@ -304,6 +329,7 @@ int check_option(hifiasm_opt_t* asm_opt)
     if(asm_opt->fn_bin_yak[1] != NULL && check_file(asm_opt->fn_bin_yak[1], "YAK2") == 0) return 0;
     if(asm_opt->fn_bin_list[0] != NULL && check_file(asm_opt->fn_bin_list[0], "LIST1") == 0) return 0;
     if(asm_opt->fn_bin_list[1] != NULL && check_file(asm_opt->fn_bin_list[1], "LIST2") == 0) return 0;
+    if(asm_opt->fn_trio_idx != NULL && check_file(asm_opt->fn_trio_idx, "-trio-idx") == 0) return 0;
 
     // fprintf(stderr, "input file num: %d\n", asm_opt->num_reads);
     // fprintf(stderr, "output file: %s\n", asm_opt->output_file_name);
@@ -404,6 +430,13 @@ int CommandLine_process(int argc, char *argv[], hifiasm_opt_t* asm_opt)
 		else if (c == 306) asm_opt->max_ov_diff_final = atof(opt.arg);
 		else if (c == 307) asm_opt->extract_list = opt.arg;
 		else if (c == 308) asm_opt->extract_iter = atoi(opt.arg);
+		else if (c == 309) asm_opt->flag |= HA_F_TARGETED;
+		else if (c == 310) asm_opt->max_cov = atoi(opt.arg);
+		else if (c == 311) asm_opt->flag |= HA_F_GFA_GZ;
+		else if (c == 312) asm_opt->flag |= HA_F_GFA_IDX;
+		else if (c == 313) asm_opt->skip_gfa = opt.arg;
+		else if (c == 314) asm_opt->fn_trio_dump = opt.arg;
+		else if (c == 315) asm_opt->fn_trio_idx = opt.arg;
         else if (c == 'l')
         {   ///0: disable purge_dup; 1: purge containment; 2: purge overlap
             asm_opt->purge_level_primary = asm_opt->purge_level_trio = atoi(opt.arg);
@@ -422,6 +455,16 @@ int CommandLine_process(int argc, char *argv[], hifiasm_opt_t* asm_opt)
 		}
     }
 
+    if (asm_opt->fn_trio_dump) // no reads needed
+    {
+        if (asm_opt->fn_bin_yak[0] == NULL || asm_opt->fn_bin_yak[1] == NULL)
+        {
+            fprintf(stderr, "[ERROR] --trio-dump requires both -1 and -2\n");
+            return 0;
+        }
+        return check_file(asm_opt->fn_bin_yak[0], "1") && check_file(asm_opt->fn_bin_yak[1], "2");
+    }
+
     if (argc == opt.ind)
     {
         Print_H(asm_opt);
@@ -2,6 +2,7 @@
 #define __COMMAND_LINE_PARSER__
 
 #include <pthread.h>
+#include <stdint.h>
 
 #define HA_VERSION "0.7-dirty-r255"
 
@@ -15,23 +16,38 @@
 #define HA_F_SKIP_TRIOBIN    0x20
 #define HA_F_PURGE_CONTAIN   0x40
 #define HA_F_PURGE_JOIN      0x80
+#define HA_F_KEEP_R_UTG      0x100 // keep the raw unitig graph in ha_r_utg instead of freeing it
+#define HA_F_TARGETED        0x200 // reads from a small region: size tables by the input and estimate coverage from it
+#define HA_F_GFA_GZ          0x400 // write GFA files BGZF-compressed
+#define HA_F_GFA_IDX         0x800 // write a .gfai segment index next to each GFA file
 
 #define HA_MIN_OV_DIFF       0.02 // min sequence divergence in an overlap
 
+typedef struct { // reads held in memory by a program linking hifiasm as a library
+	int64_t n;
+	char **name, **seq;
+	int *len;
+} ha_mem_reads_t;
+
 typedef struct {
 	int flag;
     int num_reads;
     char** read_file_names;
+	const ha_mem_reads_t *mem_reads; // if set, read_file_names is not used
     char* output_file_name;
     char* required_read_name;
 	char *fn_bin_yak[2];
 	char *fn_bin_list[2];
+	char *fn_trio_idx;  // compact trio table written by --trio-dump; replaces -1/-2
+	char *fn_trio_dump; // write -1/-2 as a compact trio table and exit
 	char *extract_list;
+	char *skip_gfa; // comma-separated GFA variants not to write
 	int extract_iter;
     int thread_num;
     int k_mer_length;
 	int mz_win;
 	int bf_shift;
+	int max_cov; // downsample reads in windows covered by more than this; 0 to disable
 	double high_factor; // coverage cutoff set to high_factor*hom_cov
 	double max_ov_diff_ec;
 	double max_ov_diff_final;
@@ -81,7 +97,7 @@ double Get_T(void);
 
 static inline int ha_opt_triobin(const hifiasm_opt_t *opt)
 {
-	return ((opt->fn_bin_yak[0] && opt->fn_bin_yak[1]) || (opt->fn_bin_list[0] && opt->fn_bin_list[1]));
+	return ((opt->fn_bin_yak[0] && opt->fn_bin_yak[1]) || (opt->fn_bin_list[0] && opt->fn_bin_list[1]) || opt->fn_trio_idx);
 }
 
 #endif
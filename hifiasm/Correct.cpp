@@ -299,6 +299,37 @@ All_reads* R_INF)
     return 0;
 }
 
+///verify windows of overlaps in dumy->overlap_region_group[0..groupLen-1] against x_string; all have the same length
+static void verify_window_group(long long window_start, long long window_end, long long x_len, char* x_string, long long Window_Len,
+int groupLen, overlap_region_alloc* overlap_list, Correct_dumy* dumy, uint64_t* overlapID, uint64_t* y_startGroup,
+int* y_extra_begin, int* y_extra_end, int* error_threshold)
+{
+    int i;
+    int return_sites[GROUP_SIZE];
+	unsigned int return_sites_error[GROUP_SIZE];
+    char* group[GROUP_SIZE];
+
+    for (i = 0; i < GROUP_SIZE; i++) group[i] = dumy->overlap_region_group[i];
+    Reserve_Banded_BPM_N_SIMD(group, groupLen, Window_Len, x_string, WINDOW,
+    return_sites, return_sites_error, THRESHOLD, dumy->Peq_SSE);
+
+    for (i = 0; i < groupLen; i++)
+    {
+        if (return_sites_error[i]!=(unsigned int)-1)
+        {
+            overlap_list->list[overlapID[i]].align_length += x_len;
+            append_window_list(&overlap_list->list[overlapID[i]], window_start, window_end, 
+                            y_startGroup[i], y_startGroup[i] + return_sites[i], (int)return_sites_error[i],
+                            y_extra_begin[i], y_extra_end[i], error_threshold[i]);
+        }
+        else
+        {
+            append_window_list(&overlap_list->list[overlapID[i]], window_start, window_end, y_startGroup[i], -1, -1,
+            y_extra_begin[i], y_extra_end[i], error_threshold[i]);
+        }
+    }
+}
+
 void verify_window(long long window_start, long long window_end, overlap_region_alloc* overlap_list,Correct_dumy* dumy, All_reads* R_INF,
 char* r_string)
 {
@@ -311,9 +342,7 @@ char* r_string)
     long long x_end, x_len;
     int end_site;
     unsigned int error;
-    int groupLen = 0;
-    int return_sites[GROUP_SIZE];
-	unsigned int return_sites_error[GROUP_SIZE];
+    int groupLen = 0, group_size = Reserve_Banded_BPM_lanes();
     uint64_t overlapID[GROUP_SIZE];
     uint64_t y_startGroup[GROUP_SIZE];
     int y_extra_begin[GROUP_SIZE];
@@ -357,116 +386,18 @@ char* r_string)
         groupLen++;
         
 
-        if (groupLen == GROUP_SIZE)
+        if (groupLen == group_size)
         {
-            Reserve_Banded_BPM_4_SSE_only(dumy->overlap_region_group[0], dumy->overlap_region_group[1], 
-            dumy->overlap_region_group[2], dumy->overlap_region_group[3], Window_Len, x_string, WINDOW,
-                return_sites, return_sites_error, THRESHOLD, dumy->Peq_SSE);
+            verify_window_group(window_start, window_end, x_len, x_string, Window_Len, groupLen, overlap_list, dumy,
+            overlapID, y_startGroup, y_extra_begin, y_extra_end, error_threshold);
             groupLen = 0;
-
-            
-            if (return_sites_error[0]!=(unsigned int)-1)
-            {
-                overlap_list->list[overlapID[0]].align_length += x_len;
-
-                append_window_list(&overlap_list->list[overlapID[0]], window_start, window_end, 
-                            y_startGroup[0], y_startGroup[0] + return_sites[0], (int)return_sites_error[0],
-                            y_extra_begin[0], y_extra_end[0], error_threshold[0]);
-            }
-            else
-            {
-                append_window_list(&overlap_list->list[overlapID[0]], window_start, window_end, y_startGroup[0], -1, -1,
-                y_extra_begin[0], y_extra_end[0], error_threshold[0]);
-            }
-            
-
-            if (return_sites_error[1]!=(unsigned int)-1)
-            {
-                overlap_list->list[overlapID[1]].align_length += x_len;
-
-                append_window_list(&overlap_list->list[overlapID[1]], window_start, window_end, 
-                            y_startGroup[1], y_startGroup[1] + return_sites[1], (int)return_sites_error[1],
-                            y_extra_begin[1], y_extra_end[1], error_threshold[1]);
-            }
-            else
-            {
-                append_window_list(&overlap_list->list[overlapID[1]], window_start, window_end, y_startGroup[1], -1, -1,
-                y_extra_begin[1], y_extra_end[1], error_threshold[1]);
-            }
-            
-
-            if (return_sites_error[2]!=(unsigned int)-1)
-            {
-                overlap_list->list[overlapID[2]].align_length += x_len;
-
-                append_window_list(&overlap_list->list[overlapID[2]], window_start, window_end, 
-                            y_startGroup[2], y_startGroup[2] + return_sites[2], (int)return_sites_error[2],
-                            y_extra_begin[2], y_extra_end[2], error_threshold[2]);
-            }
-            else
-            {
-                append_window_list(&overlap_list->list[overlapID[2]], window_start, window_end, y_startGroup[2], -1, -1,
-                y_extra_begin[2], y_extra_end[2], error_threshold[2]);
-            }
-            
-
-            if (return_sites_error[3]!=(unsigned int)-1)
-            {
-                overlap_list->list[overlapID[3]].align_length += x_len;
-
-                append_window_list(&overlap_list->list[overlapID[3]], window_start, window_end, 
-                            y_startGroup[3], y_startGroup[3] + return_sites[3], (int)return_sites_error[3],
-                            y_extra_begin[3], y_extra_end[3], error_threshold[3]);
-            }
-            else
-            {
-                append_window_list(&overlap_list->list[overlapID[3]], window_start, window_end, y_startGroup[3], -1, -1,
-                y_extra_begin[3], y_extra_end[3], error_threshold[3]);
-            }    
         }
     }
 
-    if (groupLen == 1)
+    if (groupLen > 0)
     {
-        end_site = Reserve_Banded_BPM(dumy->overlap_region_group[0], Window_Len, x_string, WINDOW, THRESHOLD, &error);
-
-        if (error!=(unsigned int)-1)
-        {
-            overlap_list->list[overlapID[0]].align_length += x_len;
-
-            append_window_list(&overlap_list->list[overlapID[0]], window_start, window_end, 
-                                y_startGroup[0], y_startGroup[0] + end_site, (int)error,
-                                y_extra_begin[0], y_extra_end[0], error_threshold[0]);
-        }
-        else
-        {
-            append_window_list(&overlap_list->list[overlapID[0]], window_start, window_end, y_startGroup[0], -1, -1,
-            y_extra_begin[0], y_extra_end[0], error_threshold[0]);
-        }
-    }
-    else if (groupLen > 1)
-    {
-        Reserve_Banded_BPM_4_SSE_only(dumy->overlap_region_group[0], dumy->overlap_region_group[1], 
-                dumy->overlap_region_group[2], dumy->overlap_region_group[3], Window_Len, x_string, WINDOW,
-			        return_sites, return_sites_error, THRESHOLD, dumy->Peq_SSE);
-
-        for (i = 0; i < groupLen; i++)
-        {
-            if (return_sites_error[i]!=(unsigned int)-1)
-            {
-                overlap_list->list[overlapID[i]].align_length += x_len;
-                append_window_list(&overlap_list->list[overlapID[i]], window_start, window_end, 
-                                y_startGroup[i], y_startGroup[i] + return_sites[i], (int)return_sites_error[i],
-                                y_extra_begin[i], y_extra_end[i], error_threshold[i]);
-            }
-            else
-            {
-                append_window_list(&overlap_list->list[overlapID[i]], window_start, window_end, y_startGroup[i], -1, -1,
-                y_extra_begin[i], y_extra_end[i], error_threshold[i]);
-            }
-            
-        }
-
+        verify_window_group(window_start, window_end, x_len, x_string, Window_Len, groupLen, overlap_list, dumy,
+        overlapID, y_startGroup, y_extra_begin, y_extra_end, error_threshold);
         groupLen = 0;
     }
 
@@ -2622,6 +2553,88 @@ All_reads* R_INF, int test_window, int test_boundary)
     }
 }
 
+///the cigars of windows group[0..n_group-1] of overlap j, which have the same x_len and error_threshold
+///and have their y strings in dumy->overlap_region_group[]
+static void recalcate_window_cigars(overlap_region_alloc* overlap_list, long long j, All_reads* R_INF, 
+                        UC_Read* g_read, Correct_dumy* dumy, long long* group, int n_group)
+{
+    long long y_id = overlap_list->list[j].y_id;
+    int y_strand = overlap_list->list[j].y_pos_strand;
+    window_list* w = &(overlap_list->list[j].w_list[group[0]]);
+    long long x_len = w->x_end - w->x_start + 1;
+    int threshold = w->error_threshold;
+    long long Window_Len = x_len + (threshold << 1);
+    long long y_start;
+    char *pattern[PATH_GROUP_SIZE], *text[PATH_GROUP_SIZE], *path[PATH_GROUP_SIZE];
+    int old_error[PATH_GROUP_SIZE], old_end_site[PATH_GROUP_SIZE];
+    int end_sites[PATH_GROUP_SIZE], start_sites[PATH_GROUP_SIZE], path_lengths[PATH_GROUP_SIZE];
+    unsigned int errors[PATH_GROUP_SIZE];
+    int k, end_site, real_y_start, extra_begin, extra_end, path_length;
+    unsigned int error;
+    char *x_string, *y_string, *p;
+
+    for (k = 0; k < n_group; k++)
+    {
+        w = &(overlap_list->list[j].w_list[group[k]]);
+        pattern[k] = dumy->overlap_region_group[k];
+        text[k] = g_read->seq + w->x_start;
+        path[k] = dumy->path_group[k];
+        old_error[k] = w->error;
+        old_end_site[k] = w->y_end - w->y_start;
+        path_lengths[k] = 0;
+    }
+
+    ///note!!! need notification
+    Reserve_Banded_BPM_PATH_N(pattern, text, n_group, Window_Len, x_len, threshold, old_error, old_end_site,
+    end_sites, errors, start_sites, path_lengths, dumy->matrix_bit_group, path);
+
+    for (k = 0; k < n_group; k++)
+    {
+        w = &(overlap_list->list[j].w_list[group[k]]);
+        if (errors[k] == (unsigned int)-1)
+        {
+            fprintf(stderr, "error\n");
+            continue;
+        }
+
+        x_string = text[k];
+        y_string = pattern[k];
+        p = path[k];
+        path_length = path_lengths[k];
+        y_start = w->y_start;
+        extra_begin = w->extra_begin;
+        extra_end = w->extra_end;
+        end_site = end_sites[k];
+        real_y_start = start_sites[k];
+        error = errors[k];
+
+        if (end_site == Window_Len - 1 || real_y_start == 0)
+        {
+            ///on success the new path and y string are in dumy->path and dumy->overlap_region
+            if(fix_boundary(x_string, x_len, threshold, y_start, real_y_start, end_site,
+            extra_begin, extra_end, y_id, Window_Len, R_INF, dumy, y_strand, error,
+            &y_start, &real_y_start, &end_site,
+            &extra_begin, &extra_end, &error))
+            {
+                w->error = error;
+                w->extra_begin = extra_begin;
+                w->extra_end = extra_end;
+                y_string = dumy->overlap_region;
+                p = dumy->path;
+                path_length = dumy->path_length;
+            }
+        }
+
+        generate_cigar(p, path_length, w, &real_y_start, &end_site, &error, x_string, x_len, y_string);
+
+        ///note!!! need notification
+        real_y_start = y_start + real_y_start - extra_begin;
+        w->y_start = real_y_start;
+        w->y_end = y_start + end_site - extra_begin;
+        w->error = error;
+    }
+}
+
 inline void recalcate_window_advance(overlap_region_alloc* overlap_list, All_reads* R_INF, 
                         UC_Read* g_read, Correct_dumy* dumy, UC_Read* overlap_read)
 {
@@ -2645,6 +2658,8 @@ inline void recalcate_window_advance(overlap_region_alloc* overlap_list, All_rea
     long long overlap_length;
     int extra_begin, extra_end;
     long long o_len;
+    long long group[PATH_GROUP_SIZE], group_x_len = 0;
+    int n_group, group_threshold = 0, group_size = Reserve_Banded_BPM_PATH_lanes();
 
 
     for (j = 0; j < (long long)overlap_list->length; j++)
@@ -2918,6 +2933,8 @@ inline void recalcate_window_advance(overlap_region_alloc* overlap_list, All_rea
         if (overlap_length * OVERLAP_THRESHOLD_FILTER <=  overlap_list->list[j].align_length)
         {
             
+            ///windows are independent here, so those needing a cigar are traced back in groups of the same length
+            n_group = 0;
             for (i = 0; i < (long long)overlap_list->list[j].w_list_length; i++)
             {
                 ///first we need to check if this window is matched
@@ -2930,16 +2947,16 @@ inline void recalcate_window_advance(overlap_region_alloc* overlap_list, All_rea
                         x_start = overlap_list->list[j].w_list[i].x_start;
                         x_end = overlap_list->list[j].w_list[i].x_end;
                         x_len = x_end - x_start + 1;
-                        /****************************may have bugs********************************/
-                        ///threshold = x_len * asm_opt.max_ov_diff_ec;
-                        threshold = overlap_list->list[j].w_list[i].error_threshold;
-                        /****************************may have bugs********************************/
-                        /****************************may have bugs********************************/
                         ///should not adjust threshold, since this window can be matched by the old threshold
-                        ///threshold = Adjust_Threshold(threshold, x_len);
-                        /****************************may have bugs********************************/
+                        threshold = overlap_list->list[j].w_list[i].error_threshold;
                         Window_Len = x_len + (threshold << 1);
 
+                        if (n_group > 0 && (n_group == group_size ||
+                        x_len != group_x_len || threshold != group_threshold))
+                        {
+                            recalcate_window_cigars(overlap_list, j, R_INF, g_read, dumy, group, n_group);
+                            n_group = 0;
+                        }
 
                         ///y_start is the real y_start
                         ///for the window with cigar, y_start has already reduced extra_begin
@@ -2947,56 +2964,19 @@ inline void recalcate_window_advance(overlap_region_alloc* overlap_list, All_rea
                         extra_begin = overlap_list->list[j].w_list[i].extra_begin;
                         extra_end = overlap_list->list[j].w_list[i].extra_end;
                         o_len = Window_Len - extra_end - extra_begin;
-                        fill_subregion(dumy->overlap_region, y_start, o_len, y_strand, 
+                        fill_subregion(dumy->overlap_region_group[n_group], y_start, o_len, y_strand, 
                         R_INF, y_id, extra_begin, extra_end);
-                        x_string = g_read->seq + x_start;
-                        y_string = dumy->overlap_region;
-
-
-                        ///note!!! need notification
-                        end_site = Reserve_Banded_BPM_PATH(y_string, Window_Len, x_string, x_len, threshold, &error, &real_y_start,
-                        &(dumy->path_length), dumy->matrix_bit, dumy->path, 
-                        overlap_list->list[j].w_list[i].error, overlap_list->list[j].w_list[i].y_end - y_start);
-
-                        if (error != (unsigned int)-1)
-                        {
-                            if (end_site == Window_Len - 1 || real_y_start == 0)
-                            {
-                                
-                                if(fix_boundary(x_string, x_len, threshold, y_start, real_y_start, end_site,
-                                extra_begin, extra_end, y_id, Window_Len, R_INF, dumy, y_strand, error,
-                                &y_start, &real_y_start, &end_site,
-                                &extra_begin, &extra_end, &error))
-                                {
-                                    overlap_list->list[j].w_list[i].error = error;
-                                    overlap_list->list[j].w_list[i].extra_begin = extra_begin;
-                                    overlap_list->list[j].w_list[i].extra_end = extra_end;
-                                }
-                                
-                            }
-
-                            generate_cigar(dumy->path, dumy->path_length, &(overlap_list->list[j].w_list[i]),
-                            &real_y_start, &end_site, &error, x_string, x_len, y_string);    
-
-                            ///note!!! need notification
-                            real_y_start = y_start + real_y_start - extra_begin;
-                            overlap_list->list[j].w_list[i].y_start = real_y_start;  
-                            overlap_list->list[j].w_list[i].y_end = y_start + end_site - extra_begin;
-                            overlap_list->list[j].w_list[i].error = error;                              
-                        }
-                        else
-                        {
-                            fprintf(stderr, "error\n");
-                        }
+                        group[n_group++] = i;
+                        group_x_len = x_len;
+                        group_threshold = threshold;
                     }
                     else
                     {
                         overlap_list->list[j].w_list[i].y_end -= overlap_list->list[j].w_list[i].extra_begin;
                     }
-
-
                 }
             }
+            if (n_group > 0) recalcate_window_cigars(overlap_list, j, R_INF, g_read, dumy, group, n_group);
 
             error_rate = non_trim_error_rate(overlap_list, j, R_INF, dumy, g_read);
             
@@ -7312,6 +7292,7 @@ void init_Correct_dumy(Correct_dumy* list)
     list->corrected_read_length = 0;
     list->corrected_read = (char*)malloc(sizeof(char)*list->corrected_read_size);
     list->corrected_base = 0;
+    list->matrix_bit_group = (Word*)malloc(sizeof(Word)*(WINDOW_MAX_SIZE + 10)*5*PATH_GROUP_SIZE);
 
 }
 
@@ -7319,6 +7300,7 @@ void destory_Correct_dumy(Correct_dumy* list)
 {
     free(list->overlapID);
     free(list->corrected_read);
+    free(list->matrix_bit_group);
 }
 
 void clear_Correct_dumy(Correct_dumy* list, overlap_region_alloc* overlap_list)
@@ -1028,6 +1028,9 @@ typedef struct
     char overlap_region_fix[WINDOW_MAX_SIZE + THRESHOLD_MAX_SIZE*2 + 10];
     Word matrix_bit[((WINDOW_MAX_SIZE + 10)<<3)];
     /****************************may have bugs********************************/
+    ///for windows traced back together by Reserve_Banded_BPM_PATH_N(); y strings go to overlap_region_group
+    char path_group[PATH_GROUP_SIZE][WINDOW_MAX_SIZE + THRESHOLD_MAX_SIZE*2 + 10];
+    Word* matrix_bit_group;
 
     int path_length;
     __m128i Peq_SSE[256];
@@ -9,6 +9,9 @@ pthread_mutex_t output_mutex;
 #define overlap_region_key(a) ((a).y_id)
 KRADIX_SORT_INIT(overlap_region_sort, overlap_region, overlap_region_key, member_size(overlap_region, y_id))
 
+#define chain64_key(x) (x)
+KRADIX_SORT_INIT(chain64, uint64_t, chain64_key, 8)
+
 void overlap_region_sort_y_id(overlap_region *a, long long n)
 {
 	radix_sort_overlap_region_sort(a, a + n);
@@ -373,18 +376,130 @@ int32_t ha_chain_check(k_mer_hit *a, int32_t n_a, Chain_Data *dp, int32_t min_sc
 	return n_a;
 }
 
+// score of chaining anchor $j to anchor $i; return 0 if they can't be chained
+static inline int ha_chain_sc(const k_mer_hit *a, const Chain_Data *dp, long long i, long long j, long long min_score,
+							  double bw_thres, double bw_pen, long long *sc, long long *indels, long long *self_length)
+{
+	long long distance_pos, distance_self_pos, distance_gap, distance_min, score;
+	double gap_rate;
+	distance_pos = (long long)a[i].offset - a[j].offset;
+	distance_self_pos = (long long)a[i].self_offset - a[j].self_offset;
+	///a has been sorted by a[].offset
+	///note for a, we do not have any two elements that have both equal offsets and self_offsets
+	///but there maybe two elements that have equal offsets or equal self_offsets
+	if (distance_pos == 0 || distance_self_pos <= 0) return 0;
+	distance_gap = distance_pos > distance_self_pos? distance_pos - distance_self_pos : distance_self_pos - distance_pos;
+	*indels = dp->indels[j] + distance_gap;
+	*self_length = dp->self_length[j] + distance_self_pos;
+	if (*indels > bw_thres * *self_length) return 0;
+	///min distance
+	distance_min = distance_pos < distance_self_pos? distance_pos:distance_self_pos;
+	score = distance_min < min_score? distance_min : min_score;
+	if (!a[j].good) score >>= 1;
+	gap_rate = (double)((double)(*indels)/(double)(*self_length));
+	///if the gap rate > 0.06, score will be negative
+	score -= (long long)(gap_rate * score * bw_pen);
+	*sc = score + dp->score[j];
+	return 1;
+}
+
+#define HA_CHAIN_SPARSE_N  10000 // use ha_chain_sparse() for this many anchors or more
+#define HA_CHAIN_LOOKBACK  1000  // anchors scanned backward by ha_chain_sparse()
+
+static inline uint64_t ha_chain_rmq(const uint64_t *t, int64_t n, int64_t l, int64_t r) // max of t[n+l..n+r]
+{
+	uint64_t x = 0;
+	for (l += n, r += n + 1; l < r; l >>= 1, r >>= 1) {
+		if (l&1) x = x > t[l]? x : t[l], ++l;
+		if (r&1) --r, x = x > t[r]? x : t[r];
+	}
+	return x;
+}
+
+/*
+ * Chaining for targets with many anchors, typically from repeats. As in
+ * chain_DP(), predecessors are scanned backward, but over at most
+ * HA_CHAIN_LOOKBACK anchors. Anchors further back are kept in a max segment
+ * tree keyed on the diagonal; the best of them within the band is tried as
+ * one more predecessor. This is O(n log n) and gives the same chains as
+ * chain_DP() unless a better predecessor is beyond the lookback and not the
+ * best on nearby diagonals.
+ */
+static void ha_chain_sparse(k_mer_hit *a, long long a_n, Chain_Data *dp, double bw_thres, int max_skip, long long min_score)
+{
+	long long i, j, m, score, total_indels, total_self_length;
+	double bw_pen = 1 / bw_thres;
+	uint64_t *srt, *t;
+	int32_t *rank;
+	MALLOC(srt, a_n); MALLOC(rank, a_n);
+	for (i = 0; i < a_n; ++i) // diagonals, shifted to be positive
+		srt[i] = (uint64_t)((long long)a[i].offset - a[i].self_offset + 0x80000000LL) << 32 | i;
+	radix_sort_chain64(srt, srt + a_n);
+	for (i = 0, m = -1; i < a_n; ++i) { // rank the diagonals and keep the distinct ones in srt[]
+		uint64_t d = srt[i]>>32;
+		uint32_t k = (uint32_t)srt[i];
+		if (m < 0 || srt[m] != d) srt[++m] = d;
+		rank[k] = m;
+	}
+	++m;
+	CALLOC(t, m * 2); // score<<32 | (index+1); 0 for empty
+
+	for (i = 0; i < a_n; ++i) dp->tmp[i] = -1;
+	for (i = 0; i < a_n; ++i) {
+		int n_chn_skip = 0, n_max_skip = 0;
+		long long max_j = -1, max_score = a[i].good? min_score : min_score>>1, max_indels = 0, max_self_length = 0;
+		for (j = i - 1; j >= 0 && j >= i - HA_CHAIN_LOOKBACK; --j) {
+			if (!ha_chain_sc(a, dp, i, j, min_score, bw_thres, bw_pen, &score, &total_indels, &total_self_length)) continue;
+			if (score > max_score) {
+				max_score = score, max_j = j;
+				max_indels = total_indels, max_self_length = total_self_length;
+				n_max_skip = 0;
+				if (n_chn_skip > 0) --n_chn_skip;
+			} else {
+				if (++n_max_skip > max_skip) break;
+				if (dp->tmp[j] == i && ++n_chn_skip > max_skip) break;
+			}
+			if (dp->pre[j] >= 0) dp->tmp[dp->pre[j]] = i;
+		}
+		if (i > HA_CHAIN_LOOKBACK) {
+			uint64_t x, d = srt[rank[i]], r = (uint64_t)(bw_thres * a[i].self_offset) + 1;
+			int64_t lo, hi, k, p;
+			j = i - HA_CHAIN_LOOKBACK - 1; // the anchor just out of the window
+			p = rank[j] + m, x = (uint64_t)(uint32_t)dp->score[j] << 32 | (j + 1);
+			if (t[p] < x) for (t[p] = x, p >>= 1; p > 0; p >>= 1) t[p] = t[p<<1] > t[p<<1|1]? t[p<<1] : t[p<<1|1];
+			for (lo = 0, hi = rank[i]; lo < hi;) { // the first diagonal >= d - r
+				k = (lo + hi) >> 1;
+				if (srt[k] + r < d) lo = k + 1; else hi = k;
+			}
+			for (k = lo, lo = rank[i], hi = m; lo < hi;) { // the first diagonal > d + r
+				int64_t mid = (lo + hi) >> 1;
+				if (srt[mid] <= d + r) lo = mid + 1; else hi = mid;
+			}
+			x = ha_chain_rmq(t, m, k, lo - 1);
+			if (x && ha_chain_sc(a, dp, i, (uint32_t)x - 1, min_score, bw_thres, bw_pen, &score, &total_indels, &total_self_length) && score > max_score) {
+				max_score = score, max_j = (uint32_t)x - 1;
+				max_indels = total_indels, max_self_length = total_self_length;
+			}
+		}
+		dp->score[i] = max_score;
+		dp->pre[i] = max_j;
+		dp->indels[i] = max_indels;
+		dp->self_length[i] = max_self_length;
+	}
+	free(srt); free(rank); free(t);
+}
+
 ///double band_width_threshold = 0.05;
 void chain_DP(k_mer_hit* a, long long a_n, Chain_Data* dp, overlap_region* result, 
               double band_width_threshold, int max_skip, int x_readLen, int y_readLen)
 {
     long long i, j;
-    long long self_pos, pos, max_j, max_i, max_score, score;
-    long long distance_pos, distance_self_pos, distance_gap,  distance_min;
+    long long max_j, max_i, max_score, score;
+    long long distance_pos, distance_self_pos, distance_gap;
     ///double band_width_threshold = 0.05;
     double band_width_penalty = 1 / band_width_threshold;
     long long min_score = asm_opt.k_mer_length;
     long long max_indels, max_self_length;
-    double gap_rate;
     long long total_indels, total_self_length;
 	int32_t ret;
     
@@ -395,6 +510,10 @@ void chain_DP(k_mer_hit* a, long long a_n, Chain_Data* dp, overlap_region* resul
 		a_n = ret;
 		goto skip_dp;
 	}
+	if (a_n >= HA_CHAIN_SPARSE_N) {
+		ha_chain_sparse(a, a_n, dp, band_width_threshold, max_skip, min_score);
+		goto skip_dp;
+	}
 
     // fill the score and backtrack arrays
 	for (i = 0; i < a_n; ++i) dp->tmp[i] = -1;
@@ -403,8 +522,6 @@ void chain_DP(k_mer_hit* a, long long a_n, Chain_Data* dp, overlap_region* resul
 		int n_chn_skip = 0;
 		int n_max_skip = 0;
 
-        pos = a[i].offset;
-        self_pos = a[i].self_offset;
         max_j = -1;
         max_score = a[i].good? min_score : min_score>>1;
         max_indels = 0;
@@ -413,36 +530,11 @@ void chain_DP(k_mer_hit* a, long long a_n, Chain_Data* dp, overlap_region* resul
         ///may have a pre-cut condition for j
         for (j = i - 1; j >= 0; --j) 
         {
-            distance_pos = pos - a[j].offset;
-            distance_self_pos = self_pos - a[j].self_offset;
-            ///a has been sorted by a[].offset
-            ///note for a, we do not have any two elements that have both equal offsets and self_offsets
-            ///but there maybe two elements that have equal offsets or equal self_offsets
-            if(distance_pos == 0 || distance_self_pos <= 0)
-            {
-                continue;
-            }
-
-            distance_gap = distance_pos > distance_self_pos? distance_pos - distance_self_pos : distance_self_pos - distance_pos;
-            
-            total_indels = dp->indels[j] + distance_gap;
-            total_self_length = dp->self_length[j] + distance_self_pos;
-            if(total_indels > band_width_threshold * total_self_length)
+            if (!ha_chain_sc(a, dp, i, j, min_score, band_width_threshold, band_width_penalty, &score, &total_indels, &total_self_length))
             {
                 continue;
             }
 
-            ///min distance
-            distance_min = distance_pos < distance_self_pos? distance_pos:distance_self_pos;
-            score = distance_min < min_score? distance_min : min_score;
-			if (!a[j].good) score >>= 1;
-
-            gap_rate = (double)((double)(total_indels)/(double)(total_self_length));
-            ///if the gap rate > 0.06, score will be negative
-            score -= (long long)(gap_rate * score * band_width_penalty);
-
-            score += dp->score[j];
-
 			///find a new max score
 			if (score > max_score) {
 				max_score = score;
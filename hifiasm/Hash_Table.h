@@ -14,7 +14,10 @@
 #define OVERLAP_THRESHOLD_FILTER 0.9
 #define THRESHOLD_MAX_SIZE  31
 
-#define GROUP_SIZE 4
+///max number of windows verified together; the actual number depends on SIMD support
+#define GROUP_SIZE 16
+///max number of windows traced back together (64-bit lanes)
+#define PATH_GROUP_SIZE 8
 ///the max cigar likes 10M10D10M10D10M
 ///#define CIGAR_MAX_LENGTH THRESHOLD*2+2
 #define CIGAR_MAX_LENGTH 31*2+4
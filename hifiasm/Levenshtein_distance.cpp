@@ -1 +1,441 @@
+#include <assert.h>
 #include "Levenshtein_distance.h"
+#include "Correct.h"
+
+/*
+ * Wide variants of Reserve_Banded_BPM_4_SSE_only(): up to 8 (AVX2) or 16
+ * (AVX-512) patterns of the same length are verified against one text in a
+ * single pass, one 32-bit lane per pattern. They are compiled for their own
+ * targets and only called when the CPU supports them, so the rest of the
+ * binary keeps the baseline instruction set.
+ *
+ * Instead of OR-ing one lane mask per pattern into Peq at each step, the
+ * patterns are transposed so that each position is one column of bases; the
+ * update is then four compares regardless of the number of lanes. Unused
+ * lanes repeat the first pattern and start with an error above the cutoff so
+ * they never delay the early exit. Windows with Ns never get here (see
+ * Reserve_Banded_BPM_N_SIMD()), so a base c is indexed by (c>>1)&3.
+ */
+
+#define BPM_W_LEN (WINDOW_MAX_SIZE + THRESHOLD_MAX_SIZE*2 + 10)
+#define bpm_code(c) (((uint8_t)(c) >> 1) & 3)
+
+static const char bpm_base[4] = { 'A', 'C', 'T', 'G' }; // inverse of bpm_code()
+
+// col[k*w+j] = pattern[j][k] for k < p_length; w is 4, 8 or 16
+static void bpm_transpose(char **pattern, int n, int w, int p_length, uint8_t *col)
+{
+	const char *row[16];
+	int j, k;
+	for (j = 0; j < 16; ++j) row[j] = pattern[j < n? j : 0];
+	for (k = 0; k + 16 <= p_length; k += 16) { // 16x16 bytes with SSE2
+		__m128i a[16], b[16];
+		for (j = 0; j < 16; ++j) a[j] = _mm_loadu_si128((const __m128i*)(row[j] + k));
+		for (j = 0; j < 8; ++j) b[j*2] = _mm_unpacklo_epi8(a[j*2], a[j*2+1]), b[j*2+1] = _mm_unpackhi_epi8(a[j*2], a[j*2+1]);
+		for (j = 0; j < 4; ++j) {
+			a[j*4]   = _mm_unpacklo_epi16(b[j*4],   b[j*4+2]), a[j*4+1] = _mm_unpackhi_epi16(b[j*4],   b[j*4+2]);
+			a[j*4+2] = _mm_unpacklo_epi16(b[j*4+1], b[j*4+3]), a[j*4+3] = _mm_unpackhi_epi16(b[j*4+1], b[j*4+3]);
+		}
+		for (j = 0; j < 2; ++j) {
+			int i;
+			for (i = 0; i < 4; ++i) {
+				b[j*8+i*2]   = _mm_unpacklo_epi32(a[j*8+i], a[j*8+i+4]);
+				b[j*8+i*2+1] = _mm_unpackhi_epi32(a[j*8+i], a[j*8+i+4]);
+			}
+		}
+		// b[j] and b[j+8] hold positions j*2 and j*2+1 of rows 0-7 and 8-15, respectively
+		for (j = 0; j < 8; ++j) {
+			__m128i lo = _mm_unpacklo_epi64(b[j], b[j+8]), hi = _mm_unpackhi_epi64(b[j], b[j+8]);
+			if (w == 16) {
+				_mm_storeu_si128((__m128i*)&col[(k + j*2) * 16], lo);
+				_mm_storeu_si128((__m128i*)&col[(k + j*2 + 1) * 16], hi);
+			} else if (w == 4) {
+				int32_t x = _mm_cvtsi128_si32(lo), y = _mm_cvtsi128_si32(hi);
+				memcpy(&col[(k + j*2) * 4], &x, 4);
+				memcpy(&col[(k + j*2 + 1) * 4], &y, 4);
+			} else {
+				_mm_storel_epi64((__m128i*)&col[(k + j*2) * 8], lo);
+				_mm_storel_epi64((__m128i*)&col[(k + j*2 + 1) * 8], hi);
+			}
+		}
+	}
+	for (; k < p_length; ++k)
+		for (j = 0; j < w; ++j)
+			col[k * w + j] = row[j][k];
+}
+
+// the last row of the band, as at the end of Reserve_Banded_BPM_4_SSE_only()
+static void bpm_set_sites(const Word_32 *err, const Word_32 *vp, const Word_32 *vn, int n, int site, int available_i,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold)
+{
+	int i, j, e;
+	for (j = 0; j < n; ++j) {
+		unsigned int ungap_error = (unsigned int)-1;
+		e = err[j];
+		if (e <= (int)errthold)
+			return_sites[j] = site, return_sites_error[j] = e;
+		for (i = 0; i < available_i; ) {
+			e += (vp[j] >> i & 1) - (vn[j] >> i & 1);
+			++i;
+			if (e <= (int)errthold && (unsigned int)e <= return_sites_error[j])
+				return_sites[j] = site + i, return_sites_error[j] = e;
+			if (i == (int)errthold) ungap_error = e;
+		}
+		if (ungap_error <= errthold && ungap_error == return_sites_error[j])
+			return_sites[j] = site + errthold;
+	}
+}
+
+__attribute__((target("avx2")))
+static int bpm_8_avx2(char **pattern, int n, int p_length, char *text, int t_length,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold)
+{
+	uint8_t col[BPM_W_LEN * 8];
+	Word_32 err0[8], vp[8], vn[8];
+	__m256i Peq[4], VP, VN, X, D0, HN, HP, Err, Mask, pre_end, ones, for_not, c;
+	int i, i_bd = errthold << 1, k, j;
+
+	bpm_transpose(pattern, n, 8, p_length, col);
+	for (j = 0; j < 8; ++j) err0[j] = j < n? 0 : 3 * errthold + 1;
+	for (k = 0; k < 4; ++k) Peq[k] = _mm256_setzero_si256();
+	for (i = 0; i <= i_bd; ++i) {
+		c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&col[i * 8]));
+		for (k = 0; k < 4; ++k)
+			Peq[k] = _mm256_or_si256(Peq[k], _mm256_and_si256(_mm256_cmpeq_epi32(c, _mm256_set1_epi32(bpm_base[k])), _mm256_set1_epi32(1U << i)));
+	}
+	Err = _mm256_loadu_si256((const __m256i*)err0);
+	VP = VN = _mm256_setzero_si256();
+	Mask = _mm256_set1_epi32((Word_32)1 << (errthold << 1));
+	pre_end = _mm256_set1_epi32(3 * errthold);
+	ones = _mm256_set1_epi32(1);
+	for_not = _mm256_set1_epi32(-1);
+	for (i = 0; i < t_length; ++i) {
+		X = _mm256_or_si256(Peq[bpm_code(text[i])], VN);
+		D0 = _mm256_or_si256(_mm256_xor_si256(_mm256_add_epi32(_mm256_and_si256(X, VP), VP), VP), X);
+		HN = _mm256_and_si256(D0, VP);
+		HP = _mm256_or_si256(_mm256_andnot_si256(_mm256_or_si256(D0, VP), for_not), VN);
+		X = _mm256_srli_epi32(D0, 1);
+		VN = _mm256_and_si256(X, HP);
+		VP = _mm256_or_si256(HN, _mm256_andnot_si256(_mm256_or_si256(X, HP), for_not));
+		Err = _mm256_sub_epi32(_mm256_add_epi32(Err, ones), _mm256_and_si256(D0, ones));
+		if (_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(Err, pre_end))) == 0xff)
+			return 1;
+		if (i == t_length - 1) break;
+		++i_bd;
+		c = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)&col[i_bd * 8]));
+		for (k = 0; k < 4; ++k) {
+			Peq[k] = _mm256_srli_epi32(Peq[k], 1);
+			Peq[k] = _mm256_or_si256(Peq[k], _mm256_and_si256(_mm256_cmpeq_epi32(c, _mm256_set1_epi32(bpm_base[k])), Mask));
+		}
+	}
+	_mm256_storeu_si256((__m256i*)err0, Err);
+	_mm256_storeu_si256((__m256i*)vp, VP);
+	_mm256_storeu_si256((__m256i*)vn, VN);
+	bpm_set_sites(err0, vp, vn, n, t_length - 1, p_length - t_length, return_sites, return_sites_error, errthold);
+	return 1;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized" // false positives in avx512fintrin.h of gcc-12
+#pragma GCC diagnostic ignored "-Wuninitialized"
+__attribute__((target("avx512f")))
+static int bpm_16_avx512(char **pattern, int n, int p_length, char *text, int t_length,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold)
+{
+	uint8_t col[BPM_W_LEN * 16];
+	Word_32 err0[16], vp[16], vn[16];
+	__m512i Peq[4], VP, VN, X, D0, HN, HP, Err, Mask, pre_end, ones, for_not, c;
+	int i, i_bd = errthold << 1, k, j;
+
+	bpm_transpose(pattern, n, 16, p_length, col);
+	for (j = 0; j < 16; ++j) err0[j] = j < n? 0 : 3 * errthold + 1;
+	for (k = 0; k < 4; ++k) Peq[k] = _mm512_setzero_si512();
+	for (i = 0; i <= i_bd; ++i) {
+		c = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&col[i * 16]));
+		for (k = 0; k < 4; ++k)
+			Peq[k] = _mm512_mask_or_epi32(Peq[k], _mm512_cmpeq_epi32_mask(c, _mm512_set1_epi32(bpm_base[k])), Peq[k], _mm512_set1_epi32(1U << i));
+	}
+	Err = _mm512_loadu_si512(err0);
+	VP = VN = _mm512_setzero_si512();
+	Mask = _mm512_set1_epi32((Word_32)1 << (errthold << 1));
+	pre_end = _mm512_set1_epi32(3 * errthold);
+	ones = _mm512_set1_epi32(1);
+	for_not = _mm512_set1_epi32(-1);
+	for (i = 0; i < t_length; ++i) {
+		X = _mm512_or_si512(Peq[bpm_code(text[i])], VN);
+		D0 = _mm512_or_si512(_mm512_xor_si512(_mm512_add_epi32(_mm512_and_si512(X, VP), VP), VP), X);
+		HN = _mm512_and_si512(D0, VP);
+		HP = _mm512_or_si512(_mm512_andnot_si512(_mm512_or_si512(D0, VP), for_not), VN);
+		X = _mm512_srli_epi32(D0, 1);
+		VN = _mm512_and_si512(X, HP);
+		VP = _mm512_or_si512(HN, _mm512_andnot_si512(_mm512_or_si512(X, HP), for_not));
+		Err = _mm512_sub_epi32(_mm512_add_epi32(Err, ones), _mm512_and_si512(D0, ones));
+		if (_mm512_cmpgt_epi32_mask(Err, pre_end) == 0xffff)
+			return 1;
+		if (i == t_length - 1) break;
+		++i_bd;
+		c = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)&col[i_bd * 16]));
+		for (k = 0; k < 4; ++k) {
+			Peq[k] = _mm512_srli_epi32(Peq[k], 1);
+			Peq[k] = _mm512_mask_or_epi32(Peq[k], _mm512_cmpeq_epi32_mask(c, _mm512_set1_epi32(bpm_base[k])), Peq[k], Mask);
+		}
+	}
+	_mm512_storeu_si512(err0, Err);
+	_mm512_storeu_si512(vp, VP);
+	_mm512_storeu_si512(vn, VN);
+	bpm_set_sites(err0, vp, vn, n, t_length - 1, p_length - t_length, return_sites, return_sites_error, errthold);
+	return 1;
+}
+#pragma GCC diagnostic pop
+
+int Reserve_Banded_BPM_lanes(void)
+{
+	static int lanes = 0;
+	if (lanes == 0) {
+		__builtin_cpu_init();
+		lanes = __builtin_cpu_supports("avx512f")? 16 : __builtin_cpu_supports("avx2")? 8 : 4;
+	}
+	return lanes;
+}
+
+static int bpm_has_N(char **pattern, int n, int p_length, char *text, int t_length)
+{
+	int j;
+	if (memchr(text, 'N', t_length)) return 1;
+	for (j = 0; j < n; ++j)
+		if (memchr(pattern[j], 'N', p_length)) return 1;
+	return 0;
+}
+
+/*
+ * Reserve_Banded_BPM_4_SSE_only() matches N through Peq_SSE['N'], which is
+ * never reset or shifted and thus depends on previous calls. To keep results
+ * unchanged, windows with Ns still go through it four at a time, as verify_window()
+ * used to group them; a single trailing window goes to Reserve_Banded_BPM().
+ */
+static int bpm_4_SSE_groups(char **pattern, int n, int p_length, char *text, int t_length,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold, __m128i* Peq_SSE)
+{
+	int j;
+	for (j = 0; j < n; j += 4) {
+		if (n - j == 1) {
+			return_sites[j] = Reserve_Banded_BPM(pattern[j], p_length, text, t_length, errthold, &return_sites_error[j]);
+		} else {
+			int sites[4];
+			unsigned int sites_error[4];
+			Reserve_Banded_BPM_4_SSE_only(pattern[j], pattern[j+1], pattern[j+2], pattern[j+3], p_length, text, t_length,
+					sites, sites_error, errthold, Peq_SSE);
+			memcpy(&return_sites[j], sites, sizeof(int) * (n - j < 4? n - j : 4));
+			memcpy(&return_sites_error[j], sites_error, sizeof(unsigned int) * (n - j < 4? n - j : 4));
+		}
+	}
+	return 1;
+}
+
+int Reserve_Banded_BPM_N_SIMD(char **pattern, int n, int p_length, char *text, int t_length,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold, __m128i* Peq_SSE)
+{
+	assert(n <= Reserve_Banded_BPM_lanes());
+	memset(return_sites, -1, sizeof(int) * n);
+	memset(return_sites_error, -1, sizeof(unsigned int) * n);
+	if (n <= 4 || bpm_has_N(pattern, n, p_length, text, t_length))
+		return bpm_4_SSE_groups(pattern, n, p_length, text, t_length, return_sites, return_sites_error, errthold, Peq_SSE);
+	if (n > 8 && Reserve_Banded_BPM_lanes() >= 16)
+		return bpm_16_avx512(pattern, n, p_length, text, t_length, return_sites, return_sites_error, errthold);
+	return bpm_8_avx2(pattern, n, p_length, text, t_length, return_sites, return_sites_error, errthold);
+}
+
+/*
+ * Batched Reserve_Banded_BPM_PATH(): the forward pass of up to 4 (AVX2) or 8
+ * (AVX-512) windows, each with its own pattern and text but the same lengths
+ * and threshold, runs in one 64-bit lane per window. D0, VP, VN, HP and HN of
+ * column i, lane j are kept at matrix_bit[(i*BPM_PATH_C + k)*w + j], i.e. five
+ * vector stores per column; the traceback is then the scalar one
+ * (Reserve_Banded_BPM_PATH_trace()) reading every w-th word. A lane that
+ * exceeds 3*errthold is failed, as the scalar version returns early then.
+ *
+ * Both pattern and text are transposed as in bpm_8_avx2(), so a text base
+ * selects its Peq vector with four compares. Ns in the text are matched
+ * through Peq['N'] in the scalar version, which also picks up the Ns of the
+ * pattern; lanes that have Ns in both go through Reserve_Banded_BPM_PATH().
+ */
+
+#define BPM_PATH_C 5
+
+__attribute__((target("avx2")))
+static inline __m256i bpm_load4(const uint8_t *p)
+{
+	int32_t x;
+	memcpy(&x, p, 4);
+	return _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(x));
+}
+
+__attribute__((target("avx2")))
+static void bpm_path_4_avx2(char **pattern, char **text, int n, int t_length, unsigned short errthold,
+	Word *err, Word *vp, Word *vn, Word *matrix_bit)
+{
+	uint8_t pcol[BPM_W_LEN * 4], tcol[BPM_W_LEN * 4];
+	__m256i Peq[4], base[4], VP, VN, X, D0, HN, HP, Err, Mask, pre_end, ones, for_not, c, *m;
+	int i, i_bd = errthold << 1, k, j;
+
+	bpm_transpose(pattern, n, 4, t_length + i_bd, pcol);
+	bpm_transpose(text, n, 4, t_length, tcol);
+	for (j = 0; j < 4; ++j) err[j] = j < n? 0 : 3 * errthold + 1;
+	for (k = 0; k < 4; ++k) Peq[k] = _mm256_setzero_si256(), base[k] = _mm256_set1_epi64x(bpm_base[k]);
+	for (i = 0; i <= i_bd; ++i) {
+		c = bpm_load4(&pcol[i * 4]);
+		for (k = 0; k < 4; ++k)
+			Peq[k] = _mm256_or_si256(Peq[k], _mm256_and_si256(_mm256_cmpeq_epi64(c, base[k]), _mm256_set1_epi64x((Word)1 << i)));
+	}
+	Err = _mm256_loadu_si256((const __m256i*)err);
+	VP = VN = _mm256_setzero_si256();
+	Mask = _mm256_set1_epi64x((Word)1 << (errthold << 1));
+	pre_end = _mm256_set1_epi64x(3 * errthold);
+	ones = _mm256_set1_epi64x(1);
+	for_not = _mm256_set1_epi64x(-1);
+	for (i = 0; i < t_length; ++i) {
+		c = bpm_load4(&tcol[i * 4]);
+		X = VN;
+		for (k = 0; k < 4; ++k)
+			X = _mm256_or_si256(X, _mm256_and_si256(_mm256_cmpeq_epi64(c, base[k]), Peq[k]));
+		D0 = _mm256_or_si256(_mm256_xor_si256(_mm256_add_epi64(_mm256_and_si256(X, VP), VP), VP), X);
+		HN = _mm256_and_si256(D0, VP);
+		HP = _mm256_or_si256(_mm256_andnot_si256(_mm256_or_si256(D0, VP), for_not), VN);
+		X = _mm256_srli_epi64(D0, 1);
+		VN = _mm256_and_si256(X, HP);
+		VP = _mm256_or_si256(HN, _mm256_andnot_si256(_mm256_or_si256(X, HP), for_not));
+		Err = _mm256_sub_epi64(_mm256_add_epi64(Err, ones), _mm256_and_si256(D0, ones));
+		if (_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(Err, pre_end))) == 0xf)
+			break;
+		m = (__m256i*)&matrix_bit[(i + 1) * BPM_PATH_C * 4];
+		_mm256_storeu_si256(m, D0);
+		_mm256_storeu_si256(m + 1, VP);
+		_mm256_storeu_si256(m + 2, VN);
+		_mm256_storeu_si256(m + 3, HP);
+		_mm256_storeu_si256(m + 4, HN);
+		if (i == t_length - 1) break;
+		++i_bd;
+		c = bpm_load4(&pcol[i_bd * 4]);
+		for (k = 0; k < 4; ++k) {
+			Peq[k] = _mm256_srli_epi64(Peq[k], 1);
+			Peq[k] = _mm256_or_si256(Peq[k], _mm256_and_si256(_mm256_cmpeq_epi64(c, base[k]), Mask));
+		}
+	}
+	_mm256_storeu_si256((__m256i*)err, Err);
+	_mm256_storeu_si256((__m256i*)vp, VP);
+	_mm256_storeu_si256((__m256i*)vn, VN);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+__attribute__((target("avx512f")))
+static void bpm_path_8_avx512(char **pattern, char **text, int n, int t_length, unsigned short errthold,
+	Word *err, Word *vp, Word *vn, Word *matrix_bit)
+{
+	uint8_t pcol[BPM_W_LEN * 8], tcol[BPM_W_LEN * 8];
+	__m512i Peq[4], base[4], VP, VN, X, D0, HN, HP, Err, Mask, pre_end, ones, for_not, c;
+	Word *m;
+	int i, i_bd = errthold << 1, k, j;
+
+	bpm_transpose(pattern, n, 8, t_length + i_bd, pcol);
+	bpm_transpose(text, n, 8, t_length, tcol);
+	for (j = 0; j < 8; ++j) err[j] = j < n? 0 : 3 * errthold + 1;
+	for (k = 0; k < 4; ++k) Peq[k] = _mm512_setzero_si512(), base[k] = _mm512_set1_epi64(bpm_base[k]);
+	for (i = 0; i <= i_bd; ++i) {
+		c = _mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i*)&pcol[i * 8]));
+		for (k = 0; k < 4; ++k)
+			Peq[k] = _mm512_mask_or_epi64(Peq[k], _mm512_cmpeq_epi64_mask(c, base[k]), Peq[k], _mm512_set1_epi64((Word)1 << i));
+	}
+	Err = _mm512_loadu_si512(err);
+	VP = VN = _mm512_setzero_si512();
+	Mask = _mm512_set1_epi64((Word)1 << (errthold << 1));
+	pre_end = _mm512_set1_epi64(3 * errthold);
+	ones = _mm512_set1_epi64(1);
+	for_not = _mm512_set1_epi64(-1);
+	for (i = 0; i < t_length; ++i) {
+		c = _mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i*)&tcol[i * 8]));
+		X = VN;
+		for (k = 0; k < 4; ++k)
+			X = _mm512_mask_or_epi64(X, _mm512_cmpeq_epi64_mask(c, base[k]), X, Peq[k]);
+		D0 = _mm512_or_si512(_mm512_xor_si512(_mm512_add_epi64(_mm512_and_si512(X, VP), VP), VP), X);
+		HN = _mm512_and_si512(D0, VP);
+		HP = _mm512_or_si512(_mm512_andnot_si512(_mm512_or_si512(D0, VP), for_not), VN);
+		X = _mm512_srli_epi64(D0, 1);
+		VN = _mm512_and_si512(X, HP);
+		VP = _mm512_or_si512(HN, _mm512_andnot_si512(_mm512_or_si512(X, HP), for_not));
+		Err = _mm512_sub_epi64(_mm512_add_epi64(Err, ones), _mm512_and_si512(D0, ones));
+		if (_mm512_cmpgt_epi64_mask(Err, pre_end) == 0xff)
+			break;
+		m = &matrix_bit[(i + 1) * BPM_PATH_C * 8];
+		_mm512_storeu_si512(m, D0);
+		_mm512_storeu_si512(m + 8, VP);
+		_mm512_storeu_si512(m + 16, VN);
+		_mm512_storeu_si512(m + 24, HP);
+		_mm512_storeu_si512(m + 32, HN);
+		if (i == t_length - 1) break;
+		++i_bd;
+		c = _mm512_cvtepu8_epi64(_mm_loadl_epi64((const __m128i*)&pcol[i_bd * 8]));
+		for (k = 0; k < 4; ++k) {
+			Peq[k] = _mm512_srli_epi64(Peq[k], 1);
+			Peq[k] = _mm512_mask_or_epi64(Peq[k], _mm512_cmpeq_epi64_mask(c, base[k]), Peq[k], Mask);
+		}
+	}
+	_mm512_storeu_si512(err, Err);
+	_mm512_storeu_si512(vp, VP);
+	_mm512_storeu_si512(vn, VN);
+}
+#pragma GCC diagnostic pop
+
+int Reserve_Banded_BPM_PATH_lanes(void)
+{
+	int lanes = Reserve_Banded_BPM_lanes();
+	return lanes >= 16? 8 : lanes >= 8? 4 : 1;
+}
+
+int Reserve_Banded_BPM_PATH_N(char **pattern, char **text, int n, int p_length, int t_length, unsigned short errthold,
+	int *old_error, int *old_end_site, int *return_sites, unsigned int *return_err,
+	int *return_start_site, int *return_path_length, Word *matrix_bit, char **path)
+{
+	char *q_pattern[PATH_GROUP_SIZE], *q_text[PATH_GROUP_SIZE];
+	Word err[PATH_GROUP_SIZE], vp[PATH_GROUP_SIZE], vn[PATH_GROUP_SIZE];
+	int q[PATH_GROUP_SIZE], m = 0, j, k, w;
+
+	assert(n <= Reserve_Banded_BPM_PATH_lanes());
+	for (j = 0; j < n; ++j) {
+		return_sites[j] = -1, return_err[j] = (unsigned int)-1;
+		if (old_error[j] != -1 && old_end_site[j] != -1) { // the shortcuts at the beginning of Reserve_Banded_BPM_PATH()
+			if (old_error[j] == 0) {
+				return_err[j] = 0, return_sites[j] = old_end_site[j];
+				return_start_site[j] = old_end_site[j] - t_length + 1;
+				continue;
+			}
+			if (try_cigar(pattern[j], p_length, text[j], t_length, old_end_site[j], path[j],
+					old_error[j], &return_start_site[j], &return_path_length[j])) {
+				return_err[j] = old_error[j], return_sites[j] = old_end_site[j];
+				continue;
+			}
+		}
+		if (memchr(text[j], 'N', t_length) && memchr(pattern[j], 'N', t_length + (errthold << 1))) {
+			return_sites[j] = Reserve_Banded_BPM_PATH(pattern[j], p_length, text[j], t_length, errthold, &return_err[j],
+					&return_start_site[j], &return_path_length[j], matrix_bit, path[j], -1, -1);
+			continue;
+		}
+		q[m] = j, q_pattern[m] = pattern[j], q_text[m] = text[j], ++m;
+	}
+	if (m == 1) {
+		j = q[0];
+		return_sites[j] = Reserve_Banded_BPM_PATH(pattern[j], p_length, text[j], t_length, errthold, &return_err[j],
+				&return_start_site[j], &return_path_length[j], matrix_bit, path[j], -1, -1);
+	} else if (m > 1) {
+		if (m > 4) bpm_path_8_avx512(q_pattern, q_text, m, t_length, errthold, err, vp, vn, matrix_bit), w = 8;
+		else bpm_path_4_avx2(q_pattern, q_text, m, t_length, errthold, err, vp, vn, matrix_bit), w = 4;
+		for (k = 0; k < m; ++k) {
+			if (err[k] > (Word)(3 * errthold)) continue;
+			j = q[k];
+			return_sites[j] = Reserve_Banded_BPM_PATH_trace(p_length, t_length, errthold, (int)err[k], vp[k], vn[k], &return_err[j],
+					&return_start_site[j], &return_path_length[j], matrix_bit + k, BPM_PATH_C, w, path[j]);
+		}
+	}
+	return n;
+}
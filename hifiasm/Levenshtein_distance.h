@@ -507,181 +507,16 @@ inline int try_cigar(char *pattern, int p_length,
 
 
 
-///p_length might be samller than t_length + 2 * errthold
-inline int Reserve_Banded_BPM_PATH
-(char *pattern, int p_length, char *text, int t_length, unsigned short errthold, 
-		unsigned int* return_err, int* return_start_site, int* return_path_length, Word* matrix_bit, char* path, 
-		int old_error, int old_end_site)
+///the band-end scan and traceback of Reserve_Banded_BPM_PATH(), given err, VP and VN after the last column;
+///D0, VP, VN, HP and HN of column i are at matrix_bit[(i*c_stride + 0..4)*l_stride]
+inline int Reserve_Banded_BPM_PATH_trace(int p_length, int t_length, unsigned short errthold, int err, Word VP, Word VN,
+		unsigned int* return_err, int* return_start_site, int* return_path_length,
+		const Word* matrix_bit, int c_stride, int l_stride, char* path)
 {
-	if (old_error != -1 && old_end_site != -1)
-	{
-		if (old_error == 0)
-		{
-			(*return_err) = old_error;
-			(*return_start_site) = old_end_site - t_length + 1;
-			return old_end_site;
-		}
-
-		if (try_cigar(pattern, p_length, text, t_length, old_end_site, path,
-		old_error, return_start_site, return_path_length))
-		{
-			(*return_err) = old_error;
-			return old_end_site;
-		}
-		
-	}
-	
-	(*return_err) = (unsigned int)-1;
-
-	Word Peq[256];
-
+	int i;
 	int band_length = (errthold << 1) + 1;
-	int i = 0;
-	Word tmp_Peq_1 = (Word)1;
-
-	Peq[(uint8_t)'A'] = (Word)0;
-	Peq[(uint8_t)'T'] = (Word)0;
-	Peq[(uint8_t)'G'] = (Word)0;
-	Peq[(uint8_t)'C'] = (Word)0;
-
-
-	Word Peq_A;
-	Word Peq_T;
-	Word Peq_C;
-	Word Peq_G;
-
-	///band_length = 2k + 1
-	for (i = 0; i<band_length; i++)
-	{
-		Peq[(uint8_t)pattern[i]] = Peq[(uint8_t)pattern[i]] | tmp_Peq_1;
-		tmp_Peq_1 = tmp_Peq_1 << 1;
-	}
-
-	///Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] | Peq[(uint8_t)'C'];
-
-	Peq_A = Peq[(uint8_t)'A'];
-	Peq_C = Peq[(uint8_t)'C'];
-	Peq_T = Peq[(uint8_t)'T'];
-	Peq_G = Peq[(uint8_t)'G'];
-
-
-	memset(Peq, 0, sizeof(Word)* 256);
-
-
-	Peq[(uint8_t)'A'] = Peq_A;
-	Peq[(uint8_t)'C'] = Peq_C;
-	Peq[(uint8_t)'T'] = Peq_T;
-	Peq[(uint8_t)'G'] = Peq_G;
-
-
-	
-
-	Word Mask = ((Word)1 << (errthold << 1));
-
-	Word VP = 0;
-	Word VN = 0;
-	Word X = 0;
-	Word D0 = 0;
-	Word HN = 0;
-	Word HP = 0;
-
-
-	i = 0;
-
-	Word column_start;
-
-	int err = 0;
-
 	Word err_mask = (Word)1;
 
-
-	///band_down = 2k
-	///i_bd = 2k
-	///int i_bd = i + band_down;
-	int i_bd = (errthold << 1);
-
-
-	int last_high = (errthold << 1);
-
-
-	/// t_length_1 = SEQ_LENGTH - 1
-	int t_length_1 = t_length - 1;
-	//while(i<t_length)
-
-	while (i<t_length_1)
-	{
-		///pattern[0]ÔÚPeq[2k], ¶øpattern[2k]ÔÚPeq[0]
-		X = Peq[(uint8_t)text[i]] | VN;
-
-		D0 = ((VP + (X&VP)) ^ VP) | X;
-
-		HN = VP&D0;
-		HP = VN | ~(VP | D0);
-
-		X = D0 >> 1;
-		VN = X&HP;
-		VP = HN | ~(X | HP);
-
-		if (!(D0&err_mask))
-		{
-			++err;
-
-			if ((err - last_high)>(int)errthold)
-			{
-				return -1;
-			}
-				
-		}
-
-
-		Peq[(uint8_t)'A'] = Peq[(uint8_t)'A'] >> 1;
-		Peq[(uint8_t)'C'] = Peq[(uint8_t)'C'] >> 1;
-		Peq[(uint8_t)'G'] = Peq[(uint8_t)'G'] >> 1;
-		Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] >> 1;
-
-
-		++i;
-		++i_bd;
-		Peq[(uint8_t)pattern[i_bd]] = Peq[(uint8_t)pattern[i_bd]] | Mask;
-
-
-		///Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] | Peq[(uint8_t)'C'];
-
-		column_start = i << 3;
-		matrix_bit[column_start] = D0;
-		matrix_bit[column_start + 1] = VP;
-		matrix_bit[column_start + 2] = VN;
-		matrix_bit[column_start + 3] = HP;
-		matrix_bit[column_start + 4] = HN;
-	}
-
-
-
-
-
-	X = Peq[(uint8_t)text[i]] | VN;
-	D0 = ((VP + (X&VP)) ^ VP) | X;
-	HN = VP&D0;
-	HP = VN | ~(VP | D0);
-	X = D0 >> 1;
-	VN = X&HP;
-	VP = HN | ~(X | HP);
-	if (!(D0&err_mask))
-	{
-		++err;
-		if ((err - last_high)>(int)errthold)
-			return -1;
-	}
-
-
-	column_start = (i + 1) << 3;
-	matrix_bit[column_start] = D0;
-	matrix_bit[column_start + 1] = VP;
-	matrix_bit[column_start + 2] = VN;
-	matrix_bit[column_start + 3] = HP;
-	matrix_bit[column_start + 4] = HN;
-
-
 	////fprintf(stderr, "sucess(2)\n");
 
 	/// last_high = 2k
@@ -766,18 +601,16 @@ inline int Reserve_Banded_BPM_PATH
 			break;
 		}
 
-		column_start = i << 3;
-
 		delta_value = current_value -
-			((~(matrix_bit[column_start] >> back_track_site))&err_mask);
+			((~(matrix_bit[i*c_stride*l_stride] >> back_track_site))&err_mask);
 
 
 		if (back_track_site == 0)
 		{
 			///HP
-			h_value = current_value - ((matrix_bit[column_start + 3] >> back_track_site)&err_mask);
+			h_value = current_value - ((matrix_bit[(i*c_stride + 3)*l_stride] >> back_track_site)&err_mask);
 			//HN
-			h_value = h_value + ((matrix_bit[column_start + 4] >> back_track_site)&err_mask);
+			h_value = h_value + ((matrix_bit[(i*c_stride + 4)*l_stride] >> back_track_site)&err_mask);
 
 
 			min_value = delta_value;
@@ -792,8 +625,8 @@ inline int Reserve_Banded_BPM_PATH
 		}
 		else if (back_track_site == low_bound)
 		{
-			v_value = current_value - ((matrix_bit[column_start + 1] >> (back_track_site - 1))&err_mask);
-			v_value = v_value + ((matrix_bit[column_start + 2] >> (back_track_site - 1))&err_mask);
+			v_value = current_value - ((matrix_bit[(i*c_stride + 1)*l_stride] >> (back_track_site - 1))&err_mask);
+			v_value = v_value + ((matrix_bit[(i*c_stride + 2)*l_stride] >> (back_track_site - 1))&err_mask);
 
 			min_value = delta_value;
 			direction = 0;
@@ -808,14 +641,14 @@ inline int Reserve_Banded_BPM_PATH
 		else
 		{
 
-			h_value = current_value - ((matrix_bit[column_start + 3] >> back_track_site)&(Word)1);
+			h_value = current_value - ((matrix_bit[(i*c_stride + 3)*l_stride] >> back_track_site)&(Word)1);
 
 
-			h_value = h_value + ((matrix_bit[column_start + 4] >> back_track_site)&(Word)1);
+			h_value = h_value + ((matrix_bit[(i*c_stride + 4)*l_stride] >> back_track_site)&(Word)1);
 
 
-			v_value = current_value - ((matrix_bit[column_start + 1] >> (back_track_site - 1))&err_mask);
-			v_value = v_value + ((matrix_bit[column_start + 2] >> (back_track_site - 1))&err_mask);
+			v_value = current_value - ((matrix_bit[(i*c_stride + 1)*l_stride] >> (back_track_site - 1))&err_mask);
+			v_value = v_value + ((matrix_bit[(i*c_stride + 2)*l_stride] >> (back_track_site - 1))&err_mask);
 
 
 			min_value = delta_value;
@@ -889,6 +722,200 @@ inline int Reserve_Banded_BPM_PATH
 }
 
 
+///p_length might be samller than t_length + 2 * errthold
+inline int Reserve_Banded_BPM_PATH
+(char *pattern, int p_length, char *text, int t_length, unsigned short errthold, 
+		unsigned int* return_err, int* return_start_site, int* return_path_length, Word* matrix_bit, char* path, 
+		int old_error, int old_end_site)
+{
+	if (old_error != -1 && old_end_site != -1)
+	{
+		if (old_error == 0)
+		{
+			(*return_err) = old_error;
+			(*return_start_site) = old_end_site - t_length + 1;
+			return old_end_site;
+		}
+
+		if (try_cigar(pattern, p_length, text, t_length, old_end_site, path,
+		old_error, return_start_site, return_path_length))
+		{
+			(*return_err) = old_error;
+			return old_end_site;
+		}
+		
+	}
+	
+	(*return_err) = (unsigned int)-1;
+
+	Word Peq[256];
+
+	int band_length = (errthold << 1) + 1;
+	int i = 0;
+	Word tmp_Peq_1 = (Word)1;
+
+	Peq[(uint8_t)'A'] = (Word)0;
+	Peq[(uint8_t)'T'] = (Word)0;
+	Peq[(uint8_t)'G'] = (Word)0;
+	Peq[(uint8_t)'C'] = (Word)0;
+
+
+	Word Peq_A;
+	Word Peq_T;
+	Word Peq_C;
+	Word Peq_G;
+
+	///band_length = 2k + 1
+	for (i = 0; i<band_length; i++)
+	{
+		Peq[(uint8_t)pattern[i]] = Peq[(uint8_t)pattern[i]] | tmp_Peq_1;
+		tmp_Peq_1 = tmp_Peq_1 << 1;
+	}
+
+	///Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] | Peq[(uint8_t)'C'];
+
+	Peq_A = Peq[(uint8_t)'A'];
+	Peq_C = Peq[(uint8_t)'C'];
+	Peq_T = Peq[(uint8_t)'T'];
+	Peq_G = Peq[(uint8_t)'G'];
+
+
+	memset(Peq, 0, sizeof(Word)* 256);
+
+
+	Peq[(uint8_t)'A'] = Peq_A;
+	Peq[(uint8_t)'C'] = Peq_C;
+	Peq[(uint8_t)'T'] = Peq_T;
+	Peq[(uint8_t)'G'] = Peq_G;
+
+
+	
+
+	Word Mask = ((Word)1 << (errthold << 1));
+
+	Word VP = 0;
+	Word VN = 0;
+	Word X = 0;
+	Word D0 = 0;
+	Word HN = 0;
+	Word HP = 0;
+
+
+	i = 0;
+
+	Word column_start;
+
+	int err = 0;
+
+	Word err_mask = (Word)1;
+
+
+	///band_down = 2k
+	///i_bd = 2k
+	///int i_bd = i + band_down;
+	int i_bd = (errthold << 1);
+
+
+	int last_high = (errthold << 1);
+
+
+	/// t_length_1 = SEQ_LENGTH - 1
+	int t_length_1 = t_length - 1;
+	//while(i<t_length)
+
+	while (i<t_length_1)
+	{
+		///pattern[0]ÔÚPeq[2k], ¶øpattern[2k]ÔÚPeq[0]
+		X = Peq[(uint8_t)text[i]] | VN;
+
+		D0 = ((VP + (X&VP)) ^ VP) | X;
+
+		HN = VP&D0;
+		HP = VN | ~(VP | D0);
+
+		X = D0 >> 1;
+		VN = X&HP;
+		VP = HN | ~(X | HP);
+
+		if (!(D0&err_mask))
+		{
+			++err;
+
+			if ((err - last_high)>(int)errthold)
+			{
+				return -1;
+			}
+				
+		}
+
+
+		Peq[(uint8_t)'A'] = Peq[(uint8_t)'A'] >> 1;
+		Peq[(uint8_t)'C'] = Peq[(uint8_t)'C'] >> 1;
+		Peq[(uint8_t)'G'] = Peq[(uint8_t)'G'] >> 1;
+		Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] >> 1;
+
+
+		++i;
+		++i_bd;
+		Peq[(uint8_t)pattern[i_bd]] = Peq[(uint8_t)pattern[i_bd]] | Mask;
+
+
+		///Peq[(uint8_t)'T'] = Peq[(uint8_t)'T'] | Peq[(uint8_t)'C'];
+
+		column_start = i << 3;
+		matrix_bit[column_start] = D0;
+		matrix_bit[column_start + 1] = VP;
+		matrix_bit[column_start + 2] = VN;
+		matrix_bit[column_start + 3] = HP;
+		matrix_bit[column_start + 4] = HN;
+	}
+
+
+
+
+
+	X = Peq[(uint8_t)text[i]] | VN;
+	D0 = ((VP + (X&VP)) ^ VP) | X;
+	HN = VP&D0;
+	HP = VN | ~(VP | D0);
+	X = D0 >> 1;
+	VN = X&HP;
+	VP = HN | ~(X | HP);
+	if (!(D0&err_mask))
+	{
+		++err;
+		if ((err - last_high)>(int)errthold)
+			return -1;
+	}
+
+
+	column_start = (i + 1) << 3;
+	matrix_bit[column_start] = D0;
+	matrix_bit[column_start + 1] = VP;
+	matrix_bit[column_start + 2] = VN;
+	matrix_bit[column_start + 3] = HP;
+	matrix_bit[column_start + 4] = HN;
+
+
+	return Reserve_Banded_BPM_PATH_trace(p_length, t_length, errthold, err, VP, VN,
+			return_err, return_start_site, return_path_length, matrix_bit, 8, 1, path);
+}
+
+
+///verify n patterns of the same p_length at once with the widest SIMD supported by the CPU
+///(Reserve_Banded_BPM_lanes() patterns at most); the SSE path below is used for n <= 4 and for Ns
+int Reserve_Banded_BPM_lanes(void);
+int Reserve_Banded_BPM_N_SIMD(char **pattern, int n, int p_length, char *text, int t_length,
+	int* return_sites, unsigned int* return_sites_error, unsigned short errthold, __m128i* Peq_SSE);
+
+///Reserve_Banded_BPM_PATH() on n windows, each with its own pattern and text of the same lengths; old_error,
+///old_end_site and the outputs are per window. n <= Reserve_Banded_BPM_PATH_lanes(), which is 8 with AVX-512,
+///4 with AVX2 and 1 otherwise. matrix_bit has room for (WINDOW_MAX_SIZE + 10) * 5 * PATH_GROUP_SIZE Words
+int Reserve_Banded_BPM_PATH_lanes(void);
+int Reserve_Banded_BPM_PATH_N(char **pattern, char **text, int n, int p_length, int t_length, unsigned short errthold,
+	int *old_error, int *old_end_site, int *return_sites, unsigned int *return_err,
+	int *return_start_site, int *return_path_length, Word *matrix_bit, char **path);
+
 ////four patterns have the same p_length
 inline int Reserve_Banded_BPM_4_SSE_only(char *pattern1, char *pattern2, char *pattern3, char *pattern4, int p_length, char *text, int t_length,
 	int* return_sites, unsigned int* return_sites_error, unsigned short errthold, __m128i* Peq_SSE)
@@ -9,6 +9,7 @@
 #include "Hash_Table.h"
 #include "Correct.h"
 #include "Purge_Dups.h"
+#include "kthread.h"
 
 uint32_t debug_purge_dup = 0;
 
@@ -204,6 +205,7 @@ void asg_arc_index(asg_t *g)
 {
 	if (g->idx) free(g->idx);
 	g->idx = asg_arc_index_core(g->n_seq, g->n_arc, g->arc);
+	g->m_idx = g->n_seq * 2;
 }
 
 void asg_seq_set(asg_t *g, int sid, int len, int del)
@@ -239,6 +241,8 @@ ma_utg_t* asg_F_seq_set(asg_t *g, int iid)
 
 
 
+#define asg_arc_is_dead(g, a) ((a)->del || (g)->seq[(a)->ul>>33].del || (g)->seq[(a)->v>>1].del)
+
 // hard remove arcs marked as "del"
 void asg_arc_rm(asg_t *g)
 {
@@ -249,12 +253,28 @@ void asg_arc_rm(asg_t *g)
 				        tns              relative strand between query and target
 	p->ol: overlap length
 	**/
-	uint32_t e, n;
+	uint32_t e, n, u, s;
 	///just clean arc requiring: 1. arc it self must be available 2. both the query and target are available
-	for (e = n = 0; e < g->n_arc; ++e) {
-		//u and v is the read id
-		uint32_t u = g->arc[e].ul>>32, v = g->arc[e].v;
-		if (!g->arc[e].del && !g->seq[u>>1].del && !g->seq[v>>1].del)
+	///arcs in front of the first removed one stay where they are
+	for (e = 0; e < g->n_arc && !asg_arc_is_dead(g, &g->arc[e]); ++e);
+	if (e == g->n_arc) return;
+	if (g->idx && g->is_srt && g->m_idx >= g->n_seq * 2) {
+		/**
+		 * arcs are grouped by source vertex and idx is up to date: compact the
+		 * groups from the first edited one onwards and rewrite their idx entries
+		 * in the same pass, rather than dropping idx and rebuilding it from scratch
+		**/
+		for (u = g->arc[e].ul>>32; e > 0 && g->arc[e-1].ul>>32 == u; --e);
+		for (n = e; e < g->n_arc; ) {
+			for (u = g->arc[e].ul>>32, s = n; e < g->n_arc && g->arc[e].ul>>32 == u; ++e)
+				if (!asg_arc_is_dead(g, &g->arc[e])) g->arc[n++] = g->arc[e];
+			g->idx[u] = n > s? (uint64_t)s<<32 | (n - s) : 0;
+		}
+		g->n_arc = n;
+		return;
+	}
+	for (n = e; e < g->n_arc; ++e) {
+		if (!asg_arc_is_dead(g, &g->arc[e]))
 			g->arc[n++] = g->arc[e];
 	}
 	if (n < g->n_arc) { // arc index is out of sync
@@ -286,27 +306,72 @@ void asg_cleanup(asg_t *g)
 
 
 
+/**
+ * Per-vertex cleaning passes below run with kt_for(). Workers only read the
+ * graph; arcs to be deleted are collected in a per-thread buffer and marked
+ * in asg_arc_del_merge() once all workers are done, so the result does not
+ * depend on scheduling and matches a single-threaded run.
+**/
+typedef struct {
+	asg_t *g;
+	int fuzz;
+	asg64_v *del; // arc indices to delete, one buffer per thread
+	asg64_v *buf; // per-thread scratch
+} asg_clean_aux_t;
+
+#define ASG_ASYMM_BLK 16384
+
+static void asg_clean_aux_init(asg_clean_aux_t *aux, asg_t *g, int fuzz)
+{
+	aux->g = g, aux->fuzz = fuzz;
+	CALLOC(aux->del, asm_opt.thread_num);
+	CALLOC(aux->buf, asm_opt.thread_num);
+}
+
+static uint32_t asg_arc_del_merge(asg_clean_aux_t *aux)
+{
+	int t;
+	uint64_t i;
+	uint32_t n_del = 0;
+	for (t = 0; t < asm_opt.thread_num; ++t) {
+		for (i = 0; i < aux->del[t].n; ++i)
+			aux->g->arc[aux->del[t].a[i]].del = 1;
+		n_del += aux->del[t].n;
+		free(aux->del[t].a);
+		free(aux->buf[t].a);
+	}
+	free(aux->del); free(aux->buf);
+	return n_del;
+}
+
+static void worker_arc_del_multi(void *data, long v, int tid)
+{
+	asg_clean_aux_t *aux = (asg_clean_aux_t*)data;
+	asg64_v *b = &aux->buf[tid];
+	asg_arc_t *av = asg_arc_a(aux->g, v);
+	uint32_t i, nv = asg_arc_n(aux->g, v);
+	///if v just have one out-node, there is no muti-edge
+	if (nv < 2) return;
+	///keep the first arc to each out-node; drop the later copies
+	for (i = 0, b->n = 0; i < nv; ++i)
+		kv_push(uint64_t, *b, (uint64_t)av[i].v<<32 | i);
+	radix_sort_arch64(b->a, b->a + b->n);
+	for (i = 1; i < b->n; ++i)
+		if (b->a[i]>>32 == b->a[i-1]>>32)
+			kv_push(uint64_t, aux->del[tid], (uint64_t)(av - aux->g->arc) + (uint32_t)b->a[i]);
+}
+
 // delete multi-arcs
 /**
  * remove edges like:   v has two out-edges to w
 **/
 int asg_arc_del_multi(asg_t *g)
 {
-	//the number of nodes are number of read times 2
-	uint32_t *cnt, n_vtx = g->n_seq * 2, n_multi = 0, v;
-	cnt = (uint32_t*)calloc(n_vtx, 4);
-	for (v = 0; v < n_vtx; ++v) {
-		///out-nodes of v
-		asg_arc_t *av = asg_arc_a(g, v);
-		int32_t i, nv = asg_arc_n(g, v);
-		///if v just have one out-node, there is no muti-edge
-		if (nv < 2) continue;
-		for (i = nv - 1; i >= 0; --i) ++cnt[av[i].v];
-		for (i = nv - 1; i >= 0; --i)
-			if (--cnt[av[i].v] != 0)
-				av[i].del = 1, ++n_multi;
-	}
-	free(cnt);
+	asg_clean_aux_t aux;
+	uint32_t n_multi;
+	asg_clean_aux_init(&aux, g, 0);
+	kt_for(asm_opt.thread_num, worker_arc_del_multi, &aux, g->n_seq * 2);
+	n_multi = asg_arc_del_merge(&aux);
 	if (n_multi) asg_cleanup(g);
 
     if(VERBOSE >= 1)
@@ -317,19 +382,30 @@ int asg_arc_del_multi(asg_t *g)
 	return n_multi;
 }
 
-// remove asymmetric arcs: u->v is present, but v'->u' not
-int asg_arc_del_asymm(asg_t *g)
+static void worker_arc_del_asymm(void *data, long blk, int tid)
 {
-	uint32_t e, n_asymm = 0;
-	///g->n_arc is the number of overlaps 
-	for (e = 0; e < g->n_arc; ++e) {
+	asg_clean_aux_t *aux = (asg_clean_aux_t*)data;
+	asg_t *g = aux->g;
+	uint64_t e, e0 = (uint64_t)blk * ASG_ASYMM_BLK, e1 = e0 + ASG_ASYMM_BLK;
+	if (e1 > g->n_arc) e1 = g->n_arc;
+	for (e = e0; e < e1; ++e) {
 		uint32_t v = g->arc[e].v^1, u = g->arc[e].ul>>32^1;
 		uint32_t i, nv = asg_arc_n(g, v);
 		asg_arc_t *av = asg_arc_a(g, v);
 		for (i = 0; i < nv; ++i)
 			if (av[i].v == u) break;
-		if (i == nv) g->arc[e].del = 1, ++n_asymm;
+		if (i == nv) kv_push(uint64_t, aux->del[tid], e);
 	}
+}
+
+// remove asymmetric arcs: u->v is present, but v'->u' not
+int asg_arc_del_asymm(asg_t *g)
+{
+	asg_clean_aux_t aux;
+	uint32_t n_asymm;
+	asg_clean_aux_init(&aux, g, 0);
+	kt_for(asm_opt.thread_num, worker_arc_del_asymm, &aux, (g->n_arc + ASG_ASYMM_BLK - 1) / ASG_ASYMM_BLK);
+	n_asymm = asg_arc_del_merge(&aux);
 	if (n_asymm) asg_cleanup(g);
     if(VERBOSE >= 1)
     {
@@ -351,6 +427,7 @@ void init_ma_hit_t_alloc(ma_hit_t_alloc* x)
     x->size = 0;
     x->buffer = NULL;
     x->length = 0;
+    x->is_packed = 0;
 }
 
 void clear_ma_hit_t_alloc(ma_hit_t_alloc* x)
@@ -358,18 +435,28 @@ void clear_ma_hit_t_alloc(ma_hit_t_alloc* x)
     x->length = 0;
 }
 
+// move a packed list out of its block before it grows
+static void ma_hit_unpack(ma_hit_t_alloc* x, uint32_t size)
+{
+	ma_hit_t *a;
+	MALLOC(a, size);
+	if (x->length) memcpy(a, x->buffer, x->length * sizeof(ma_hit_t));
+	x->buffer = a, x->size = size, x->is_packed = 0;
+}
+
 void resize_ma_hit_t_alloc(ma_hit_t_alloc* x, uint32_t size)
 {
 	if (size > x->size) {
 		x->size = size;
 		kroundup32(x->size);
-		REALLOC(x->buffer, x->size);
+		if (x->is_packed) ma_hit_unpack(x, x->size);
+		else REALLOC(x->buffer, x->size);
 	}
 }
 
 void destory_ma_hit_t_alloc(ma_hit_t_alloc* x)
 {
-	free(x->buffer);
+	if (!x->is_packed) free(x->buffer);
 }
 
 void add_ma_hit_t_alloc(ma_hit_t_alloc* x, ma_hit_t* element)
@@ -377,11 +464,41 @@ void add_ma_hit_t_alloc(ma_hit_t_alloc* x, ma_hit_t* element)
 	if (x->length + 1 > x->size) {
 		x->size = x->length + 1;
 		kroundup32(x->size);
-		REALLOC(x->buffer, x->size);
+		if (x->is_packed) ma_hit_unpack(x, x->size);
+		else REALLOC(x->buffer, x->size);
 	}
 	x->buffer[x->length++] = *element;
 }
 
+#define MA_HIT_HDR(n) (((uint64_t)(n) * sizeof(ma_hit_t_alloc) + 7) & ~7ULL)
+
+/*
+ * Pack the overlap lists of n reads into a single allocation: the n headers
+ * followed by all hits in read order (CSR layout). Each buffer then points
+ * into the shared pool, so there is no per-read slack or malloc header and
+ * neighbouring reads are adjacent in memory during graph construction. x is
+ * freed; the returned array is released with a single free(). A packed list
+ * that later grows is copied out by add_ma_hit_t_alloc().
+ */
+ma_hit_t_alloc *ma_hit_pack(ma_hit_t_alloc *x, long long n)
+{
+	long long i;
+	uint64_t tot = 0, hdr = MA_HIT_HDR(n);
+	ma_hit_t_alloc *p;
+	ma_hit_t *a;
+	for (i = 0; i < n; ++i) tot += x[i].length;
+	p = (ma_hit_t_alloc*)malloc(hdr + tot * sizeof(ma_hit_t));
+	a = (ma_hit_t*)((char*)p + hdr);
+	for (i = 0; i < n; ++i) {
+		p[i] = x[i];
+		p[i].buffer = a, p[i].size = x[i].length, p[i].is_packed = 1;
+		if (x[i].length) memcpy(a, x[i].buffer, x[i].length * sizeof(ma_hit_t));
+		a += x[i].length;
+		destory_ma_hit_t_alloc(&x[i]);
+	}
+	free(x);
+	return p;
+}
 
 long long get_specific_overlap(ma_hit_t_alloc* x, uint32_t qn, uint32_t tn)
 {
@@ -4487,37 +4604,37 @@ int asg_arc_del_cross_bubble(asg_t *g, long long max_dist)
 
 
 // transitive reduction; see Myers, 2005
-int asg_arc_del_trans(asg_t *g, int fuzz)
+static inline uint64_t *asg_trans_mark(asg64_v *b, uint32_t w)
 {
-    double startTime = Get_T();
-
-	uint8_t *mark;
-	///n_vtx = number of seq * 2
-	///the reason is that each read has two direction (query->target, target->query)
-	uint32_t v, n_vtx = g->n_seq * 2, n_reduced = 0;
-	///at first, all nodes should be set to vacant
-	mark = (uint8_t*)calloc(n_vtx, 1);
-
-	/**v is the id+direction of a node, 
-     * the high 31-bit is the id, 
-     * and the lowest 1-bit is the direction
-     * (0 means query-to-target, 1 means target-to-query)**/
-	for (v = 0; v < n_vtx; ++v) {
-		///nv is the number of overlaps with v(qn+direction)
-		uint32_t L, i, nv = asg_arc_n(g, v);
-		///av is the array of v
-		asg_arc_t *av = asg_arc_a(g, v);
-        ///that means in this direction, read v is not overlapped with any other reads
-		if (nv == 0) continue; // no hits
-		
-        ///if the read itself has been removed
-		if (g->seq[v>>1].del) 
-        {
-			for (i = 0; i < nv; ++i) av[i].del = 1, ++n_reduced;
-			continue;
-		}
+	size_t lo = 0, hi = b->n;
+	while (lo < hi) {
+		size_t mid = (lo + hi) >> 1;
+		if ((b->a[mid]>>32) < w) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo < b->n && (b->a[lo]>>32) == w? &b->a[lo] : NULL;
+}
 
+static void worker_arc_del_trans(void *data, long v, int tid)
+{
+	asg_clean_aux_t *aux = (asg_clean_aux_t*)data;
+	asg_t *g = aux->g;
+	asg64_v *b = &aux->buf[tid], *d = &aux->del[tid];
+	///nv is the number of overlaps with v(qn+direction)
+	uint32_t L, i, nv = asg_arc_n(g, v);
+	///av is the array of v
+	asg_arc_t *av = asg_arc_a(g, v);
+	uint64_t *p, *q, off = av - g->arc;
+	size_t k, n;
+	///that means in this direction, read v is not overlapped with any other reads
+	if (nv == 0) return; // no hits
 
+	///if the read itself has been removed
+	if (g->seq[v>>1].del)
+	{
+		for (i = 0; i < nv; ++i) kv_push(uint64_t, *d, off + i);
+		return;
+	}
 
         /**
 	********************************query-to-target overlap****************************
@@ -4554,51 +4671,67 @@ int asg_arc_del_trans(asg_t *g, int fuzz)
     **/
 
 
-		//all outnode of v should be set to "not reduce"
-		for (i = 0; i < nv; ++i) mark[av[i].v] = 1;
+	/**
+	 * b keeps one entry per distinct out-node of v: node<<32 | mark, sorted by
+	 * node; it plays the role of a global mark[] array (0: vacant, 1: in play,
+	 * 2: eliminated) without needing one such array per thread.
+	**/
+	for (i = 0, b->n = 0; i < nv; ++i) kv_push(uint64_t, *b, (uint64_t)av[i].v<<32);
+	radix_sort_arch64(b->a, b->a + b->n);
+	for (k = n = 0; k < b->n; ++k)
+		if (n == 0 || (b->a[k]>>32) != (b->a[n-1]>>32)) b->a[n++] = b->a[k] | 1;
+	b->n = n;
+
+	///length of node (not overlap length)
+	///av[nv-1] is longest out-dege
+	/**
+	 * v---------------
+	 *   w1---------------
+	 *      w2--------------
+	 *         w3--------------
+	 *            w4--------------
+	 *               w5-------------
+	 * for v, the longest out-edge is v->w5
+	 **/
+	L = asg_arc_len(av[nv-1]) + aux->fuzz;
+
+
+	for (i = 0; i < nv; ++i) {
+		//w is an out-node of v
+		uint32_t w = av[i].v;
+		
+		uint32_t j, nw = asg_arc_n(g, w);
+		asg_arc_t *aw = asg_arc_a(g, w);
+		///if w has already been reduced
+		if ((uint32_t)*asg_trans_mark(b, w) != 1) continue;
 
-		///length of node (not overlap length)
-		///av[nv-1] is longest out-dege
-		/**
-		 * v---------------
-		 *   w1---------------
-		 *      w2--------------
-		 *         w3--------------
-		 *            w4--------------
-		 *               w5-------------
-		 * for v, the longest out-edge is v->w5
-		 **/
-		L = asg_arc_len(av[nv-1]) + fuzz;
+		for (j = 0; j < nw && asg_arc_len(aw[j]) + asg_arc_len(av[i]) <= L; ++j)
+			if ((q = asg_trans_mark(b, aw[j].v)) != NULL && (uint32_t)*q) *q = (*q>>32<<32) | 2;
+	}
+	//remove edges
+	for (i = 0; i < nv; ++i) {
+		p = asg_trans_mark(b, av[i].v);
+		if ((uint32_t)*p == 2) kv_push(uint64_t, *d, off + i);
+		*p = *p>>32<<32;
+	}
+}
 
+int asg_arc_del_trans(asg_t *g, int fuzz)
+{
+    double startTime = Get_T();
 
-		for (i = 0; i < nv; ++i) {
-			//w is an out-node of v
-			uint32_t w = av[i].v;
-			
-			uint32_t j, nw = asg_arc_n(g, w);
-			asg_arc_t *aw = asg_arc_a(g, w);
-			///if w has already been reduced
-			if (mark[av[i].v] != 1) continue;
+	asg_clean_aux_t aux;
+	///n_vtx = number of seq * 2
+	///the reason is that each read has two direction (query->target, target->query)
+	uint32_t n_vtx = g->n_seq * 2, n_reduced;
 
-			for (j = 0; j < nw && asg_arc_len(aw[j]) + asg_arc_len(av[i]) <= L; ++j)
-				if (mark[aw[j].v]) mark[aw[j].v] = 2;
-		}
-		#if 0
-		for (i = 0; i < nv; ++i) {
-			uint32_t w = av[i].v;
-			uint32_t j, nw = asg_arc_n(g, w);
-			asg_arc_t *aw = asg_arc_a(g, w);
-			for (j = 0; j < nw && (j == 0 || asg_arc_len(aw[j]) < fuzz); ++j)
-				if (mark[aw[j].v]) mark[aw[j].v] = 2;
-		}
-		#endif
-        //remove edges
-		for (i = 0; i < nv; ++i) {
-			if (mark[av[i].v] == 2) av[i].del = 1, ++n_reduced;
-			mark[av[i].v] = 0;
-		}
-	}
-	free(mark);
+	/**v is the id+direction of a node, 
+     * the high 31-bit is the id, 
+     * and the lowest 1-bit is the direction
+     * (0 means query-to-target, 1 means target-to-query)**/
+	asg_clean_aux_init(&aux, g, fuzz);
+	kt_for(asm_opt.thread_num, worker_arc_del_trans, &aux, n_vtx);
+	n_reduced = asg_arc_del_merge(&aux);
 
     if(VERBOSE >= 1)
     {
@@ -8313,96 +8446,213 @@ int asg_arc_del_false_node(asg_t *g, int max_ext)
 #define arc_cnt(g, v) ((uint32_t)(g)->idx[(v)])
 #define arc_first(g, v) ((g)->arc[(g)->idx[(v)]>>32])
 
-ma_ug_t *ma_ug_gen(asg_t *g)
-{
-    asg_cleanup(g);
-	int32_t *mark;
-	uint32_t i, v, n_vtx = g->n_seq * 2;
-	///is a queue
-	kdq_t(uint64_t) *q;
-	ma_ug_t *ug;
+/**
+ * Walk the maximal unitig through v, in the orientation of v, and store it in
+ * p. If mark is not NULL, the vertices taken by the unitig are marked.
+**/
+static void ma_ug_walk(asg_t *g, uint32_t v, kdq_t(uint64_t) *q, ma_utg_t *p, int32_t *mark)
+{
+	uint32_t i, w, x, l, start, end, len;
+	if (mark) mark[v] = 1;
+	q->count = 0, start = v, end = v^1, len = 0;
+	// forward
+	w = v;
+	while (1) {
+		/**
+		 * w----->x
+		 * w<-----x
+		 * that means the only suffix of w is x, and the only prefix of x is w
+		 **/
+		if (arc_cnt(g, w) != 1) break;
+		x = arc_first(g, w).v; // w->x
+		if (arc_cnt(g, x^1) != 1) break;
 
-	ug = (ma_ug_t*)calloc(1, sizeof(ma_ug_t));
-	ug->g = asg_init();
-    ///each node has two directions
-	mark = (int32_t*)calloc(n_vtx, 4);
+		/**
+		 * another direction of w would be marked as used (since w has been used)
+		**/
+		if (mark) mark[x] = mark[w^1] = 1;
+		///l is the edge length, instead of overlap length
+		///note: edge length is different with overlap length
+		l = asg_arc_len(arc_first(g, w));
+		kdq_push(uint64_t, q, (uint64_t)w<<32 | l);
+		end = x^1, len += l;
+		w = x;
+		if (x == v) break;
+	}
+	if (start != (end^1) || kdq_size(q) == 0) { // linear unitig
+		///length of seq, instead of edge
+		l = g->seq[end>>1].len;
+		kdq_push(uint64_t, q, (uint64_t)(end^1)<<32 | l);
+		len += l;
+	} else { // circular unitig
+		start = end = UINT32_MAX;
+		goto add_unitig; // then it is not necessary to do the backward
+	}
+	// backward
+	x = v;
+	while (1) { // similar to forward but not the same
+		if (arc_cnt(g, x^1) != 1) break;
+		w = arc_first(g, x^1).v ^ 1; // w->x
+		if (arc_cnt(g, w) != 1) break;
+		if (mark) mark[x] = mark[w^1] = 1;
+		l = asg_arc_len(arc_first(g, w));
+		///w is the seq id + direction, l is the length of edge
+		///push element to the front of a queue
+		kdq_unshift(uint64_t, q, (uint64_t)w<<32 | l);
+		start = w, len += l;
+		x = w;
+	}
+add_unitig:
+	if (mark && start != UINT32_MAX) mark[start] = mark[end] = 1;
+	p->s = 0, p->start = start, p->end = end, p->len = len, p->n = kdq_size(q), p->circ = (start == UINT32_MAX);
+	p->m = p->n;
+	kv_roundup32(p->m);
+	p->a = (uint64_t*)malloc(8 * p->m);
+	//all elements are saved here
+	for (i = 0; i < kdq_size(q); ++i)
+		p->a[i] = kdq_at(q, i);
+}
 
-	q = kdq_init(uint64_t);
+#define ma_ug_eligible(g, v) (!(g)->seq[(v)>>1].del && !(arc_cnt((g), (v)) == 0 && arc_cnt((g), (v)^1) != 0))
+
+///original one-thread extraction: the first unmarked vertex of a unitig decides its id and orientation
+static void ma_ug_gen_seq(asg_t *g, ma_utg_v *u, int32_t *mark, uint32_t *vs)
+{
+	uint32_t v, n_vtx = g->n_seq * 2;
+	kdq_t(uint64_t) *q = kdq_init(uint64_t);
+	ma_utg_t *p;
 	for (v = 0; v < n_vtx; ++v) {
-		uint32_t w, x, l, start, end, len;
-		ma_utg_t *p;
         ///what's the usage of mark array
         ///mark array is used to mark if this node has already been included in a contig
         /****************************may have bugs********************************/
 		///if (g->seq[v>>1].del || arc_cnt(g, v) == 0 || mark[v]) continue;
-        if (g->seq[v>>1].del || mark[v]) continue;
-        if (arc_cnt(g, v) == 0 && arc_cnt(g, (v^1)) != 0) continue;
+		if (mark[v] || !ma_ug_eligible(g, v)) continue;
         /****************************may have bugs********************************/
-		mark[v] = 1;
-		q->count = 0, start = v, end = v^1, len = 0;
-		// forward
-		w = v;
-		while (1) {
-			/**
-			 * w----->x
-			 * w<-----x
-			 * that means the only suffix of w is x, and the only prefix of x is w
-			 **/
-			if (arc_cnt(g, w) != 1) break;
-			x = arc_first(g, w).v; // w->x
-			if (arc_cnt(g, x^1) != 1) break;
+		kv_pushp(ma_utg_t, *u, &p);
+		if (vs) vs[u->n - 1] = v;
+		ma_ug_walk(g, v, q, p, mark);
+	}
+	kdq_destroy(uint64_t, q);
+}
 
-			/**
-			 * another direction of w would be marked as used (since w has been used)
-			**/
-			mark[x] = mark[w^1] = 1;
-			///l is the edge length, instead of overlap length
-            ///note: edge length is different with overlap length
-			l = asg_arc_len(arc_first(g, w));
-			kdq_push(uint64_t, q, (uint64_t)w<<32 | l);
-			end = x^1, len += l;
-			w = x;
-			if (x == v) break;
-		}
-		if (start != (end^1) || kdq_size(q) == 0) { // linear unitig
-			///length of seq, instead of edge
-			l = g->seq[end>>1].len;
-			kdq_push(uint64_t, q, (uint64_t)(end^1)<<32 | l);
-			len += l;
-		} else { // circular unitig
-			start = end = UINT32_MAX;
-			goto add_unitig; // then it is not necessary to do the backward
-		}
-		// backward
-		x = v;
-		while (1) { // similar to forward but not the same
-			if (arc_cnt(g, x^1) != 1) break;
-			w = arc_first(g, x^1).v ^ 1; // w->x
-			if (arc_cnt(g, w) != 1) break;
-			mark[x] = mark[w^1] = 1;
-			l = asg_arc_len(arc_first(g, w));
-			///w is the seq id + direction, l is the length of edge
-			///push element to the front of a queue
-			kdq_unshift(uint64_t, q, (uint64_t)w<<32 | l);
+typedef struct {
+	asg_t *g;
+	uint32_t *first; // per vertex: the vertex that opens its unitig (see worker_ug_head())
+	uint32_t *vs; // vertices opening the unitigs found from their ends
+	ma_utg_t *a;
+	kdq_t(uint64_t) **q; // per-thread queues
+} ma_ug_gen_aux_t;
 
-            // fprintf(stderr, "uId: %u, >%.*s (%u)\n", 
-            // ug->u.n, (int)Get_NAME_LENGTH((R_INF), w>>1), Get_NAME((R_INF), w>>1), w>>1);
+/**
+ * If v has no unique predecessor, v is one end of a linear unitig. Walk it and
+ * record the smallest vertex eligible to open it: that is where the one-thread
+ * scan would have found it.
+**/
+static void worker_ug_head(void *data, long v, int tid)
+{
+	ma_ug_gen_aux_t *aux = (ma_ug_gen_aux_t*)data;
+	asg_t *g = aux->g;
+	uint32_t w = v, x, m = UINT32_MAX, n = 0;
+	aux->first[v] = UINT32_MAX;
+	if (g->seq[v>>1].del) return;
+	if (arc_cnt(g, v^1) == 1 && arc_cnt(g, arc_first(g, v^1).v^1) == 1) return;
+	while (1) {
+		if (ma_ug_eligible(g, w) && w < m) m = w;
+		if (ma_ug_eligible(g, w^1) && (w^1) < m) m = w^1;
+		if (arc_cnt(g, w) != 1) break;
+		x = arc_first(g, w).v;
+		if (arc_cnt(g, x^1) != 1) break;
+		w = x;
+		if (x == (uint32_t)v || ++n > g->n_seq * 2) return; // not a linear unitig; left to the one-thread pass
+	}
+	aux->first[v] = m;
+}
 
-			start = w, len += l;
-			x = w;
+static void worker_ug_walk(void *data, long i, int tid)
+{
+	ma_ug_gen_aux_t *aux = (ma_ug_gen_aux_t*)data;
+	if (aux->q[tid] == 0) aux->q[tid] = kdq_init(uint64_t);
+	ma_ug_walk(aux->g, aux->vs[i], aux->q[tid], &aux->a[i], NULL);
+}
+
+/**
+ * Unitig extraction with kt_for(): linear unitigs are found from their ends
+ * and walked in parallel; circular ones are picked up by a one-thread scan
+ * afterwards. Unitigs are then ordered by their opening vertex, giving the
+ * same ids, orientation and content as ma_ug_gen_seq(). Returns 0, leaving u
+ * and mark untouched, if the graph has a shape the shortcut does not handle.
+**/
+static int ma_ug_gen_mt(asg_t *g, ma_utg_v *u, int32_t *mark)
+{
+	ma_ug_gen_aux_t aux;
+	ma_utg_v c = {0,0,0};
+	uint32_t v, n_vtx = g->n_seq * 2, n, i, j, k, w, m, *cv = NULL, ok = 1;
+	uint8_t *f;
+
+	memset(&aux, 0, sizeof(aux));
+	aux.g = g;
+	MALLOC(aux.first, n_vtx);
+	kt_for(asm_opt.thread_num, worker_ug_head, &aux, n_vtx);
+	CALLOC(f, n_vtx);
+	for (v = n = 0; v < n_vtx; ++v)
+		if (aux.first[v] != UINT32_MAX && !f[aux.first[v]]) f[aux.first[v]] = 1, ++n;
+	free(aux.first);
+	MALLOC(aux.vs, n);
+	for (v = n = 0; v < n_vtx; ++v)
+		if (f[v]) aux.vs[n++] = v;
+	free(f);
+
+	CALLOC(aux.a, n);
+	CALLOC(aux.q, asm_opt.thread_num);
+	kt_for(asm_opt.thread_num, worker_ug_walk, &aux, n);
+	for (i = 0; i < (uint32_t)asm_opt.thread_num; ++i)
+		if (aux.q[i]) kdq_destroy(uint64_t, aux.q[i]);
+	free(aux.q);
+
+	///take the vertices of each unitig, checking it is opened where the one-thread scan would open it
+	for (i = 0; i < n && ok; ++i) {
+		ma_utg_t *p = &aux.a[i];
+		for (j = 0, m = UINT32_MAX; j < p->n && ok; ++j) {
+			w = p->a[j]>>32;
+			if (mark[w] || mark[w^1]) ok = 0;
+			mark[w] = mark[w^1] = 1;
+			if (ma_ug_eligible(g, w) && w < m) m = w;
+			if (ma_ug_eligible(g, w^1) && (w^1) < m) m = w^1;
 		}
-add_unitig:
-		if (start != UINT32_MAX) mark[start] = mark[end] = 1;
-		kv_pushp(ma_utg_t, ug->u, &p);
-		p->s = 0, p->start = start, p->end = end, p->len = len, p->n = kdq_size(q), p->circ = (start == UINT32_MAX);
-		p->m = p->n;
-		kv_roundup32(p->m);
-		p->a = (uint64_t*)malloc(8 * p->m);
-		//all elements are saved here
-		for (i = 0; i < kdq_size(q); ++i)
-			p->a[i] = kdq_at(q, i);
+		if (m != aux.vs[i]) ok = 0;
 	}
-	kdq_destroy(uint64_t, q);
+	if (ok) {
+		MALLOC(cv, n_vtx);
+		ma_ug_gen_seq(g, &c, mark, cv);
+		kv_resize(ma_utg_t, *u, n + c.n);
+		for (i = j = k = 0; i < n || j < c.n; ) {
+			if (j == c.n || (i < n && aux.vs[i] < cv[j])) u->a[k++] = aux.a[i++];
+			else u->a[k++] = c.a[j++];
+		}
+		u->n = k;
+	} else {
+		for (i = 0; i < n; ++i) free(aux.a[i].a);
+		memset(mark, 0, n_vtx * sizeof(int32_t));
+	}
+	free(cv); free(c.a);
+	free(aux.a); free(aux.vs);
+	return ok;
+}
+
+ma_ug_t *ma_ug_gen(asg_t *g)
+{
+    asg_cleanup(g);
+	int32_t *mark;
+	uint32_t i, v, n_vtx = g->n_seq * 2;
+	ma_ug_t *ug;
+
+	ug = (ma_ug_t*)calloc(1, sizeof(ma_ug_t));
+	ug->g = asg_init();
+    ///each node has two directions
+	mark = (int32_t*)calloc(n_vtx, 4);
+
+	if (!ma_ug_gen_mt(g, &ug->u, mark))
+		ma_ug_gen_seq(g, &ug->u, mark, NULL);
 
 	// add arcs between unitigs; reusing mark for a different purpose
 	//ug saves all unitigs
@@ -9308,120 +9558,226 @@ int ma_ug_seq_back(ma_ug_t *g, asg_t *read_g, All_reads *RNF, const ma_sub_t *co
 
 
 
-// generate unitig sequences
-int ma_ug_seq(ma_ug_t *g, asg_t *read_g, All_reads *RNF, ma_sub_t *coverage_cut,
-ma_hit_t_alloc* sources, kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp)
-{
-    UC_Read g_read;
-    init_UC_Read(&g_read);
-    UC_Read tmp;
-    init_UC_Read(&tmp);
-	///utg_intv_t *tmp;
-	uint32_t i, j, k;
+typedef struct {
+	ma_ug_t *g;
+	asg_t *read_g;
+	All_reads *RNF;
+	ma_sub_t *coverage_cut;
+	ma_hit_t_alloc* sources;
+	kvec_asg_arc_t_warp* edge;
+	int max_hang, min_ovlp;
+	UC_Read *g_read, *tmp; // per-thread read buffers
+} ma_ug_seq_aux_t;
+
+static void worker_ug_seq(void *data, long i, int tid)
+{
+	ma_ug_seq_aux_t *aux = (ma_ug_seq_aux_t*)data;
+	asg_t *read_g = aux->read_g;
+	const ma_sub_t *coverage_cut = aux->coverage_cut;
+	UC_Read *g_read = &aux->g_read[tid];
+	uint32_t j, k;
     uint32_t rId, /**uId,**/ori, start, eLen, readLen;
     char* readS = NULL;
+	ma_utg_t *u = &aux->g->u.a[i];
+    if(u->m == 0) return;
 
-    
-    ///why we need n_read here? it is just beacuse one read can only be included in one untig
-    ///but it is not true
-	///tmp = (utg_intv_t*)calloc(n_read, sizeof(utg_intv_t));
-	///number of unitigs
-	for (i = 0; i < g->u.n; ++i) {
-		ma_utg_t *u = &g->u.a[i];
-        if(u->m == 0) continue;
-
-        polish_unitig(u, read_g, sources, coverage_cut, edge, max_hang, min_ovlp);
+    polish_unitig(u, read_g, aux->sources, aux->coverage_cut, aux->edge, aux->max_hang, aux->min_ovlp);
 
-		uint32_t l = 0;
-		u->s = (char*)calloc(1, u->len + 1);
-		memset(u->s, 'N', u->len);
-		for (j = 0; j < u->n; ++j) {
-            rId = u->a[j]>>33;
-            ///uId = i;
-            ori = u->a[j]>>32&1;
-            start = l;
-            eLen = (uint32_t)u->a[j];
-			l += eLen;
+	uint32_t l = 0;
+	u->s = (char*)calloc(1, u->len + 1);
+	memset(u->s, 'N', u->len);
+	for (j = 0; j < u->n; ++j) {
+        rId = u->a[j]>>33;
+        ///uId = i;
+        ori = u->a[j]>>32&1;
+        start = l;
+        eLen = (uint32_t)u->a[j];
+		l += eLen;
 
-            if(eLen == 0) continue;
-            if(rId < read_g->r_seq)
-            {
-                recover_UC_Read(&g_read, RNF, rId);
-            }
-            else
-            {
-                recover_fake_read(&g_read, &tmp, &(read_g->F_seq[rId-read_g->r_seq]),
-                RNF, coverage_cut);
-            }
+        if(eLen == 0) continue;
+        if(rId < read_g->r_seq)
+        {
+            recover_UC_Read(g_read, aux->RNF, rId);
+        }
+        else
+        {
+            recover_fake_read(g_read, &aux->tmp[tid], &(read_g->F_seq[rId-read_g->r_seq]),
+            aux->RNF, coverage_cut);
+        }
 
-            readS = g_read.seq + coverage_cut[rId].s;
-            readLen = coverage_cut[rId].e - coverage_cut[rId].s;
-            
-            if (!ori) // forward strand
+        readS = g_read->seq + coverage_cut[rId].s;
+        readLen = coverage_cut[rId].e - coverage_cut[rId].s;
+        
+        if (!ori) // forward strand
+        {
+            for (k = 0; k < eLen; k++)
             {
-                for (k = 0; k < eLen; k++)
-                {
-                    u->s[start + k] = readS[k];
-                }
+                u->s[start + k] = readS[k];
             }
-            else
+        }
+        else
+        {
+            for (k = 0; k < eLen; k++)
             {
-                for (k = 0; k < eLen; k++)
-                {
-                    uint8_t c = (uint8_t)readS[readLen - 1 - k];
-                    u->s[start + k] = c >= 128? 'N' : comp_tab[c];
-                }
+                uint8_t c = (uint8_t)readS[readLen - 1 - k];
+                u->s[start + k] = c >= 128? 'N' : comp_tab[c];
             }
-            
+        }
+	}
+}
 
-		}
+// generate unitig sequences
+int ma_ug_seq(ma_ug_t *g, asg_t *read_g, All_reads *RNF, ma_sub_t *coverage_cut,
+ma_hit_t_alloc* sources, kvec_asg_arc_t_warp* edge, int max_hang, int min_ovlp)
+{
+	ma_ug_seq_aux_t aux;
+	int t;
+	aux.g = g, aux.read_g = read_g, aux.RNF = RNF, aux.coverage_cut = coverage_cut;
+	aux.sources = sources, aux.edge = edge, aux.max_hang = max_hang, aux.min_ovlp = min_ovlp;
+	MALLOC(aux.g_read, asm_opt.thread_num);
+	MALLOC(aux.tmp, asm_opt.thread_num);
+	for (t = 0; t < asm_opt.thread_num; ++t) {
+		init_UC_Read(&aux.g_read[t]);
+		init_UC_Read(&aux.tmp[t]);
 	}
 
-    destory_UC_Read(&g_read);
-    destory_UC_Read(&tmp);
+	///each unitig only touches its own reads list and sequence
+	kt_for(asm_opt.thread_num, worker_ug_seq, &aux, g->u.n);
+
+	for (t = 0; t < asm_opt.thread_num; ++t) {
+		destory_UC_Read(&aux.g_read[t]);
+		destory_UC_Read(&aux.tmp[t]);
+	}
+	free(aux.g_read); free(aux.tmp);
 	return 0;
 }
 
 
 
-void ma_ug_print2(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, int print_seq, FILE *fp)
+/**
+ * GFA lines are formatted in parallel, one segment or HA_GFA_N_LINK links per
+ * job, and handed to the writer in order; see gfaout.cpp.
+**/
+#define HA_GFA_N_JOB  4096
+#define HA_GFA_N_LINK 4096
+
+typedef struct {
+	const ma_ug_t *ug;
+	const asg_t *g;
+	All_reads *RNF;
+	const ma_sub_t *coverage_cut;
+	int print_seq;
+	uint64_t i0, n; // first item of this batch; total number of items
+	ha_gfa_buf_t *b; // one buffer per job
+} ha_gfa_fmt_t;
+
+static void ha_gfa_fmt_init(ha_gfa_fmt_t *f)
+{
+	memset(f, 0, sizeof(*f));
+	CALLOC(f->b, HA_GFA_N_JOB);
+}
+
+static void ha_gfa_fmt_write(ha_gfa_fmt_t *f, ha_gfa_out_t *o, uint64_t st, uint64_t en)
+{
+	uint64_t k;
+	for (k = st; k < en; ++k) {
+		if (f->b[k].l) ha_gfa_write(o, f->b[k].s, f->b[k].l);
+		if (f->b[k].m > 1<<20) free(f->b[k].s), f->b[k].s = 0, f->b[k].m = 0; // don't hold on to long contigs
+		f->b[k].l = 0;
+	}
+}
+
+static void ha_gfa_fmt_destroy(ha_gfa_fmt_t *f)
+{
+	int k;
+	for (k = 0; k < HA_GFA_N_JOB; ++k) free(f->b[k].s);
+	free(f->b);
+}
+
+static void worker_ug_fmt_seg(void *data, long k, int tid)
 {
-	uint32_t i, j, l;
+	ha_gfa_fmt_t *f = (ha_gfa_fmt_t*)data;
+	ha_gfa_buf_t *b = &f->b[k];
+	All_reads *RNF = f->RNF;
+	const ma_sub_t *coverage_cut = f->coverage_cut;
+	uint32_t i = f->i0 + k, j, l;
 	char name[32];
-	for (i = 0; i < ug->u.n; ++i) { // the Segment lines in GFA
-		ma_utg_t *p = &ug->u.a[i];
-        if(p->m == 0) continue;
-		sprintf(name, "utg%.6d%c", i + 1, "lc"[p->circ]);
-		if (print_seq) fprintf(fp, "S\t%s\t%s\tLN:i:%d\n", name, p->s? p->s : "*", p->len);
-		else fprintf(fp, "S\t%s\t*\tLN:i:%d\n", name, p->len);
-        
-		for (j = l = 0; j < p->n; l += (uint32_t)p->a[j++]) {
-			uint32_t x = p->a[j]>>33;
-			if(x<RNF->total_reads)
-            {
-                fprintf(fp, "A\t%s\t%d\t%c\t%.*s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
-                (int)Get_NAME_LENGTH((*RNF), x), Get_NAME((*RNF), x), 
-                coverage_cut[x].s, coverage_cut[x].e, x, "apmaaa"[RNF->trio_flag[x]]);
-            }
-            else
-            {
-                fprintf(fp, "A\t%s\t%d\t%c\t%s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
-					"FAKE", coverage_cut[x].s, coverage_cut[x].e, x, '*');
-            }
-            
-            
-        }
+	const ma_utg_t *p = &f->ug->u.a[i];
+	if (p->m == 0) return;
+	sprintf(name, "utg%.6d%c", i + 1, "lc"[p->circ]);
+	ha_gfa_printf(b, "S\t%s\t", name);
+	if (f->print_seq && p->s) ha_gfa_puts(b, p->s, strlen(p->s));
+	else ha_gfa_puts(b, "*", 1);
+	ha_gfa_printf(b, "\tLN:i:%d\n", p->len);
+	for (j = l = 0; j < p->n; l += (uint32_t)p->a[j++]) {
+		uint32_t x = p->a[j]>>33;
+		if(x<RNF->total_reads)
+		{
+			ha_gfa_printf(b, "A\t%s\t%d\t%c\t%.*s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
+			(int)Get_NAME_LENGTH((*RNF), x), Get_NAME((*RNF), x), 
+			coverage_cut[x].s, coverage_cut[x].e, x, "apmaaa"[RNF->trio_flag[x]]);
+		}
+		else
+		{
+			ha_gfa_printf(b, "A\t%s\t%d\t%c\t%s\t%d\t%d\tid:i:%d\tHG:A:%c\n", name, l, "+-"[p->a[j]>>32&1],
+				"FAKE", coverage_cut[x].s, coverage_cut[x].e, x, '*');
+		}
 	}
-	for (i = 0; i < ug->g->n_arc; ++i) { // the Link lines in GFA
+}
+
+static void worker_ug_fmt_link(void *data, long k, int tid)
+{
+	ha_gfa_fmt_t *f = (ha_gfa_fmt_t*)data;
+	const ma_ug_t *ug = f->ug;
+	uint64_t i, i0 = f->i0 + (uint64_t)k * HA_GFA_N_LINK, i1 = i0 + HA_GFA_N_LINK < f->n? i0 + HA_GFA_N_LINK : f->n;
+	for (i = i0; i < i1; ++i) { // the Link lines in GFA
 		uint32_t u = ug->g->arc[i].ul>>32, v = ug->g->arc[i].v;
-		fprintf(fp, "L\tutg%.6d%c\t%c\tutg%.6d%c\t%c\t%dM\tL1:i:%d\n", (u>>1)+1, "lc"[ug->u.a[u>>1].circ], "+-"[u&1],
+		ha_gfa_printf(&f->b[k], "L\tutg%.6d%c\t%c\tutg%.6d%c\t%c\t%dM\tL1:i:%d\n", (u>>1)+1, "lc"[ug->u.a[u>>1].circ], "+-"[u&1],
 				(v>>1)+1, "lc"[ug->u.a[v>>1].circ], "+-"[v&1], ug->g->arc[i].ol, asg_arc_len(ug->g->arc[i]));
-	}    
+	}
+}
+
+static void ha_gfa_print_links(ha_gfa_fmt_t *f, ha_gfa_out_t *o, uint64_t n_link, void (*func)(void*,long,int))
+{
+	uint64_t i, n;
+	f->n = n_link;
+	for (i = 0; i < n_link; i += n * HA_GFA_N_LINK) {
+		n = (n_link - i + HA_GFA_N_LINK - 1) / HA_GFA_N_LINK;
+		if (n > HA_GFA_N_JOB) n = HA_GFA_N_JOB;
+		f->i0 = i;
+		kt_for(asm_opt.thread_num, func, f, n);
+		ha_gfa_fmt_write(f, o, 0, n);
+	}
 }
 
-void ma_ug_print(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, FILE *fp)
+void ma_ug_print2(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, int print_seq, ha_gfa_out_t *o)
 {
-	ma_ug_print2(ug, RNF, coverage_cut, 1, fp);
+	ha_gfa_fmt_t f;
+	uint64_t i, k, n, len;
+	char name[32];
+	if (o == 0) return;
+	ha_gfa_fmt_init(&f);
+	f.ug = ug, f.RNF = RNF, f.coverage_cut = coverage_cut, f.print_seq = print_seq;
+	for (i = 0; i < ug->u.n; i += n) { // the Segment lines in GFA
+		for (n = len = 0; i + n < ug->u.n && n < HA_GFA_N_JOB && len < 1<<28; ++n)
+			len += (print_seq? ug->u.a[i+n].len : 0) + ug->u.a[i+n].n * 64;
+		f.i0 = i;
+		kt_for(asm_opt.thread_num, worker_ug_fmt_seg, &f, n);
+		for (k = 0; k < n; ++k) {
+			const ma_utg_t *p = &ug->u.a[i+k];
+			if (p->m == 0) continue;
+			sprintf(name, "utg%.6d%c", (int)(i + k) + 1, "lc"[p->circ]);
+			ha_gfa_seg(o, name, p->len);
+			ha_gfa_fmt_write(&f, o, k, k + 1);
+		}
+	}
+	ha_gfa_print_links(&f, o, ug->g->n_arc, worker_ug_fmt_link);
+	ha_gfa_fmt_destroy(&f);
+}
+
+void ma_ug_print(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, ha_gfa_out_t *o)
+{
+	ma_ug_print2(ug, RNF, coverage_cut, 1, o);
 }
 
 int asg_cut_internal(asg_t *g, int max_ext)
@@ -9621,27 +9977,34 @@ ma_hit_t_alloc* reverse_sources, int id, const char* command)
     
 }
 
-void ma_sg_print(const asg_t *g, const All_reads *RNF, const ma_sub_t *sub, FILE *fp)
+static void worker_sg_fmt_seg(void *data, long k, int tid)
 {
-	uint32_t i;
-    for (i = 0; i < g->n_seq; ++i) 
+	ha_gfa_fmt_t *f = (ha_gfa_fmt_t*)data;
+	const All_reads *RNF = f->RNF;
+	uint64_t i = f->i0 + k;
+    if(!f->g->seq[i].del)
     {
-        if(!g->seq[i].del)
-        {
-             fprintf(fp, 
-             "S\t%.*s\t*\tLN:i:%u\n",
-             (int)Get_NAME_LENGTH((*RNF), i), 
-             Get_NAME((*RNF), i),
-             g->seq[i].len);
-        }
+         ha_gfa_printf(&f->b[k], 
+         "S\t%.*s\t*\tLN:i:%u\n",
+         (int)Get_NAME_LENGTH((*RNF), i), 
+         Get_NAME((*RNF), i),
+         f->g->seq[i].len);
     }
+}
 
-	for (i = 0; i < g->n_arc; ++i) {
-		const asg_arc_t *p = &g->arc[i];
+static void worker_sg_fmt_link(void *data, long k, int tid)
+{
+	ha_gfa_fmt_t *f = (ha_gfa_fmt_t*)data;
+	const All_reads *RNF = f->RNF;
+	const ma_sub_t *sub = f->coverage_cut;
+	ha_gfa_buf_t *b = &f->b[k];
+	uint64_t i, i0 = f->i0 + (uint64_t)k * HA_GFA_N_LINK, i1 = i0 + HA_GFA_N_LINK < f->n? i0 + HA_GFA_N_LINK : f->n;
+	for (i = i0; i < i1; ++i) {
+		const asg_arc_t *p = &f->g->arc[i];
 		if (sub) {
 			const ma_sub_t *sq = &sub[p->ul>>33], *st = &sub[p->v>>1];
 
-            fprintf(fp, 
+            ha_gfa_printf(b, 
             "L\t%.*s:%d-%d\t%c\t%.*s:%d-%d\t%c\t%d:\tL1:i:%u\n", 
             (int)Get_NAME_LENGTH((*RNF), p->ul>>33), 
             Get_NAME((*RNF), p->ul>>33),
@@ -9654,7 +10017,7 @@ void ma_sg_print(const asg_t *g, const All_reads *RNF, const ma_sub_t *sub, FILE
 		} 
         else 
         {
-           fprintf(fp, "L\t%.*s\t%c\t%.*s\t%c\t%d:\tL1:i:%u\n", 
+           ha_gfa_printf(b, "L\t%.*s\t%c\t%.*s\t%c\t%d:\tL1:i:%u\n", 
             (int)Get_NAME_LENGTH((*RNF), p->ul>>33), 
             Get_NAME((*RNF), p->ul>>33),
             "+-"[p->ul>>32&1],
@@ -9665,10 +10028,35 @@ void ma_sg_print(const asg_t *g, const All_reads *RNF, const ma_sub_t *sub, FILE
 	}
 }
 
+void ma_sg_print(const asg_t *g, const All_reads *RNF, const ma_sub_t *sub, ha_gfa_out_t *o)
+{
+	ha_gfa_fmt_t f;
+	ha_gfa_buf_t name = {0,0,0};
+	uint64_t i, k, n;
+	if (o == 0) return;
+	ha_gfa_fmt_init(&f);
+	f.g = g, f.RNF = (All_reads*)RNF, f.coverage_cut = sub;
+	for (i = 0; i < g->n_seq; i += n) {
+		n = g->n_seq - i < HA_GFA_N_JOB? g->n_seq - i : HA_GFA_N_JOB;
+		f.i0 = i;
+		kt_for(asm_opt.thread_num, worker_sg_fmt_seg, &f, n);
+		for (k = 0; k < n; ++k) {
+			if (g->seq[i+k].del) continue;
+			name.l = 0;
+			ha_gfa_puts(&name, Get_NAME((*RNF), i+k), Get_NAME_LENGTH((*RNF), i+k));
+			ha_gfa_seg(o, name.s, g->seq[i+k].len);
+			ha_gfa_fmt_write(&f, o, k, k + 1);
+		}
+	}
+	free(name.s);
+	ha_gfa_print_links(&f, o, g->n_arc, worker_sg_fmt_link);
+	ha_gfa_fmt_destroy(&f);
+}
+
 
-void ma_ug_print_simple(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, FILE *fp)
+void ma_ug_print_simple(const ma_ug_t *ug, All_reads *RNF, const ma_sub_t *coverage_cut, ha_gfa_out_t *o)
 {
-	ma_ug_print2(ug, RNF, coverage_cut, 0, fp);
+	ma_ug_print2(ug, RNF, coverage_cut, 0, o);
 }
 
 
@@ -11133,6 +11521,8 @@ R_to_U* ruIndex)
 }
 
 
+ma_ug_t *ha_r_utg = NULL;
+
 void output_unitig_graph(asg_t *sg, ma_sub_t* coverage_cut, char* output_file_name, 
 ma_hit_t_alloc* sources, int max_hang, int min_ovlp)
 {
@@ -11144,18 +11534,16 @@ ma_hit_t_alloc* sources, int max_hang, int min_ovlp)
     ma_ug_seq(ug, sg, &R_INF, coverage_cut, sources, &new_rtg_edges, max_hang, min_ovlp);
 
     fprintf(stderr, "Writing raw unitig GFA to disk... \n");
-    char* gfa_name = (char*)malloc(strlen(output_file_name)+25);
-    sprintf(gfa_name, "%s.r_utg.gfa", output_file_name);
-    FILE* output_file = fopen(gfa_name, "w");
-    ma_ug_print(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-    sprintf(gfa_name, "%s.r_utg.noseq.gfa", output_file_name);
-    output_file = fopen(gfa_name, "w");
-    ma_ug_print_simple(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    free(gfa_name);
-    ma_ug_destroy(ug);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, "r_utg");
+    ma_ug_print(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    o = ha_gfa_open(output_file_name, "r_utg.noseq");
+    ma_ug_print_simple(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    if (asm_opt.flag & HA_F_KEEP_R_UTG) {
+        ma_ug_destroy(ha_r_utg);
+        ha_r_utg = ug;
+    } else ma_ug_destroy(ug);
     kv_destroy(new_rtg_edges.a);
 }
 
@@ -13311,7 +13699,6 @@ float chimeric_rate, float drop_ratio, int max_hang, int min_ovlp)
     char* gfa_name = (char*)malloc(strlen(output_file_name)+100);
     sprintf(gfa_name, "%s.%s.p_ctg.gfa", output_file_name, (flag==FATHER?"hap1":"hap2"));
     fprintf(stderr, "Writing %s to disk... \n", gfa_name);
-    FILE* output_file = fopen(gfa_name, "w");
 
     ma_ug_t *ug = NULL;
     ug = ma_ug_gen(sg);
@@ -13327,13 +13714,12 @@ float chimeric_rate, float drop_ratio, int max_hang, int min_ovlp)
     ///debug_untig_length(ug, tipsLen, gfa_name);
     ///print_untig_by_read(ug, "m64011_190901_095311/125831121/ccs", 2310925, "end");
     ma_ug_seq(ug, sg, &R_INF, coverage_cut, sources, &new_rtg_edges, max_hang, min_ovlp);
-    ma_ug_print(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    sprintf(gfa_name, "%s.%s.p_ctg.noseq.gfa", output_file_name, (flag==FATHER?"hap1":"hap2"));
-    output_file = fopen(gfa_name, "w");
-    ma_ug_print_simple(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, flag==FATHER?"hap1.p_ctg":"hap2.p_ctg");
+    ma_ug_print(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    o = ha_gfa_open(output_file_name, flag==FATHER?"hap1.p_ctg.noseq":"hap2.p_ctg.noseq");
+    ma_ug_print_simple(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
 
     free(gfa_name);
     ma_ug_destroy(ug);
@@ -13344,12 +13730,9 @@ float chimeric_rate, float drop_ratio, int max_hang, int min_ovlp)
 void output_read_graph(asg_t *sg, ma_sub_t* coverage_cut, char* output_file_name, long long n_read)
 {
     fprintf(stderr, "Writing read GFA to disk... \n");
-    char* gfa_name = (char*)malloc(strlen(output_file_name)+25);
-    sprintf(gfa_name, "%s.read.gfa", output_file_name);
-    FILE* output_file = fopen(gfa_name, "w");
-    ma_sg_print(sg, &R_INF, coverage_cut, output_file);
-    free(gfa_name);
-    fclose(output_file);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, "read");
+    ma_sg_print(sg, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
 }
 
 
@@ -13378,24 +13761,18 @@ void read_ma(ma_hit_t* x, FILE* fp)
     x->del = t;
 }
 
-int load_ma_hit_ts(ma_hit_t_alloc** x, char* read_file_name)
+void load_ma_hit_ts_fp(ma_hit_t_alloc** x, FILE* fp)
 {
-    fprintf(stderr, "Loading ma_hit_ts from disk... \n");
-    char* index_name = (char*)malloc(strlen(read_file_name)+15);
-    sprintf(index_name, "%s.bin", read_file_name);
-    FILE* fp = fopen(index_name, "r");
-    if(!fp)
-    {
-        return 0;
-    }
-
-
     long long n_read;
     long long i, k;
+    uint64_t hdr, n_hit = 0, m_hit;
     int f_flag;
+    ma_hit_t *a;
     f_flag = fread(&n_read, sizeof(n_read), 1, fp);
-    (*x) = (ma_hit_t_alloc*)malloc(sizeof(ma_hit_t_alloc)*n_read);
-
+    // load straight into the packed layout of ma_hit_pack(); hits go after the headers
+    hdr = MA_HIT_HDR(n_read);
+    m_hit = n_read > 0? n_read : 1;
+    (*x) = (ma_hit_t_alloc*)malloc(hdr + m_hit * sizeof(ma_hit_t));
 
     for (i = 0; i < n_read; i++)
     {        
@@ -13403,18 +13780,44 @@ int load_ma_hit_ts(ma_hit_t_alloc** x, char* read_file_name)
         f_flag += fread(&((*x)[i].is_abnormal), sizeof((*x)[i].is_abnormal), 1, fp);
         f_flag += fread(&((*x)[i].length), sizeof((*x)[i].length), 1, fp);
         (*x)[i].size = (*x)[i].length;
+        (*x)[i].is_packed = 1;
 
         (*x)[i].buffer = NULL;
         if((*x)[i].length == 0) continue;
-        
-        (*x)[i].buffer = (ma_hit_t*)malloc(sizeof(ma_hit_t)*(*x)[i].length);
 
+        if (n_hit + (*x)[i].length > m_hit) {
+            while (n_hit + (*x)[i].length > m_hit) m_hit += (m_hit>>1) + 1;
+            (*x) = (ma_hit_t_alloc*)realloc((*x), hdr + m_hit * sizeof(ma_hit_t));
+        }
+        a = (ma_hit_t*)((char*)(*x) + hdr) + n_hit;
         for (k = 0; k < (*x)[i].length; k++)
         {
-            read_ma(&((*x)[i].buffer[k]), fp);
-        }  
+            read_ma(&(a[k]), fp);
+        }
+        n_hit += (*x)[i].length;
     }
+    // the block may have moved while growing; point each list at its hits
+    (*x) = (ma_hit_t_alloc*)realloc((*x), hdr + (n_hit? n_hit : 1) * sizeof(ma_hit_t));
+    a = (ma_hit_t*)((char*)(*x) + hdr);
+    for (i = 0; i < n_read; i++)
+    {
+        (*x)[i].buffer = a;
+        a += (*x)[i].length;
+    }
+}
 
+int load_ma_hit_ts(ma_hit_t_alloc** x, char* read_file_name)
+{
+    fprintf(stderr, "Loading ma_hit_ts from disk... \n");
+    char* index_name = (char*)malloc(strlen(read_file_name)+15);
+    sprintf(index_name, "%s.bin", read_file_name);
+    FILE* fp = fopen(index_name, "r");
+    if(!fp)
+    {
+        free(index_name);
+        return 0;
+    }
+    load_ma_hit_ts_fp(x, fp);
     free(index_name);    
     fclose(fp);
     fprintf(stderr, "ma_hit_ts has been read.\n");
@@ -13445,12 +13848,8 @@ void write_ma(ma_hit_t* x, FILE* fp)
 }
 
 
-void write_ma_hit_ts(ma_hit_t_alloc* x, long long n_read, char* read_file_name)
+void write_ma_hit_ts_fp(ma_hit_t_alloc* x, long long n_read, FILE* fp)
 {
-    fprintf(stderr, "Writing ma_hit_ts to disk... \n");
-    char* index_name = (char*)malloc(strlen(read_file_name)+15);
-    sprintf(index_name, "%s.bin", read_file_name);
-    FILE* fp = fopen(index_name, "w");
     long long i, k;
     fwrite(&n_read, sizeof(n_read), 1, fp);
 
@@ -13465,16 +13864,26 @@ void write_ma_hit_ts(ma_hit_t_alloc* x, long long n_read, char* read_file_name)
             write_ma(x[i].buffer + k, fp);
         }  
     }
+}
 
-
+void write_ma_hit_ts(ma_hit_t_alloc* x, long long n_read, char* read_file_name)
+{
+    fprintf(stderr, "Writing ma_hit_ts to disk... \n");
+    char* index_name = (char*)malloc(strlen(read_file_name)+15);
+    sprintf(index_name, "%s.bin", read_file_name);
+    FILE* fp = fopen(index_name, "w");
+    write_ma_hit_ts_fp(x, n_read, fp);
     free(index_name);
     fflush(fp);    
     fclose(fp);
     fprintf(stderr, "ma_hit_ts has been written.\n");
 }
 
+static const char *ha_ovlp_sfx[3] = { "ec", "ovlp.source", "ovlp.reverse" };
+
 void write_all_data_to_disk(ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources, All_reads *RNF, char* output_file_name)
 {   
+	int i;
 	char* gfa_name = (char*)malloc(strlen(output_file_name)+25);
 	sprintf(gfa_name, "%s.ec", output_file_name);
 	write_All_reads(RNF, gfa_name);
@@ -13485,12 +13894,24 @@ void write_all_data_to_disk(ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sou
 	sprintf(gfa_name, "%s.ovlp.reverse", output_file_name);
 	write_ma_hit_ts(reverse_sources, RNF->total_reads, gfa_name);
 
+	for (i = 0; i < 3; ++i) {
+		sprintf(gfa_name, "%s.%s.bin", output_file_name, ha_ovlp_sfx[i]);
+		ha_ckpt_seal(gfa_name, HA_CKPT_OVLP);
+	}
 	free(gfa_name);
 }
 
 int load_all_data_from_disk(ma_hit_t_alloc **sources, ma_hit_t_alloc **reverse_sources, char* output_file_name)
 {
+	int i;
 	char* gfa_name = (char*)malloc(strlen(output_file_name)+25);
+	for (i = 0; i < 3; ++i) {
+		sprintf(gfa_name, "%s.%s.bin", output_file_name, ha_ovlp_sfx[i]);
+		if (!ha_ckpt_check(gfa_name, HA_CKPT_OVLP)) {
+			free(gfa_name);
+			return 0;
+		}
+	}
 	sprintf(gfa_name, "%s.ec", output_file_name);
 	if (!load_All_reads(&R_INF, gfa_name)) {
 		free(gfa_name);
@@ -21720,7 +22141,7 @@ int load_ruIndex(R_to_U* ruIndex, char* read_file_name)
     (ruIndex)->index = (uint32_t*)malloc(sizeof(uint32_t)*(ruIndex)->len);
     f_flag += fread((ruIndex)->index, sizeof((ruIndex)->index[0]), (ruIndex)->len, fp);
 
-    R_INF.trio_flag = (uint8_t*)malloc(sizeof(uint8_t)*(ruIndex)->len);
+    R_INF.trio_flag = (uint8_t*)realloc(R_INF.trio_flag, sizeof(uint8_t)*(ruIndex)->len);
     f_flag += fread(R_INF.trio_flag, sizeof(R_INF.trio_flag[0]), (ruIndex)->len, fp);
 
     free(index_name);    
@@ -21898,6 +22319,9 @@ int load_asg_t(asg_t **sg, char* read_file_name)
 }
 
 
+///the debug graph is also the checkpoint of the cleaned graph
+static const char *ha_graph_sfx[5] = { "source", "reverse", "coverage_cut", "ruIndex", "asg_t" };
+
 int write_debug_graph(asg_t *sg, ma_hit_t_alloc* sources, ma_sub_t* coverage_cut, 
 char* output_file_name, long long n_read, ma_hit_t_alloc* reverse_sources, R_to_U* ruIndex)
 {
@@ -21915,86 +22339,76 @@ char* output_file_name, long long n_read, ma_hit_t_alloc* reverse_sources, R_to_
     write_ruIndex(ruIndex, gfa_name);
     sprintf(gfa_name, "%s.all.debug.asg_t", output_file_name);
     write_asg_t(sg, gfa_name);
+    for (int i = 0; i < 5; ++i)
+    {
+        sprintf(gfa_name, "%s.all.debug.%s.bin", output_file_name, ha_graph_sfx[i]);
+        ha_ckpt_seal(gfa_name, HA_CKPT_GRAPH);
+    }
     free(gfa_name);
     fprintf(stderr, "debug_graph has been written.\n");
     return 1;
 }
 
 
+static void destory_ma_hit_t_allocs(ma_hit_t_alloc* x, long long n) // all lists and the array; x may be packed
+{
+    long long i;
+    if (x == NULL) return;
+    for (i = 0; i < n; i++) destory_ma_hit_t_alloc(&x[i]);
+    free(x);
+}
+
 int load_debug_graph(asg_t** sg, ma_hit_t_alloc** sources, ma_sub_t** coverage_cut, 
 char* output_file_name, ma_hit_t_alloc** reverse_sources, R_to_U* ruIndex)
 {
-    FILE* fp = NULL;
+    ma_hit_t_alloc *src = NULL, *rev = NULL;
+    ma_sub_t *cov = NULL;
+    asg_t *g = NULL;
+    R_to_U ru = {0, 0};
+    int ok;
     char* gfa_name = (char*)malloc(strlen(output_file_name)+55);
-    sprintf(gfa_name, "%s.all.debug.source.bin", output_file_name);
-    fp = fopen(gfa_name, "r"); if(!fp) return 0;
-    sprintf(gfa_name, "%s.all.debug.reverse.bin", output_file_name);
-    fp = fopen(gfa_name, "r"); if(!fp) return 0;
-    sprintf(gfa_name, "%s.all.debug.coverage_cut.bin", output_file_name);
-    fp = fopen(gfa_name, "r"); if(!fp) return 0;
-    sprintf(gfa_name, "%s.all.debug.ruIndex.bin", output_file_name);
-    fp = fopen(gfa_name, "r"); if(!fp) return 0;
-    sprintf(gfa_name, "%s.all.debug.asg_t.bin", output_file_name);
-    fp = fopen(gfa_name, "r"); if(!fp) return 0;
-
-
-    if((*sources)!=NULL)
-    {
-        destory_ma_hit_t_alloc((*sources));
-    }
-
-    if((*reverse_sources)!=NULL)
-    {
-        destory_ma_hit_t_alloc((*reverse_sources));
-    }
-
-    if((*coverage_cut)!=NULL)
-    {
-        free((*coverage_cut));
-    }
-
-    if((ruIndex)!=NULL)
-    {
-        destory_R_to_U((ruIndex));
-    }
-
-    if((*sg)!=NULL)
+    for (int i = 0; i < 5; ++i)
     {
-        asg_destroy(*sg);
+        sprintf(gfa_name, "%s.all.debug.%s.bin", output_file_name, ha_graph_sfx[i]);
+        if(!ha_ckpt_check(gfa_name, HA_CKPT_GRAPH))
+        {
+            free(gfa_name);
+            return 0;
+        }
     }
 
-    
-
+    // load everything before touching the current graph so that a failure leaves it intact
     sprintf(gfa_name, "%s.all.debug.source", output_file_name);
-    if(!load_ma_hit_ts(sources, gfa_name))
-    {
-        return 0;
-    }
-
+    ok = load_ma_hit_ts(&src, gfa_name);
     sprintf(gfa_name, "%s.all.debug.reverse", output_file_name);
-    if(!load_ma_hit_ts(reverse_sources, gfa_name))
-    {
-        return 0;
-    }
-
+    ok = ok && load_ma_hit_ts(&rev, gfa_name);
     sprintf(gfa_name, "%s.all.debug.coverage_cut", output_file_name);
-    if(!load_coverage_cut(coverage_cut, gfa_name))
-    {
-        return 0;
-    }
-
+    ok = ok && load_coverage_cut(&cov, gfa_name);
     sprintf(gfa_name, "%s.all.debug.ruIndex", output_file_name);
-    if(!load_ruIndex(ruIndex, gfa_name))
-    {
-        return 0;
-    }
-
+    ok = ok && load_ruIndex(&ru, gfa_name);
     sprintf(gfa_name, "%s.all.debug.asg_t", output_file_name);
-    if(!load_asg_t(sg, gfa_name))
+    ok = ok && load_asg_t(&g, gfa_name);
+    free(gfa_name);
+    if (!ok)
     {
+        destory_ma_hit_t_allocs(src, R_INF.total_reads);
+        destory_ma_hit_t_allocs(rev, R_INF.total_reads);
+        free(cov);
+        free(ru.index);
+        if (g) asg_destroy(g);
         return 0;
     }
 
+    // the old lists are R_INF.paf/reverse_paf; free every list, then point R_INF at the loaded ones
+    destory_ma_hit_t_allocs(*sources, R_INF.total_reads);
+    if ((*reverse_sources) != (*sources)) destory_ma_hit_t_allocs(*reverse_sources, R_INF.total_reads);
+    free(*coverage_cut);
+    if (ruIndex != NULL) destory_R_to_U(ruIndex);
+    if (*sg != NULL) asg_destroy(*sg);
+
+    *sources = src, *reverse_sources = rev, *coverage_cut = cov, *sg = g;
+    if (ruIndex != NULL) *ruIndex = ru;
+    else free(ru.index);
     R_INF.paf = (*sources); R_INF.reverse_paf = (*reverse_sources);
 
     return 1;
@@ -22175,18 +22589,12 @@ long long tipsLen, R_to_U* ruIndex, int max_hang, int min_ovlp)
     ma_ug_seq(ug, sg, &R_INF, coverage_cut, sources, &new_rtg_edges, max_hang, min_ovlp);
 
     fprintf(stderr, "Writing processed unitig GFA to disk... \n");
-    char* gfa_name = (char*)malloc(strlen(output_file_name)+35);
-    sprintf(gfa_name, "%s.p_utg.gfa", output_file_name);
-    FILE* output_file = fopen(gfa_name, "w");
-    ma_ug_print(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-    
-    sprintf(gfa_name, "%s.p_utg.noseq.gfa", output_file_name);
-    output_file = fopen(gfa_name, "w");
-    ma_ug_print_simple(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    free(gfa_name);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, "p_utg");
+    ma_ug_print(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    o = ha_gfa_open(output_file_name, "p_utg.noseq");
+    ma_ug_print_simple(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
     ma_ug_destroy(ug);
     kv_destroy(new_rtg_edges.a);
 }
@@ -22211,18 +22619,12 @@ R_to_U* ruIndex, float chimeric_rate, float drop_ratio, int max_hang, int min_ov
 
     
     fprintf(stderr, "Writing primary contig GFA to disk... \n");
-    char* gfa_name = (char*)malloc(strlen(output_file_name)+35);
-    sprintf(gfa_name, "%s.p_ctg.gfa", output_file_name);
-    FILE* output_file = fopen(gfa_name, "w");
-    ma_ug_print(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    sprintf(gfa_name, "%s.p_ctg.noseq.gfa", output_file_name);
-    output_file = fopen(gfa_name, "w");
-    ma_ug_print_simple(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    free(gfa_name);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, "p_ctg");
+    ma_ug_print(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    o = ha_gfa_open(output_file_name, "p_ctg.noseq");
+    ma_ug_print_simple(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
     ma_ug_destroy(ug);
     kv_destroy(new_rtg_edges.a);
 }
@@ -22240,18 +22642,12 @@ ma_hit_t_alloc* sources, int max_hang, int min_ovlp)
     ma_ug_seq(ug, sg, &R_INF, coverage_cut, sources, &new_rtg_edges, max_hang, min_ovlp);
 
     fprintf(stderr, "Writing alternate contig GFA to disk... \n");
-    char* gfa_name = (char*)malloc(strlen(output_file_name)+35);
-    sprintf(gfa_name, "%s.a_ctg.gfa", output_file_name);
-    FILE* output_file = fopen(gfa_name, "w");
-    ma_ug_print(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-    
-    sprintf(gfa_name, "%s.a_ctg.noseq.gfa", output_file_name);
-    output_file = fopen(gfa_name, "w");
-    ma_ug_print_simple(ug, &R_INF, coverage_cut, output_file);
-    fclose(output_file);
-
-    free(gfa_name);
+    ha_gfa_out_t *o = ha_gfa_open(output_file_name, "a_ctg");
+    ma_ug_print(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
+    o = ha_gfa_open(output_file_name, "a_ctg.noseq");
+    ma_ug_print_simple(ug, &R_INF, coverage_cut, o);
+    ha_gfa_close(o);
     ma_ug_destroy(ug);
     kv_destroy(new_rtg_edges.a);
 }
@@ -26265,13 +26661,11 @@ ma_sub_t **coverage_cut_ptr, int debug_g)
 
     asg_arc_del_simple_circle_untig(sources, coverage_cut, sg, 100, 0);
 
-    if (asm_opt.flag & HA_F_VERBOSE_GFA)
+    if ((asm_opt.flag & HA_F_VERBOSE_GFA) || asm_opt.write_index_to_disk)
     {
-        /*******************************for debug***************************************/
         write_debug_graph(sg, sources, coverage_cut, output_file_name, n_read, reverse_sources, ruIndex);
-        debug_gfa:;
-        /*******************************for debug***************************************/
     }
+    debug_gfa:;
     
     /**
     debug_ma_hit_t(sources, coverage_cut, n_read, max_hang_length, 
@@ -26335,7 +26729,7 @@ int min_dp, ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources,
 long long n_read, uint64_t* readLen, long long mini_overlap_length, 
 long long max_hang_length, long long clean_round, long long gap_fuzz,
 float min_ovlp_drop_ratio, float max_ovlp_drop_ratio, char* output_file_name, 
-long long bubble_dist, int read_graph, int write)
+long long bubble_dist, int read_graph)
 {
     R_to_U ruIndex;
     init_R_to_U(&ruIndex, n_read);
@@ -26347,11 +26741,11 @@ long long bubble_dist, int read_graph, int write)
     ///actually min_thres = asm_opt.max_short_tip + 1 there are asm_opt.max_short_tip reads
     min_thres = asm_opt.max_short_tip + 1;
 
-    if (asm_opt.flag & HA_F_VERBOSE_GFA)
+    if ((asm_opt.flag & HA_F_VERBOSE_GFA) || asm_opt.load_index_from_disk)
     {
         if(load_debug_graph(&sg, &sources, &coverage_cut, output_file_name, &reverse_sources, &ruIndex))
         {
-            fprintf(stderr, "debug gfa has been loaded\n");
+            fprintf(stderr, "[M::%s::%.3f*%.2f] ==> loaded the cleaned graph from disk\n", __func__, yak_realtime(), yak_cpu_usage());
             
             clean_graph(min_dp, sources, reverse_sources, n_read, readLen, mini_overlap_length, 
             max_hang_length, clean_round, gap_fuzz, min_ovlp_drop_ratio, max_ovlp_drop_ratio, 
@@ -26363,12 +26757,6 @@ long long bubble_dist, int read_graph, int write)
         }
     }
     
-    if (asm_opt.write_index_to_disk && write)
-    {
-        write_all_data_to_disk(sources, reverse_sources, 
-        &R_INF, output_file_name);
-    }
-
     try_rescue_overlaps(sources, reverse_sources, n_read, 4); 
 
     clean_graph(min_dp, sources, reverse_sources, n_read, readLen, mini_overlap_length, 
@@ -64,6 +64,7 @@ typedef struct {
     uint32_t length;
 	uint8_t is_fully_corrected;
 	uint8_t is_abnormal;
+	uint8_t is_packed; // buffer points into a block built by ma_hit_pack(); not freed on its own
 } ma_hit_t_alloc;
 
 
@@ -72,11 +73,14 @@ void clear_ma_hit_t_alloc(ma_hit_t_alloc* x);
 void resize_ma_hit_t_alloc(ma_hit_t_alloc* x, uint32_t size);
 void destory_ma_hit_t_alloc(ma_hit_t_alloc* x);
 void add_ma_hit_t_alloc(ma_hit_t_alloc* x, ma_hit_t* element);
+ma_hit_t_alloc *ma_hit_pack(ma_hit_t_alloc *x, long long n);
 void ma_hit_sort_tn(ma_hit_t *a, long long n);
 void ma_hit_sort_qns(ma_hit_t *a, long long n);
 
 int load_all_data_from_disk(ma_hit_t_alloc **sources, ma_hit_t_alloc **reverse_sources, 
 char* output_file_name);
+void write_ma_hit_ts_fp(ma_hit_t_alloc* x, long long n_read, FILE* fp);
+void load_ma_hit_ts_fp(ma_hit_t_alloc** x, FILE* fp);
 
 
 
@@ -127,6 +131,7 @@ typedef struct {
 
 	asg_seq_t *seq;
 	uint64_t *idx;
+	uint32_t m_idx; // number of vertices covered by idx; 0 if idx was not built by asg_arc_index()
 
 	uint8_t* seq_vis;
 
@@ -154,6 +159,10 @@ typedef struct {
 	asg_t *g;
 } ma_ug_t;
 
+extern ma_ug_t *ha_r_utg; // raw unitigs kept by output_unitig_graph() with HA_F_KEEP_R_UTG; owned by the caller
+
+void ma_ug_destroy(ma_ug_t *ug);
+
 typedef struct {
 	uint32_t utg:31, ori:1, start, len;
 } utg_intv_t;
@@ -437,7 +446,7 @@ int min_dp, ma_hit_t_alloc* sources, ma_hit_t_alloc* reverse_sources,
 long long n_read, uint64_t* readLen, long long mini_overlap_length, 
 long long max_hang_length, long long clean_round, long long gap_fuzz,
 float min_ovlp_drop_ratio, float max_ovlp_drop_ratio, char* output_file_name, 
-long long bubble_dist, int read_graph, int write);
+long long bubble_dist, int read_graph);
 
 void debug_info_of_specfic_read(char* name, ma_hit_t_alloc* sources, 
 ma_hit_t_alloc* reverse_sources, int id, char* command);
@@ -3,25 +3,68 @@
 #include "POA.h"
 #include "Correct.h"
 #include "Process_Read.h"
-#define INIT_EDGE_SIZE 50
-#define INCREASE_EDGE_SIZE 5
+#define INIT_EDGE_SIZE 4
+#define EDGE_ARENA_BLOCK 65536
 #define INIT_NODE_SIZE 16000
 
+/**************
+ * Edge arena *
+ **************/
+
+static void init_Edge_arena(Edge_arena* a)
+{
+	memset(a, 0, sizeof(Edge_arena));
+}
+
+static void destory_Edge_arena(Edge_arena* a)
+{
+	uint64_t i;
+	for (i = 0; i < a->n_blk; i++)
+		free(a->blk[i]);
+	free(a->blk);
+	free(a->blk_size);
+}
+
+static void clear_Edge_arena(Edge_arena* a)
+{
+	a->cur = a->off = 0;
+}
+
+static Edge* alloc_Edge_arena(Edge_arena* a, uint64_t n)
+{
+	Edge* p;
+	if (a->n_blk == 0 || a->off + n > a->blk_size[a->cur]) {
+		uint64_t size = n > EDGE_ARENA_BLOCK? n : EDGE_ARENA_BLOCK;
+		if (a->n_blk > 0) a->cur++;
+		a->off = 0;
+		if (a->cur == a->n_blk) {
+			a->n_blk++;
+			a->blk = (Edge**)realloc(a->blk, sizeof(Edge*) * a->n_blk);
+			a->blk_size = (uint64_t*)realloc(a->blk_size, sizeof(uint64_t) * a->n_blk);
+			a->blk[a->cur] = NULL;
+			a->blk_size[a->cur] = 0;
+		}
+		if (a->blk_size[a->cur] < size) { // blocks after cur hold no live edges
+			free(a->blk[a->cur]);
+			a->blk[a->cur] = (Edge*)malloc(sizeof(Edge) * size);
+			a->blk_size[a->cur] = size;
+		}
+	}
+	p = a->blk[a->cur] + a->off;
+	a->off += n;
+	return p;
+}
+
 /********
  * Edge *
  ********/
 
 void init_Edge_alloc(Edge_alloc* list)
 {
-	if (list->list == NULL) {
-		list->size = INIT_EDGE_SIZE;
-		list->length = 0;
-		list->delete_length = 0;
-		list->list = (Edge*)malloc(sizeof(Edge)*list->size);
-	} else {
-		list->length = 0;
-		list->delete_length = 0;
-	}
+	list->list = NULL;
+	list->size = 0;
+	list->length = 0;
+	list->delete_length = 0;
 }
 
 void clear_Edge_alloc(Edge_alloc* list)
@@ -30,19 +73,13 @@ void clear_Edge_alloc(Edge_alloc* list)
     list->delete_length = 0;
 }
 
-void destory_Edge_alloc(Edge_alloc* list)
-{
-	if (list && list->list)
-	    free(list->list);
-}
-
-void append_Edge_alloc(Edge_alloc* list,  uint64_t in_node, uint64_t out_node, uint64_t weight, uint64_t length)
+void append_Edge_alloc(Graph* g, Edge_alloc* list,  uint64_t in_node, uint64_t out_node, uint64_t weight, uint64_t length)
 {
 	if (list->length + 1 > list->size) {
-		uint64_t old_size = list->size;
-		list->size = list->size + INCREASE_EDGE_SIZE;
-		list->list = (Edge*)realloc(list->list, sizeof(Edge)*list->size);
-		memset(&list->list[old_size], 0, (list->size - old_size) * sizeof(Edge));
+		Edge* old_list = list->list;
+		list->size = list->size? list->size * 2 : INIT_EDGE_SIZE;
+		list->list = alloc_Edge_arena(&g->g_edges, list->size);
+		if (list->length) memcpy(list->list, old_list, sizeof(Edge) * list->length);
 	}
 
 	list->list[list->length].in_node = in_node;
@@ -63,8 +100,8 @@ int add_and_check_bi_direction_edge(Graph* graph, Node* in_node, Node* out_node,
     //if there are no edge from in_node to out_node
     if(!get_bi_Edge(graph, in_node, out_node, &e_forward, &e_backward))
     {
-        append_Edge_alloc(&(Output_Edges((*in_node))), (*in_node).ID, (*out_node).ID, weight, flag);
-        append_Edge_alloc(&(Input_Edges((*out_node))), (*in_node).ID, (*out_node).ID, weight, flag);
+        append_Edge_alloc(graph, &(Output_Edges((*in_node))), (*in_node).ID, (*out_node).ID, weight, flag);
+        append_Edge_alloc(graph, &(Input_Edges((*out_node))), (*in_node).ID, (*out_node).ID, weight, flag);
 
         Output_Edges((*in_node)).list[Output_Edges((*in_node)).length - 1].reverse_edge_ID 
         = Input_Edges((*out_node)).length - 1;
@@ -83,8 +120,8 @@ int add_and_check_bi_direction_edge(Graph* graph, Node* in_node, Node* out_node,
 void add_bi_direction_edge(Graph* graph, Node* in_node, Node* out_node, uint64_t weight, uint64_t flag)
 {
 
-    append_Edge_alloc(&(Output_Edges((*in_node))), (*in_node).ID, (*out_node).ID, weight, flag);
-    append_Edge_alloc(&(Input_Edges((*out_node))), (*in_node).ID, (*out_node).ID, weight, flag);
+    append_Edge_alloc(graph, &(Output_Edges((*in_node))), (*in_node).ID, (*out_node).ID, weight, flag);
+    append_Edge_alloc(graph, &(Input_Edges((*out_node))), (*in_node).ID, (*out_node).ID, weight, flag);
 
     Output_Edges((*in_node)).list[Output_Edges((*in_node)).length - 1].reverse_edge_ID 
     = Input_Edges((*out_node)).length - 1;
@@ -103,22 +140,22 @@ int remove_and_check_bi_direction_edge_from_nodes(Graph* graph, Node* in_node, N
     //2. increase the edge_list.delete_length in both in_node and out_node
     if(get_bi_Edge(graph, in_node, out_node, &e_forward, &e_backward))
     {
-        e_forward->in_node = (uint64_t)-1;
-        e_forward->out_node = (uint64_t)-1;
-        e_forward->weight = (uint64_t)-1;
-        e_forward->length = (uint64_t)-1;
-        e_forward->num_insertions = (uint64_t)-1;
-        e_forward->self_edge_ID = (uint64_t)-1;
-        e_forward->reverse_edge_ID = (uint64_t)-1;
-
-
-        e_backward->in_node = (uint64_t)-1;
-        e_backward->out_node = (uint64_t)-1;
-        e_backward->weight = (uint64_t)-1;
-        e_backward->length = (uint64_t)-1;
-        e_backward->num_insertions = (uint64_t)-1;
-        e_backward->self_edge_ID = (uint64_t)-1;
-        e_backward->reverse_edge_ID = (uint64_t)-1;
+        e_forward->in_node = (uint32_t)-1;
+        e_forward->out_node = (uint32_t)-1;
+        e_forward->weight = (uint32_t)-1;
+        e_forward->length = (uint32_t)-1;
+        e_forward->num_insertions = (uint32_t)-1;
+        e_forward->self_edge_ID = (uint32_t)-1;
+        e_forward->reverse_edge_ID = (uint32_t)-1;
+
+
+        e_backward->in_node = (uint32_t)-1;
+        e_backward->out_node = (uint32_t)-1;
+        e_backward->weight = (uint32_t)-1;
+        e_backward->length = (uint32_t)-1;
+        e_backward->num_insertions = (uint32_t)-1;
+        e_backward->self_edge_ID = (uint32_t)-1;
+        e_backward->reverse_edge_ID = (uint32_t)-1;
 
         Output_Edges(*in_node).delete_length++;
         Input_Edges((*out_node)).delete_length++;
@@ -142,22 +179,22 @@ int remove_and_check_bi_direction_edge_from_edge(Graph* graph, Edge* e)
         Output_Edges(G_Node(*graph, e_forward->in_node)).delete_length++;
         Input_Edges(G_Node(*graph, e_forward->out_node)).delete_length++;
 
-        e_forward->in_node = (uint64_t)-1;
-        e_forward->out_node = (uint64_t)-1;
-        e_forward->weight = (uint64_t)-1;
-        e_forward->length = (uint64_t)-1;
-        e_forward->num_insertions = (uint64_t)-1;
-        e_forward->self_edge_ID = (uint64_t)-1;
-        e_forward->reverse_edge_ID = (uint64_t)-1;
+        e_forward->in_node = (uint32_t)-1;
+        e_forward->out_node = (uint32_t)-1;
+        e_forward->weight = (uint32_t)-1;
+        e_forward->length = (uint32_t)-1;
+        e_forward->num_insertions = (uint32_t)-1;
+        e_forward->self_edge_ID = (uint32_t)-1;
+        e_forward->reverse_edge_ID = (uint32_t)-1;
 
 
-        e_backward->in_node = (uint64_t)-1;
-        e_backward->out_node = (uint64_t)-1;
-        e_backward->weight = (uint64_t)-1;
-        e_backward->length = (uint64_t)-1;
-        e_backward->num_insertions = (uint64_t)-1;
-        e_backward->self_edge_ID = (uint64_t)-1;
-        e_backward->reverse_edge_ID = (uint64_t)-1;
+        e_backward->in_node = (uint32_t)-1;
+        e_backward->out_node = (uint32_t)-1;
+        e_backward->weight = (uint32_t)-1;
+        e_backward->length = (uint32_t)-1;
+        e_backward->num_insertions = (uint32_t)-1;
+        e_backward->self_edge_ID = (uint32_t)-1;
+        e_backward->reverse_edge_ID = (uint32_t)-1;
 
         return 1;
     }
@@ -180,12 +217,6 @@ void init_Node_alloc(Node_alloc* list)
 
 void destory_Node_alloc(Node_alloc* list)
 {
-	uint64_t i;
-	for (i = 0; i < list->size; i++) {
-		destory_Edge_alloc(&list->list[i].deletion_edges);
-		destory_Edge_alloc(&list->list[i].insertion_edges);
-		destory_Edge_alloc(&list->list[i].mismatch_edges);
-	}
 	free(list->list);
 	free(list->sort.list);
 	free(list->sort.visit);
@@ -193,14 +224,9 @@ void destory_Node_alloc(Node_alloc* list)
 	free(list->sort.iterative_buffer_visit);
 }
 
+///the edges of a node are reset by append_Node_alloc() when it is reused
 void clear_Node_alloc(Node_alloc* list)
 {
-	uint64_t i =0;
-	for (i = 0; i < list->length; i++) { // TODO: is this list->size or list->length? The original version is list->length.
-		clear_Edge_alloc(&list->list[i].insertion_edges);
-		clear_Edge_alloc(&list->list[i].mismatch_edges);
-		clear_Edge_alloc(&list->list[i].deletion_edges);
-	}
 	list->length = 0;
 	list->delete_length = 0;
 }
@@ -234,6 +260,7 @@ uint64_t append_Node_alloc(Node_alloc* list, char base)
 void init_Graph(Graph* g)
 {
     init_Node_alloc(&g->g_nodes);
+    init_Edge_arena(&g->g_edges);
     g->g_n_edges = 0;
     g->g_n_nodes = 0;
     g->g_next_nodeID = 0;
@@ -248,12 +275,14 @@ void init_Graph(Graph* g)
 void destory_Graph(Graph* g)
 {
     destory_Node_alloc(&g->g_nodes);
+    destory_Edge_arena(&g->g_edges);
     destory_Queue(&(g->node_q));
 }
 
 void clear_Graph(Graph* g)
 {
     clear_Node_alloc(&g->g_nodes);
+    clear_Edge_arena(&g->g_edges);
 
     g->g_n_edges = 0;
     g->g_n_nodes = 0;
@@ -292,7 +321,7 @@ void addUnmatchedSeqToGraph(Graph* g, char* g_read_seq, long long g_read_length,
         if (lastID != -1)
         {
             ///the legnth of match edge is 0, while the length of musmatch is 1
-            append_Edge_alloc(&(g->g_nodes.list[lastID].mismatch_edges), lastID, nodeID, 1, 0);
+            append_Edge_alloc(g, &(g->g_nodes.list[lastID].mismatch_edges), lastID, nodeID, 1, 0);
         }
 
         lastID = nodeID; 
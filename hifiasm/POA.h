@@ -116,32 +116,46 @@ inline int pop_from_Queue(Queue* q, long long* nodeID)
 
 
 
+///node IDs and counts fit in 32 bits: a graph only covers one window
 typedef struct
 {
-    uint64_t in_node;
-    uint64_t out_node;
+    uint32_t in_node;
+    uint32_t out_node;
     ///0 is match，1 is mismatch，2 means y has more bases, 3 means x has more bases
-    uint64_t weight;
-    uint64_t num_insertions;
-    uint64_t length;
-    uint64_t self_edge_ID;
-    uint64_t reverse_edge_ID;
+    uint32_t weight;
+    uint32_t num_insertions;
+    uint32_t length;
+    uint32_t self_edge_ID;
+    uint32_t reverse_edge_ID;
 } Edge;
 
+///a slab of the Edge_arena of the graph; it is moved to a new slab twice as large when full
 typedef struct
 {
     Edge* list;
-    uint64_t size;
-    uint64_t length;
-    uint64_t delete_length;
+    uint32_t size;
+    uint32_t length;
+    uint32_t delete_length;
 } Edge_alloc;
 
+///the edges of all nodes of a graph are carved out of blocks that are only freed by destory_Graph(),
+///so an Edge* stays valid until its own slab grows, and clear_Graph() just rewinds to the first block
+typedef struct
+{
+    Edge** blk;
+    uint64_t* blk_size;
+    uint64_t n_blk;
+    ///current block and the first free edge in it
+    uint64_t cur;
+    uint64_t off;
+} Edge_arena;
+
 #define Real_Length(X) ((X).length - (X).delete_length)
 #define Input_Edges(Node) ((Node).insertion_edges)
 #define Output_Edges(Node) ((Node).deletion_edges)
 #define G_Node(G, Node) ((G).g_nodes.list[(Node)])
 #define If_Node_Exist(Node) ((Node).base != 'D')
-#define If_Edge_Exist(E) ((E).out_node != (uint64_t)-1)
+#define If_Edge_Exist(E) ((E).out_node != (uint32_t)-1)
 #define Visit(E) (E).length
 
 typedef struct
@@ -195,7 +209,7 @@ typedef struct
     uint64_t g_n_edges;
     uint64_t g_next_nodeID;
     Node_alloc g_nodes;
-
+    Edge_arena g_edges;
 
     Queue node_q;
     char* seq;
@@ -418,8 +432,7 @@ inline long long get_Edge_Weight(Graph* DAGCon, Node* inNode, Node* outNode)
 
 void init_Edge_alloc(Edge_alloc* list);
 void clear_Edge_alloc(Edge_alloc* list);
-void destory_Edge_alloc(Edge_alloc* list);
-void append_Edge_alloc(Edge_alloc* list,  uint64_t in_node, uint64_t out_node, uint64_t weight, uint64_t length);
+void append_Edge_alloc(Graph* g, Edge_alloc* list,  uint64_t in_node, uint64_t out_node, uint64_t weight, uint64_t length);
 
 void init_Node_alloc(Node_alloc* list);
 void destory_Node_alloc(Node_alloc* list);
@@ -517,7 +530,7 @@ inline void add_mismatchEdge_weight(Graph* g, uint64_t in_node, char base, int l
         nodeID  = add_Node_Graph(g, base);
         
         ///the length of match edge is 0, while the length of mismatch edge is 1
-        append_Edge_alloc(edge, in_node, nodeID, 1, 1);
+        append_Edge_alloc(g, edge, in_node, nodeID, 1, 1);
         ///if last operation is insertion
         if (last_operation == 2)
         {
@@ -525,7 +538,7 @@ inline void add_mismatchEdge_weight(Graph* g, uint64_t in_node, char base, int l
         }
 
         ///add the mismatch_edges of new node to the backbone
-        append_Edge_alloc(&(g->g_nodes.list[nodeID].mismatch_edges), nodeID, in_node + 1, 1, 0);
+        append_Edge_alloc(g, &(g->g_nodes.list[nodeID].mismatch_edges), nodeID, in_node + 1, 1, 0);
     }
 }
 
@@ -550,7 +563,7 @@ inline void add_single_deletionEdge_weight(Graph* g, long long alignNodeID, long
     ///there are no such edge
     if (i == (long long)edge->length)
     {
-        append_Edge_alloc(edge, alignNodeID, nextNodeID, 1, edge_length);
+        append_Edge_alloc(g, edge, alignNodeID, nextNodeID, 1, edge_length);
     }
 }
 
@@ -644,7 +657,7 @@ inline int create_insertion_Edges(Graph* g, long long alignNodeID, uint64_t edge
 
     nodeID  = add_Node_Graph(g, bases[0]);
     ///add the new node to alignNodeID by insertion_edges
-    append_Edge_alloc(&(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, nodeID, 1, edge_length);
+    append_Edge_alloc(g, &(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, nodeID, 1, edge_length);
 
     alignNodeID = nodeID;
 
@@ -652,11 +665,11 @@ inline int create_insertion_Edges(Graph* g, long long alignNodeID, uint64_t edge
     {
         nodeID  = add_Node_Graph(g, bases[i]);
         ///add the new node to alignNodeID by insertion_edges
-        append_Edge_alloc(&(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, nodeID, 1, edge_length - i);
+        append_Edge_alloc(g, &(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, nodeID, 1, edge_length - i);
         alignNodeID = nodeID;        
     }
 
-    append_Edge_alloc(&(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, backboneID, 1, 0);
+    append_Edge_alloc(g, &(g->g_nodes.list[alignNodeID].insertion_edges), alignNodeID, backboneID, 1, 0);
 
     return 1;
 }
@@ -743,11 +756,11 @@ inline void add_insertionEdge_weight(Graph* g, long long alignNodeID, char* inse
         else ///there is no such edge
         {
             nodeID  = add_Node_Graph(g, insert[0]);
-            append_Edge_alloc(edge, alignNodeID, nodeID, 1, 1);
+            append_Edge_alloc(g, edge, alignNodeID, nodeID, 1, 1);
             ///add the new node to alignNodeID by insertion_edges
             //should link to the initial node, instead of the next node of the initial node
             ///append_Edge_alloc(&(g->g_nodes.list[nodeID].insertion_edges), nodeID, alignNodeID + 1, 1, 0);
-            append_Edge_alloc(&(g->g_nodes.list[nodeID].insertion_edges), nodeID, alignNodeID, 1, 0);
+            append_Edge_alloc(g, &(g->g_nodes.list[nodeID].insertion_edges), nodeID, alignNodeID, 1, 0);
         }
     }
     else
@@ -2,6 +2,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tmmintrin.h>
 #include "Process_Read.h"
 
 uint8_t seq_nt6_table[256] = {
@@ -42,139 +46,84 @@ void destory_All_reads(All_reads* r)
 {
 	uint64_t i = 0;
 	for (i = 0; i < r->total_reads; i++) {
-		if (r->N_site[i]) free(r->N_site[i]);
-		if (r->read_sperate[i]) free(r->read_sperate[i]);
-		if (r->paf && r->paf[i].buffer) free(r->paf[i].buffer);
-		if (r->reverse_paf && r->reverse_paf[i].buffer) free(r->reverse_paf[i].buffer);
+		if (r->N_site[i] && !ha_rs_in_blk(r, r->N_site[i])) free(r->N_site[i]);
+		if (r->read_sperate[i] && !ha_rs_in_blk(r, r->read_sperate[i])) free(r->read_sperate[i]);
+		if (r->paf) destory_ma_hit_t_alloc(&r->paf[i]);
+		if (r->reverse_paf) destory_ma_hit_t_alloc(&r->reverse_paf[i]);
 	}
 	free(r->paf);
 	free(r->reverse_paf);
 	free(r->N_site);
 	free(r->read_sperate);
-	free(r->name);
+	if (!ha_rs_in_blk(r, r->name)) free(r->name);
 	free(r->name_index);
 	free(r->read_length);
+	free(r->read_size);
 	free(r->trio_flag);
+	if (r->blk_mmap) munmap(r->blk, r->blk_len);
+	else free(r->blk);
 }
 
-void write_All_reads(All_reads* r, char* read_file_name)
+/*
+ * All reads are stored as one record so that it can be memory-mapped:
+ *
+ *   uint64_t  adapterLen, n_reads, total_reads_bases, total_name_length, n_N, n_seq_bytes
+ *   uint64_t  read_length[n_reads]
+ *   uint64_t  name_index[n_reads+1]
+ *   uint64_t  N_off[n_reads+1]       // N_site[i] is N[N_off[i]], if N_off[i] < N_off[i+1]
+ *   uint64_t  N[n_N]                 // for each read with Ns: #Ns, then their positions
+ *   uint8_t   trio_flag[n_reads]
+ *   uint8_t   seq[n_seq_bytes]       // read i takes read_length[i]/4+1 bytes
+ *   char      name[total_name_length]
+ */
+#define HA_RS_HDR 6
+
+void write_All_reads_fp(All_reads* r, FILE* fp)
 {
-    fprintf(stderr, "Writing reads to disk... \n");
-    char* index_name = (char*)malloc(strlen(read_file_name)+15);
-    sprintf(index_name, "%s.bin", read_file_name);
-    FILE* fp = fopen(index_name, "w");
-	fwrite(&asm_opt.adapterLen, sizeof(asm_opt.adapterLen), 1, fp);
-    fwrite(&r->index_size, sizeof(r->index_size), 1, fp);
-	fwrite(&r->name_index_size, sizeof(r->name_index_size), 1, fp);
-	fwrite(&r->total_reads, sizeof(r->total_reads), 1, fp);
-	fwrite(&r->total_reads_bases, sizeof(r->total_reads_bases), 1, fp);
-	fwrite(&r->total_name_length, sizeof(r->total_name_length), 1, fp);
-
-	uint64_t i = 0;
-	uint64_t zero = 0;
-	for (i = 0; i < r->total_reads; i++)
-	{
-		if (r->N_site[i] != NULL)
-		{
-			///number of Ns
-			fwrite(&r->N_site[i][0], sizeof(r->N_site[i][0]), 1, fp);
-			if (r->N_site[i][0])
-			{
-				fwrite(r->N_site[i]+1, sizeof(r->N_site[i][0]), r->N_site[i][0], fp);
-			}
-		}
-		else
-		{
-			fwrite(&zero, sizeof(zero), 1, fp);
-		}
+	uint64_t i, h[HA_RS_HDR], off = 0;
+	h[0] = asm_opt.adapterLen, h[1] = r->total_reads, h[2] = r->total_reads_bases, h[3] = r->total_name_length;
+	for (i = 0, h[4] = h[5] = 0; i < r->total_reads; i++) {
+		if (r->N_site[i] && r->N_site[i][0]) h[4] += r->N_site[i][0] + 1;
+		h[5] += r->read_length[i] / 4 + 1;
 	}
-
+	fwrite(h, sizeof(uint64_t), HA_RS_HDR, fp);
 	fwrite(r->read_length, sizeof(uint64_t), r->total_reads, fp);
+	fwrite(r->name_index, sizeof(uint64_t), r->total_reads + 1, fp);
+	for (i = 0; i < r->total_reads; i++) {
+		fwrite(&off, sizeof(uint64_t), 1, fp);
+		if (r->N_site[i] && r->N_site[i][0]) off += r->N_site[i][0] + 1;
+	}
+	fwrite(&off, sizeof(uint64_t), 1, fp);
+	for (i = 0; i < r->total_reads; i++)
+		if (r->N_site[i] && r->N_site[i][0])
+			fwrite(r->N_site[i], sizeof(uint64_t), r->N_site[i][0] + 1, fp);
+	fwrite(r->trio_flag, sizeof(uint8_t), r->total_reads, fp);
 	for (i = 0; i < r->total_reads; i++)
-	{
 		fwrite(r->read_sperate[i], sizeof(uint8_t), r->read_length[i]/4+1, fp);
-	}
-	
 	fwrite(r->name, sizeof(char), r->total_name_length, fp);
-	fwrite(r->name_index, sizeof(uint64_t), r->name_index_size, fp);
-	fwrite(r->trio_flag, sizeof(uint8_t), r->total_reads, fp);
+}
+
+void write_All_reads(All_reads* r, char* read_file_name)
+{
+    fprintf(stderr, "Writing reads to disk... \n");
+    char* index_name = (char*)malloc(strlen(read_file_name)+15);
+    sprintf(index_name, "%s.bin", read_file_name);
+    FILE* fp = fopen(index_name, "w");
+	write_All_reads_fp(r, fp);
     free(index_name);    
 	fflush(fp);
     fclose(fp);
     fprintf(stderr, "Reads has been written.\n");
 }
 
-int load_All_reads(All_reads* r, char* read_file_name)
+static inline uint64_t ha_rs_size(const uint64_t *h)
 {
-    char* index_name = (char*)malloc(strlen(read_file_name)+15);
-    sprintf(index_name, "%s.bin", read_file_name);
-    FILE* fp = fopen(index_name, "r");
-	if (!fp) {
-		free(index_name);
-        return 0;
-    }
-	int local_adapterLen;
-	int f_flag;
-    f_flag = fread(&local_adapterLen, sizeof(local_adapterLen), 1, fp);
-    if(local_adapterLen != asm_opt.adapterLen)
-    {
-        fprintf(stderr, "the adapterLen of index is: %d, but the adapterLen set by user is: %d\n", 
-        local_adapterLen, asm_opt.adapterLen);
-		exit(1);
-    }
-    f_flag += fread(&r->index_size, sizeof(r->index_size), 1, fp);
-	f_flag += fread(&r->name_index_size, sizeof(r->name_index_size), 1, fp);
-	f_flag += fread(&r->total_reads, sizeof(r->total_reads), 1, fp);
-	f_flag += fread(&r->total_reads_bases, sizeof(r->total_reads_bases), 1, fp);
-	f_flag += fread(&r->total_name_length, sizeof(r->total_name_length), 1, fp);
-
-	uint64_t i = 0;
-	uint64_t zero = 0;
-	r->N_site = (uint64_t**)malloc(sizeof(uint64_t*)*r->total_reads);
-	for (i = 0; i < r->total_reads; i++)
-	{
-		f_flag += fread(&zero, sizeof(zero), 1, fp);
-
-		if (zero)
-		{
-			r->N_site[i] = (uint64_t*)malloc(sizeof(uint64_t)*(zero + 1));
-			r->N_site[i][0] = zero;
-			if (r->N_site[i][0])
-			{
-				f_flag += fread(r->N_site[i]+1, sizeof(r->N_site[i][0]), r->N_site[i][0], fp);
-			}
-		}
-		else
-		{
-			r->N_site[i] = NULL;
-		}
-	}
-
-	r->read_length = (uint64_t*)malloc(sizeof(uint64_t)*r->total_reads);
-	f_flag += fread(r->read_length, sizeof(uint64_t), r->total_reads, fp);
-
-	r->read_size = (uint64_t*)malloc(sizeof(uint64_t)*r->total_reads);
-	memcpy (r->read_size, r->read_length, sizeof(uint64_t)*r->total_reads);
-
-	r->read_sperate = (uint8_t**)malloc(sizeof(uint8_t*)*r->total_reads);
-	for (i = 0; i < r->total_reads; i++)
-    {
-		r->read_sperate[i] = (uint8_t*)malloc(sizeof(uint8_t)*(r->read_length[i]/4+1));
-		f_flag += fread(r->read_sperate[i], sizeof(uint8_t), r->read_length[i]/4+1, fp);
-	}
-
-
-	r->name = (char*)malloc(sizeof(char)*r->total_name_length);
-	f_flag += fread(r->name, sizeof(char), r->total_name_length, fp);
-
-	r->name_index = (uint64_t*)malloc(sizeof(uint64_t)*r->name_index_size);
-	f_flag += fread(r->name_index, sizeof(uint64_t), r->name_index_size, fp);
-
-	/****************************may have bugs********************************/
-	r->trio_flag = (uint8_t*)malloc(sizeof(uint8_t)*r->total_reads);
-	f_flag += fread(r->trio_flag, sizeof(uint8_t), r->total_reads, fp);
-	/****************************may have bugs********************************/
+	return (HA_RS_HDR + h[1] + (h[1] + 1) * 2 + h[4]) * sizeof(uint64_t) + h[1] + h[5] + h[3];
+}
 
+static void init_cigars(All_reads* r)
+{
+	uint64_t i;
 	r->cigars = (Compressed_Cigar_record*)malloc(sizeof(Compressed_Cigar_record)*r->total_reads);
 	r->second_round_cigar = (Compressed_Cigar_record*)malloc(sizeof(Compressed_Cigar_record)*r->total_reads);
 	for (i = 0; i < r->total_reads; i++)
@@ -187,9 +136,78 @@ int load_All_reads(All_reads* r, char* read_file_name)
 		r->second_round_cigar[i].lost_base_length = r->cigars[i].lost_base_length = 0;
 		r->second_round_cigar[i].lost_base = r->cigars[i].lost_base = NULL;
 	}
+}
+
+// point reads to the record at r->blk; sequences, Ns and names stay there and the rest is copied
+static void ha_rs_attach(All_reads* r)
+{
+	const uint64_t *h = (const uint64_t*)r->blk, *N_off, *N;
+	uint64_t i, n = h[1];
+	uint8_t *p = r->blk + HA_RS_HDR * sizeof(uint64_t), *seq;
 
+	if ((int64_t)h[0] != asm_opt.adapterLen)
+    {
+        fprintf(stderr, "the adapterLen of index is: %d, but the adapterLen set by user is: %d\n", 
+        (int)h[0], asm_opt.adapterLen);
+		exit(1);
+    }
+	r->total_reads = n, r->total_reads_bases = h[2], r->total_name_length = h[3];
+	r->index_size = n, r->name_index_size = n + 1;
+	r->read_length = (uint64_t*)malloc(sizeof(uint64_t)*n);
+	memcpy(r->read_length, p, sizeof(uint64_t)*n), p += sizeof(uint64_t)*n;
+	r->read_size = (uint64_t*)malloc(sizeof(uint64_t)*n);
+	memcpy(r->read_size, r->read_length, sizeof(uint64_t)*n);
+	r->name_index = (uint64_t*)malloc(sizeof(uint64_t)*(n+1));
+	memcpy(r->name_index, p, sizeof(uint64_t)*(n+1)), p += sizeof(uint64_t)*(n+1);
+	N_off = (const uint64_t*)p, p += sizeof(uint64_t)*(n+1);
+	N = (const uint64_t*)p, p += sizeof(uint64_t)*h[4];
+	r->trio_flag = (uint8_t*)malloc(n);
+	memcpy(r->trio_flag, p, n), p += n;
+	seq = p, p += h[5];
+	r->name = (char*)p;
+
+	r->read_sperate = (uint8_t**)malloc(sizeof(uint8_t*)*n);
+	r->N_site = (uint64_t**)malloc(sizeof(uint64_t*)*n);
+	for (i = 0; i < n; i++) {
+		r->read_sperate[i] = seq, seq += r->read_length[i]/4+1;
+		r->N_site[i] = N_off[i] < N_off[i+1]? (uint64_t*)N + N_off[i] : NULL;
+	}
+	init_cigars(r);
+}
+
+void load_All_reads_fp(All_reads* r, FILE* fp)
+{
+	uint64_t h[HA_RS_HDR];
+	int f_flag;
+	f_flag = fread(h, sizeof(uint64_t), HA_RS_HDR, fp);
+	r->blk_len = ha_rs_size(h);
+	r->blk = (uint8_t*)malloc(r->blk_len);
+	r->blk_mmap = 0;
+	memcpy(r->blk, h, sizeof(h));
+	f_flag += fread(r->blk + sizeof(h), 1, r->blk_len - sizeof(h), fp);
+	ha_rs_attach(r);
+}
+
+int load_All_reads(All_reads* r, char* read_file_name)
+{
+	struct stat st;
+	uint64_t h[HA_RS_HDR];
+	void *mm;
+	int fd;
+    char* index_name = (char*)malloc(strlen(read_file_name)+15);
+    sprintf(index_name, "%s.bin", read_file_name);
+	fd = open(index_name, O_RDONLY);
     free(index_name);    
-    fclose(fp);
+	if (fd < 0) return 0;
+	if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(h) || read(fd, h, sizeof(h)) != sizeof(h) || ha_rs_size(h) > (uint64_t)st.st_size
+		|| (mm = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED)
+	{
+		close(fd);
+		return 0;
+	}
+	close(fd);
+	r->blk = (uint8_t*)mm, r->blk_len = st.st_size, r->blk_mmap = 1;
+	ha_rs_attach(r);
     fprintf(stderr, "Reads has been loaded.\n");
 
 	return 1;
@@ -220,24 +238,20 @@ void malloc_All_reads(All_reads* r)
 
 	r->read_sperate = (uint8_t**)malloc(sizeof(uint8_t*)*r->total_reads);
 	long long i = 0;
-	for (i = 0; i < (long long)r->total_reads; i++)
+	for (i = 0, r->blk_len = 0; i < (long long)r->total_reads; i++)
+		r->blk_len += r->read_length[i]/4+1;
+	r->blk = (uint8_t*)malloc(r->blk_len);
+	for (i = 0, r->blk_len = 0; i < (long long)r->total_reads; i++)
 	{
-		r->read_sperate[i] = (uint8_t*)malloc(sizeof(uint8_t)*(r->read_length[i]/4+1));
+		r->read_sperate[i] = r->blk + r->blk_len;
+		r->blk_len += r->read_length[i]/4+1;
 	}
 
-	r->cigars = (Compressed_Cigar_record*)malloc(sizeof(Compressed_Cigar_record)*r->total_reads);
-	r->second_round_cigar = (Compressed_Cigar_record*)malloc(sizeof(Compressed_Cigar_record)*r->total_reads);
+	init_cigars(r);
 	r->paf = (ma_hit_t_alloc*)malloc(sizeof(ma_hit_t_alloc)*r->total_reads);
 	r->reverse_paf = (ma_hit_t_alloc*)malloc(sizeof(ma_hit_t_alloc)*r->total_reads);
 	for (i = 0; i < (long long)r->total_reads; i++)
 	{
-		r->second_round_cigar[i].size = r->cigars[i].size = 0;
-		r->second_round_cigar[i].length = r->cigars[i].length = 0;
-		r->second_round_cigar[i].record = r->cigars[i].record = NULL;
-
-		r->second_round_cigar[i].lost_base_size = r->cigars[i].lost_base_size = 0;
-		r->second_round_cigar[i].lost_base_length = r->cigars[i].lost_base_length = 0;
-		r->second_round_cigar[i].lost_base = r->cigars[i].lost_base = NULL;
 		init_ma_hit_t_alloc(&(r->paf[i]));
 		init_ma_hit_t_alloc(&(r->reverse_paf[i]));
 	}
@@ -298,251 +312,133 @@ void init_UC_Read(UC_Read* r)
 	}
 }
 
-void recover_UC_Read_sub_region_begin_end(char* r, long long start_pos, long long length, uint8_t strand,
-										  All_reads* R_INF, long long ID, int extra_begin, int extra_end)
+/*
+ * 2-bit reads are unpacked 16 bytes (64 bases) at a time: the high and low
+ * nibbles of each byte are looked up with PSHUFB and interleaved back into
+ * base order. $abc gives the symbol of each 2-bit code, so the same code
+ * writes ASCII ("ACGT") or nt4 codes ({0,1,2,3}). With $rev, bytes are read
+ * from src[n-1] down to src[0] and bases are complemented, which yields the
+ * reverse complement. N sites are patched by the callers.
+ */
+static const char ha_abc_ascii[4] = { 'A', 'C', 'G', 'T' };
+static const char ha_abc_nt4[4] = { 0, 1, 2, 3 };
+
+static inline void ha_unpack1(char *dst, uint8_t b, const char *abc, int rev)
 {
-	long long readLen = Get_READ_LENGTH((*R_INF), ID);
-	uint8_t* src = Get_READ((*R_INF), ID);
-
-	long long i;
-	long long copyLen;
-	long long end_pos = start_pos + length - 1;
-
-	if (strand == 0)
-	{
-		i = start_pos;
-		copyLen = 0;
-
-		long long initLen = start_pos % 4;
-
-		if (initLen != 0)
-		{
-			memcpy(r, bit_t_seq_table[src[i>>2]] + initLen, 4 - initLen);
-			copyLen = copyLen + 4 - initLen;
-			i = i + copyLen;
-		}
-		while (copyLen < length)
-		{
-			memcpy(r+copyLen, bit_t_seq_table[src[i>>2]], 4);
-			copyLen = copyLen + 4;
-			i = i + 4;
-		}
+	if (!rev) dst[0] = abc[b>>6], dst[1] = abc[b>>4&3], dst[2] = abc[b>>2&3], dst[3] = abc[b&3];
+	else dst[0] = abc[3-(b&3)], dst[1] = abc[3-(b>>2&3)], dst[2] = abc[3-(b>>4&3)], dst[3] = abc[3-(b>>6)];
+}
 
-		if (R_INF->N_site[ID])
-		{
-			for (i = 1; i <= (long long)R_INF->N_site[ID][0]; i++)
-			{
-				if ((long long)R_INF->N_site[ID][i] >= start_pos && (long long)R_INF->N_site[ID][i] <= end_pos)
-				{
-					r[R_INF->N_site[ID][i] - start_pos] = 'N';
-				}
-				else if((long long)R_INF->N_site[ID][i] > end_pos)
-				{
-					break;
-				}
-			}
-		}
+static void ha_unpack(char *dst, const uint8_t *src, long long n, const char *abc, int rev) // write 4*$n bases
+{
+	long long i = 0;
+#ifdef __SSSE3__
+	char t0[16], t1[16];
+	int j;
+	for (j = 0; j < 16; ++j) { // t0[x]: first base of nibble x; t1[x]: second base
+		t0[j] = rev? abc[3-(j&3)] : abc[j>>2];
+		t1[j] = rev? abc[3-(j>>2)] : abc[j&3];
 	}
-	else
-	{
-		start_pos = readLen - start_pos - 1;
-		end_pos = readLen - end_pos - 1;
-
-		///start_pos > end_pos
-		i = start_pos;
-		copyLen = 0;
-		long long initLen = (start_pos + 1) % 4;
-
-		if (initLen != 0)
-		{
-			memcpy(r, bit_t_seq_table_rc[src[i>>2]] + 4 - initLen, initLen);
-			copyLen = copyLen + initLen;
-			i = i - initLen;
-		}
-
-		while (copyLen < length)
-		{
-			memcpy(r+copyLen, bit_t_seq_table_rc[src[i>>2]], 4);
-			copyLen = copyLen + 4;
-			i = i - 4;
-		}
-
-		if (R_INF->N_site[ID])
-		{
-			long long offset = readLen - start_pos - 1;
-
-			for (i = 1; i <= (long long)R_INF->N_site[ID][0]; i++)
-			{
-				if ((long long)R_INF->N_site[ID][i] >= end_pos && (long long)R_INF->N_site[ID][i] <= start_pos)
-				{
-					r[readLen - R_INF->N_site[ID][i] - 1 - offset] = 'N';
-				}
-				else if((long long)R_INF->N_site[ID][i] > start_pos)
-				{
-					break;
-				}
-			}
-		}
+	__m128i lut0 = _mm_loadu_si128((const __m128i*)t0), lut1 = _mm_loadu_si128((const __m128i*)t1);
+	__m128i m4 = _mm_set1_epi8(0xf), r16 = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	for (; i + 16 <= n; i += 16, dst += 64) {
+		__m128i x, hi, lo, a0, a1, a2, a3, u0, u1, v0, v1;
+		if (!rev) x = _mm_loadu_si128((const __m128i*)(src + i));
+		else x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + n - i - 16)), r16);
+		hi = _mm_and_si128(_mm_srli_epi16(x, 4), m4), lo = _mm_and_si128(x, m4);
+		if (rev) { __m128i t = hi; hi = lo, lo = t; } // the low nibble comes first
+		a0 = _mm_shuffle_epi8(lut0, hi), a1 = _mm_shuffle_epi8(lut1, hi);
+		a2 = _mm_shuffle_epi8(lut0, lo), a3 = _mm_shuffle_epi8(lut1, lo);
+		u0 = _mm_unpacklo_epi8(a0, a1), u1 = _mm_unpackhi_epi8(a0, a1);
+		v0 = _mm_unpacklo_epi8(a2, a3), v1 = _mm_unpackhi_epi8(a2, a3);
+		_mm_storeu_si128((__m128i*)dst,        _mm_unpacklo_epi16(u0, v0));
+		_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi16(u0, v0));
+		_mm_storeu_si128((__m128i*)(dst + 32), _mm_unpacklo_epi16(u1, v1));
+		_mm_storeu_si128((__m128i*)(dst + 48), _mm_unpackhi_epi16(u1, v1));
 	}
+#endif
+	for (; i < n; ++i, dst += 4)
+		ha_unpack1(dst, rev? src[n - i - 1] : src[i], abc, rev);
 }
 
-void recover_UC_Read_sub_region(char* r, long long start_pos, long long length, uint8_t strand, All_reads* R_INF, long long ID)
+// bases [st, st+len) of read $ID on $strand; like the old table-based code, up to 3 bases past $len may be written
+static void ha_unpack_region(char *r, long long st, long long len, uint8_t strand, const All_reads *R_INF, long long ID, const char *abc, char n_sym)
 {
-	long long readLen = Get_READ_LENGTH((*R_INF), ID);
-	uint8_t* src = Get_READ((*R_INF), ID);
-
-	long long i;
-	long long copyLen;
-	long long end_pos = start_pos + length - 1;
-
-	if (strand == 0)
-	{
-		i = start_pos;
-		copyLen = 0;
-
-		long long initLen = start_pos % 4;
-
-		if (initLen != 0)
-		{
-			memcpy(r, bit_t_seq_table[src[i>>2]] + initLen, 4 - initLen);
-			copyLen = copyLen + 4 - initLen;
-			i = i + copyLen;
+	long long rlen = Get_READ_LENGTH((*R_INF), ID), en = st + len - 1, i, l = 0, k;
+	const uint8_t *src = Get_READ((*R_INF), ID);
+	const uint64_t *N = R_INF->N_site[ID];
+	char tmp[4];
+	if (len <= 0) return;
+	if (strand == 0) {
+		if (st & 3) {
+			ha_unpack1(tmp, src[st>>2], abc, 0);
+			l = 4 - (st & 3);
+			memcpy(r, tmp + (st & 3), l);
 		}
-
-		while (copyLen < length)
-		{
-			memcpy(r+copyLen, bit_t_seq_table[src[i>>2]], 4);
-			copyLen = copyLen + 4;
-			i = i + 4;
+		if (l < len) ha_unpack(r + l, src + ((st + l) >> 2), (len - l + 3) >> 2, abc, 0);
+		if (N) {
+			for (k = 1; k <= (long long)N[0] && (long long)N[k] <= en; ++k)
+				if ((long long)N[k] >= st) r[N[k] - st] = n_sym;
 		}
-
-		if (R_INF->N_site[ID])
-		{
-			for (i = 1; i <= (long long)R_INF->N_site[ID][0]; i++)
-			{
-				if ((long long)R_INF->N_site[ID][i] >= start_pos && (long long)R_INF->N_site[ID][i] <= end_pos)
-				{
-					r[R_INF->N_site[ID][i] - start_pos] = 'N';
-				}
-				else if((long long)R_INF->N_site[ID][i] > end_pos)
-				{
-					break;
-				}
-			}
+	} else {
+		long long p = rlen - st - 1; // the last base on the forward strand
+		if ((p + 1) & 3) {
+			ha_unpack1(tmp, src[p>>2], abc, 1);
+			l = (p + 1) & 3;
+			memcpy(r, tmp + 4 - l, l);
 		}
-	}
-	else
-	{
-		start_pos = readLen - start_pos - 1;
-		end_pos = readLen - end_pos - 1;
-
-		///start_pos > end_pos
-		i = start_pos;
-		copyLen = 0;
-		long long initLen = (start_pos + 1) % 4;
-
-		if (initLen != 0)
-		{
-			memcpy(r, bit_t_seq_table_rc[src[i>>2]] + 4 - initLen, initLen);
-			copyLen = copyLen + initLen;
-			i = i - initLen;
-		}
-
-		while (copyLen < length)
-		{
-			memcpy(r+copyLen, bit_t_seq_table_rc[src[i>>2]], 4);
-			copyLen = copyLen + 4;
-			i = i - 4;
+		if (l < len) {
+			long long n = (len - l + 3) >> 2;
+			ha_unpack(r + l, src + ((p - l) >> 2) - n + 1, n, abc, 1);
 		}
-
-		if (R_INF->N_site[ID])
-		{
-			long long offset = readLen - start_pos - 1;
-
-			for (i = 1; i <= (long long)R_INF->N_site[ID][0]; i++)
-			{
-				if ((long long)R_INF->N_site[ID][i] >= end_pos && (long long)R_INF->N_site[ID][i] <= start_pos)
-				{
-					r[readLen - R_INF->N_site[ID][i] - 1 - offset] = 'N';
-				}
-				else if((long long)R_INF->N_site[ID][i] > start_pos)
-				{
-					break;
-				}
-			}
+		if (N) {
+			for (k = 1, i = rlen - en - 1; k <= (long long)N[0] && (long long)N[k] <= p; ++k)
+				if ((long long)N[k] >= i) r[p - N[k]] = n_sym;
 		}
 	}
 }
 
+void recover_UC_Read_sub_region_begin_end(char* r, long long start_pos, long long length, uint8_t strand,
+										  All_reads* R_INF, long long ID, int extra_begin, int extra_end)
+{
+	ha_unpack_region(r, start_pos, length, strand, R_INF, ID, ha_abc_ascii, 'N');
+}
+
+void recover_UC_Read_sub_region(char* r, long long start_pos, long long length, uint8_t strand, All_reads* R_INF, long long ID)
+{
+	ha_unpack_region(r, start_pos, length, strand, R_INF, ID, ha_abc_ascii, 'N');
+}
 
 void recover_UC_Read(UC_Read* r, const All_reads *R_INF, uint64_t ID)
 {
+	uint64_t i;
 	r->length = Get_READ_LENGTH((*R_INF), ID);
-	uint8_t* src = Get_READ((*R_INF), ID);
-
 	if (r->length + 4 > r->size)
 	{
 		r->size = r->length + 4;
 		r->seq = (char*)realloc(r->seq,sizeof(char)*(r->size));
 	}
-
-	uint64_t i = 0;
-
-	while ((long long)i < r->length)
-	{
-		memcpy(r->seq+i, bit_t_seq_table[src[i>>2]], 4);
-		i = i + 4;
-	}
-
-
+	ha_unpack(r->seq, Get_READ((*R_INF), ID), (r->length + 3) >> 2, ha_abc_ascii, 0);
 	if (R_INF->N_site[ID])
-	{
 		for (i = 1; i <= R_INF->N_site[ID][0]; i++)
-		{
 			r->seq[R_INF->N_site[ID][i]] = 'N';
-		}
-	}
-
 	r->RID = ID;
-		
 }
 
 void recover_UC_Read_RC(UC_Read* r, All_reads* R_INF, uint64_t ID)
 {
 	r->length = Get_READ_LENGTH((*R_INF), ID);
-	uint8_t* src = Get_READ((*R_INF), ID);
-
 	if (r->length + 4 > r->size)
 	{
 		r->size = r->length + 4;
 		r->seq = (char*)realloc(r->seq,sizeof(char)*(r->size));
 	}
+	ha_unpack_region(r->seq, 0, r->length, 1, R_INF, ID, ha_abc_ascii, 'N');
+}
 
-	long long last_chr = r->length % 4;
-	long long i = r->length / 4 - 1 + (last_chr != 0);
-	long long index = 0;
-
-	if(last_chr!=0)
-	{
-		memcpy(r->seq + index, bit_t_seq_table_rc[src[i]] + 4 - last_chr, last_chr);
-		index = last_chr;
-		i--;
-	}
-
-	while (i >= 0)
-	{
-		memcpy(r->seq + index, bit_t_seq_table_rc[src[i]], 4);
-		i--;
-		index = index + 4;
-	}
-
-	if (R_INF->N_site[ID])
-	{
-		for (i = 1; i <= (long long)R_INF->N_site[ID][0]; i++)
-		{
-			r->seq[r->length - R_INF->N_site[ID][i] - 1] = 'N';
-		}
-	}
+void recover_UC_Read_nt4(uint8_t *r, const All_reads *R_INF, uint64_t ID)
+{
+	ha_unpack_region((char*)r, 0, Get_READ_LENGTH((*R_INF), ID), 0, R_INF, ID, ha_abc_nt4, 4);
 }
 
 #define COMPRESS_BASE {c = seq_nt6_table[(uint8_t)src[i]];\
@@ -2,6 +2,7 @@
 #define __READ__
 
 #include<stdint.h>
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <zlib.h>
@@ -128,8 +129,19 @@ typedef struct
 
     ma_hit_t_alloc* paf;
     ma_hit_t_alloc* reverse_paf;
+
+	///one block holding all packed reads, or the memory-mapped <prefix>.ec.bin;
+	///a read grown by error correction moves to its own allocation
+	uint8_t* blk;
+	uint64_t blk_len;
+	int blk_mmap;
 } All_reads;
 
+static inline int ha_rs_in_blk(const All_reads* r, const void* p)
+{
+	return (const uint8_t*)p >= r->blk && (const uint8_t*)p < r->blk + r->blk_len;
+}
+
 extern All_reads R_INF;
 
 typedef struct
@@ -148,10 +160,13 @@ void init_UC_Read(UC_Read* r);
 void recover_UC_Read(UC_Read* r, const All_reads *R_INF, uint64_t ID);
 void recover_UC_Read_RC(UC_Read* r, All_reads* R_INF, uint64_t ID);
 void recover_UC_Read_sub_region(char* r, long long start_pos, long long length, uint8_t strand, All_reads* R_INF, long long ID);
+void recover_UC_Read_nt4(uint8_t *r, const All_reads *R_INF, uint64_t ID); // 0-3 for ACGT and 4 for N; up to 3 bytes past the end may be written
 void destory_UC_Read(UC_Read* r);
 void reverse_complement(char* pattern, uint64_t length);
 void write_All_reads(All_reads* r, char* read_file_name);
 int load_All_reads(All_reads* r, char* read_file_name);
+void write_All_reads_fp(All_reads* r, FILE* fp);
+void load_All_reads_fp(All_reads* r, FILE* fp);
 void destory_All_reads(All_reads* r);
 
 #endif
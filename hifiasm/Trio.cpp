@@ -4,7 +4,12 @@
 #include <string.h>
 #include <assert.h>
 #include <zlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "khashl.h" // hash table
+#include "ksort.h"
 #include "kthread.h"
 #include "kseq.h"
 #include "Process_Read.h"
@@ -24,6 +29,7 @@
 
 #define yak_ch_eq(a, b) ((a)>>YAK_COUNTER_BITS == (b)>>YAK_COUNTER_BITS) // lower 8 bits for counts; higher bits for k-mer
 #define yak_ch_hash(a) ((a)>>YAK_COUNTER_BITS)
+#define tb_key(x) (x)
 KHASHL_SET_INIT(static klib_unused, yak_ht_t, yak_ht, uint64_t, yak_ch_hash, yak_ch_eq)
 
 typedef const char *ha_cstr_t;
@@ -142,17 +148,177 @@ static void yak_ch_destroy(yak_ch_t *h)
 	free(h->h); free(h);
 }
 
+/*
+ * Compact trio table, written by --trio-dump and memory-mapped by --trio-idx.
+ * It keeps the k-mers that pass -c/-d in either parent, with the 4-bit flag
+ * built by yak_ch_restore_core(). K-mer hashes are uniform, so they are
+ * bucketed by their top $bits bits into buckets of 4-8 k-mers on average:
+ *
+ *   char      magic[4]                 // TB_MAGIC
+ *   int32_t   k, bits, min_cnt, mid_cnt, pad
+ *   uint64_t  n                        // number of k-mers
+ *   uint64_t  off[(1<<bits) + 1]       // bucket i is a[off[i]] to a[off[i+1]-1]
+ *   uint64_t  a[n]                     // low bits of the hash << 4 | flag; sorted in each bucket
+ */
+
+#define TB_MAGIC "HTB\1"
+#define TB_HDR   32
+#define TB_BATCH 32 // k-mers looked up together
+
+KRADIX_SORT_INIT(tb64, uint64_t, tb_key, 8)
+
+typedef struct {
+	int k, bits, shift, min_cnt, mid_cnt;
+	uint64_t n, mask;
+	const uint64_t *off, *a;
+	void *mm;
+	size_t mm_len;
+} tb_tab_t;
+
+static int tb_key_bits(int k)
+{
+	return k < 32? 2 * k : 64;
+}
+
+static int ha_triobin_dump1(const yak_ch_t *ch, int min_cnt, int mid_cnt, const char *fn)
+{
+	int32_t hdr[5];
+	uint64_t i, n = 0, *off, *a, *c;
+	int bits, shift, w = tb_key_bits(ch->k);
+	FILE *fp;
+
+	for (i = 0; i < 1ULL<<ch->pre; ++i) n += kh_size(ch->h[i].h);
+	for (bits = 4; bits < w && (1ULL<<bits) * 8 < n; ++bits);
+	shift = w - bits;
+	CALLOC(off, (1ULL<<bits) + 1);
+	CALLOC(c, 1ULL<<bits);
+	MALLOC(a, n);
+	for (i = 0; i < 1ULL<<ch->pre; ++i) { // count k-mers per bucket
+		const yak_ht_t *h = ch->h[i].h;
+		khint_t k;
+		for (k = 0; k < kh_end(h); ++k)
+			if (kh_exist(h, k))
+				++off[((kh_key(h, k) >> YAK_COUNTER_BITS << ch->pre | i) >> shift) + 1];
+	}
+	for (i = 1; i <= 1ULL<<bits; ++i) off[i] += off[i-1];
+	for (i = 0; i < 1ULL<<ch->pre; ++i) { // fill
+		const yak_ht_t *h = ch->h[i].h;
+		khint_t k;
+		for (k = 0; k < kh_end(h); ++k) {
+			uint64_t y, b;
+			if (!kh_exist(h, k)) continue;
+			y = kh_key(h, k) >> YAK_COUNTER_BITS << ch->pre | i;
+			b = y >> shift;
+			a[off[b] + c[b]++] = (y & ((1ULL<<shift) - 1)) << 4 | (kh_key(h, k) & 0xf);
+		}
+	}
+	for (i = 0; i < 1ULL<<bits; ++i)
+		radix_sort_tb64(a + off[i], a + off[i+1]);
+	free(c);
+
+	if ((fp = fopen(fn, "wb")) == 0) {
+		fprintf(stderr, "ERROR: failed to open file '%s' for writing\n", fn);
+		free(off); free(a);
+		return -1;
+	}
+	hdr[0] = ch->k, hdr[1] = bits, hdr[2] = min_cnt, hdr[3] = mid_cnt, hdr[4] = 0;
+	fwrite(TB_MAGIC, 1, 4, fp);
+	fwrite(hdr, 4, 5, fp);
+	fwrite(&n, 8, 1, fp);
+	fwrite(off, 8, (1ULL<<bits) + 1, fp);
+	fwrite(a, 8, n, fp);
+	free(off); free(a);
+	if (fclose(fp) != 0) {
+		fprintf(stderr, "ERROR: failed to write file '%s'\n", fn);
+		return -1;
+	}
+	fprintf(stderr, "[M::%s::%.3f*%.2f] wrote %ld k-mers in %ld buckets to '%s'\n", __func__,
+			yak_realtime(), yak_cpu_usage(), (long)n, (long)(1ULL<<bits), fn);
+	return 0;
+}
+
+static tb_tab_t *tb_tab_load(const char *fn)
+{
+	struct stat st;
+	char magic[4];
+	int32_t hdr[5];
+	uint64_t n;
+	tb_tab_t *t;
+	void *mm;
+	int fd;
+
+	if ((fd = open(fn, O_RDONLY)) < 0) {
+		fprintf(stderr, "ERROR: failed to open file '%s'\n", fn);
+		return 0;
+	}
+	if (fstat(fd, &st) != 0 || st.st_size < TB_HDR || read(fd, magic, 4) != 4 || strncmp(magic, TB_MAGIC, 4) != 0
+		|| read(fd, hdr, 20) != 20 || read(fd, &n, 8) != 8 || hdr[1] < 4 || hdr[1] > tb_key_bits(hdr[0])
+		|| (uint64_t)st.st_size != TB_HDR + ((1ULL<<hdr[1]) + 1 + n) * 8
+		|| (mm = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED)
+	{
+		fprintf(stderr, "ERROR: '%s' is not a trio table generated by --trio-dump\n", fn);
+		close(fd);
+		return 0;
+	}
+	close(fd);
+	CALLOC(t, 1);
+	t->k = hdr[0], t->bits = hdr[1], t->min_cnt = hdr[2], t->mid_cnt = hdr[3], t->n = n;
+	t->shift = tb_key_bits(t->k) - t->bits;
+	t->mask = (1ULL<<t->shift) - 1;
+	t->mm = mm, t->mm_len = st.st_size;
+	t->off = (const uint64_t*)((const uint8_t*)mm + TB_HDR);
+	t->a = t->off + (1ULL<<t->bits) + 1;
+	return t;
+}
+
+static void tb_tab_destroy(tb_tab_t *t)
+{
+	if (t == 0) return;
+	munmap(t->mm, t->mm_len);
+	free(t);
+}
+
+static inline int tb_tab_get(const tb_tab_t *t, uint64_t st, uint64_t en, uint64_t y)
+{
+	uint64_t r = (y & t->mask) << 4;
+	for (; st < en; ++st)
+		if (t->a[st] >= r) return t->a[st] >> 4 == r >> 4? t->a[st] & 0xf : -1;
+	return -1;
+}
+
+// flags of $n k-mer hashes; the bucket offsets and then the buckets are prefetched before probing
+static void tb_tab_get_batch(const tb_tab_t *t, int n, const uint64_t *y, int *flag)
+{
+	int i, j, m;
+	uint64_t st[TB_BATCH], en[TB_BATCH];
+	for (i = 0; i < n; i += TB_BATCH) {
+		m = n - i < TB_BATCH? n - i : TB_BATCH;
+		for (j = 0; j < m; ++j)
+			__builtin_prefetch(&t->off[y[i+j] >> t->shift]);
+		for (j = 0; j < m; ++j) {
+			uint64_t b = y[i+j] >> t->shift;
+			st[j] = t->off[b], en[j] = t->off[b+1];
+			__builtin_prefetch(&t->a[st[j]]);
+		}
+		for (j = 0; j < m; ++j)
+			flag[i+j] = tb_tab_get(t, st[j], en[j], y[i+j]);
+	}
+}
+
 typedef struct {
 	int max;
 	uint32_t *s;
+	uint8_t *seq; // read in 0-4 codes
+	uint64_t *y;  // hashes of k-mers ending at pos[]
+	int *pos, *flag;
 } tb_buf_t;
 
 typedef struct {
 	int k, n_threads, print_diff;
 	double ratio_thres;
 	const yak_ch_t *ch;
+	const tb_tab_t *tt; // if set, used instead of $ch
 	tb_buf_t *buf;
-	UC_Read *bseq;
 	All_reads* seq; 
 } tb_shared_t;
 
@@ -190,29 +356,32 @@ static char tb_classify(const int sc[2], const int *c, int k, double ratio_thres
 static void tb_worker(void *_data, long k, int tid)
 {
 	tb_shared_t *aux = (tb_shared_t*)_data;
-	UC_Read *s = &aux->bseq[tid]; 
-	recover_UC_Read(s, aux->seq, k);
 	tb_buf_t *b = &aux->buf[tid];
 	tb_cnt_t cnt; memset(&cnt, 0, sizeof(tb_cnt_t));
 	uint64_t x[4], mask;
-	int i, l, shift;
-	if (aux->ch->k < 32) {
-		mask = (1ULL<<2*aux->ch->k) - 1;
-		shift = 2 * (aux->ch->k - 1);
+	int i, j, l, n, shift, len = Get_READ_LENGTH(*aux->seq, k);
+	if (aux->k < 32) {
+		mask = (1ULL<<2*aux->k) - 1;
+		shift = 2 * (aux->k - 1);
 	} else {
-		mask = (1ULL<<aux->ch->k) - 1;
-		shift = aux->ch->k - 1;
+		mask = (1ULL<<aux->k) - 1;
+		shift = aux->k - 1;
 	}
-	if (s->length > b->max) {
-		b->max = s->length;
+	if (len + 4 > b->max) {
+		b->max = len + 4;
 		kroundup32(b->max);
-		b->s = (uint32_t*)realloc(b->s, b->max * sizeof(uint32_t));
+		REALLOC(b->s, b->max);
+		REALLOC(b->seq, b->max);
+		REALLOC(b->y, b->max);
+		REALLOC(b->pos, b->max);
+		REALLOC(b->flag, b->max);
 	}
-	memset(b->s, 0, s->length * sizeof(uint32_t));
-	for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < s->length; ++i) {
-		int flag, c = seq_nt4_table[(uint8_t)s->seq[i]];
+	recover_UC_Read_nt4(b->seq, aux->seq, k);
+	memset(b->s, 0, len * sizeof(uint32_t));
+	for (i = l = n = 0, x[0] = x[1] = x[2] = x[3] = 0; i < len; ++i) { // collect k-mers first so that lookups can be batched
+		int c = b->seq[i];
 		if (c < 4) {
-			if (aux->ch->k < 32) {
+			if (aux->k < 32) {
 				x[0] = (x[0] << 2 | c) & mask;
 				x[1] = x[1] >> 2 | (uint64_t)(3 - c) << shift;
 			} else {
@@ -222,25 +391,23 @@ static void tb_worker(void *_data, long k, int tid)
 				x[3] = x[3] >> 1 | (uint64_t)(1 - (c>>1)) << shift;
 			}
 			if (++l >= aux->k) {
-				int type = 0, c1, c2;
-				uint64_t y;
-				++cnt.nk;
-				if (aux->ch->k < 32)
-					y = yak_hash64(x[0] < x[1]? x[0] : x[1], mask);
-				else
-					y = yak_hash_long(x);
-				flag = yak_ch_get(aux->ch, y);
-				if (flag < 0) flag = 0;
-				c1 = flag&3, c2 = flag>>2&3;
-				if (c1 == 2 && c2 == 0) type = 1;
-				else if (c2 == 2 && c1 == 0) type = 2;
-				b->s[i] = type;
-				++cnt.c[flag];
+				b->y[n] = aux->k < 32? yak_hash64(x[0] < x[1]? x[0] : x[1], mask) : yak_hash_long(x);
+				b->pos[n++] = i;
 			}
 		} else l = 0, x[0] = x[1] = x[2] = x[3] = 0;
 	}
-	for (l = 0, i = 1; i <= s->length; ++i) {
-		if (i == s->length || b->s[i] != b->s[l]) {
+	if (aux->tt) tb_tab_get_batch(aux->tt, n, b->y, b->flag);
+	else for (j = 0; j < n; ++j) b->flag[j] = yak_ch_get(aux->ch, b->y[j]);
+	for (j = 0; j < n; ++j) {
+		int type = 0, flag = b->flag[j] < 0? 0 : b->flag[j], c1 = flag&3, c2 = flag>>2&3;
+		if (c1 == 2 && c2 == 0) type = 1;
+		else if (c2 == 2 && c1 == 0) type = 2;
+		b->s[b->pos[j]] = type;
+		++cnt.c[flag];
+	}
+	cnt.nk = n;
+	for (l = 0, i = 1; i <= len; ++i) {
+		if (i == len || b->s[i] != b->s[l]) {
 			if (b->s[l] > 0 && i - l >= aux->k - 4)
 				cnt.sc[b->s[l] - 1] += i - l;
 			l = i;
@@ -257,37 +424,55 @@ static void tb_worker(void *_data, long k, int tid)
 
 static void ha_triobin_yak(const hifiasm_opt_t *opt)
 {
-    yak_ch_t *ch;
-    int i /**, min_cnt = 2, mid_cnt = 5**/;
-    tb_shared_t aux;
-    memset(&aux, 0, sizeof(tb_shared_t));
+	yak_ch_t *ch = 0;
+	tb_tab_t *tt = 0;
+	int i /**, min_cnt = 2, mid_cnt = 5**/;
+	tb_shared_t aux;
+	memset(&aux, 0, sizeof(tb_shared_t));
 	aux.n_threads = opt->thread_num, aux.print_diff = 0;
 	aux.ratio_thres = 0.33;
 	aux.seq = &R_INF;
 
-    ch = yak_ch_restore_core(0,  opt->fn_bin_yak[0], YAK_LOAD_TRIOBIN1, opt->min_cnt, opt->mid_cnt);
-	ch = yak_ch_restore_core(ch, opt->fn_bin_yak[1], YAK_LOAD_TRIOBIN2, opt->min_cnt, opt->mid_cnt);
-
-    aux.k = ch->k;
-    aux.ch = ch;
+	if (opt->fn_trio_idx) {
+		if ((tt = tb_tab_load(opt->fn_trio_idx)) == 0) exit(1);
+		aux.k = tt->k, aux.tt = tt;
+		fprintf(stderr, "[M::%s::%.3f*%.2f] mapped %ld k-mers from '%s' (-c%d -d%d)\n", __func__,
+				yak_realtime(), yak_cpu_usage(), (long)tt->n, opt->fn_trio_idx, tt->min_cnt, tt->mid_cnt);
+	} else {
+		ch = yak_ch_restore_core(0,  opt->fn_bin_yak[0], YAK_LOAD_TRIOBIN1, opt->min_cnt, opt->mid_cnt);
+		ch = yak_ch_restore_core(ch, opt->fn_bin_yak[1], YAK_LOAD_TRIOBIN2, opt->min_cnt, opt->mid_cnt);
+		aux.k = ch->k, aux.ch = ch;
+	}
 	aux.buf = (tb_buf_t*)calloc(aux.n_threads, sizeof(tb_buf_t));
-	aux.bseq = (UC_Read*)calloc(aux.n_threads, sizeof(UC_Read));
-	for (i = 0; i < aux.n_threads; ++i)
-		init_UC_Read(&aux.bseq[i]);
-	
+
 	kt_for(aux.n_threads, tb_worker, &aux, aux.seq->total_reads);
-	
-    for (i = 0; i < aux.n_threads; ++i) {
-		free(aux.buf[i].s);
-		destory_UC_Read(&aux.bseq[i]);
-	} 
+
+	for (i = 0; i < aux.n_threads; ++i) {
+		free(aux.buf[i].s); free(aux.buf[i].seq); free(aux.buf[i].y);
+		free(aux.buf[i].pos); free(aux.buf[i].flag);
+	}
 	free(aux.buf);
-	free(aux.bseq);
-    yak_ch_destroy(ch);
+	yak_ch_destroy(ch);
+	tb_tab_destroy(tt);
 
 	fprintf(stderr, "[M::%s::%.3f*%.2f] ==> partitioned reads using yak dumps\n", __func__, yak_realtime(), yak_cpu_usage());
 }
 
+int ha_triobin_dump(const hifiasm_opt_t *opt, const char *fn)
+{
+	yak_ch_t *ch;
+	int ret;
+	ch = yak_ch_restore_core(0,  opt->fn_bin_yak[0], YAK_LOAD_TRIOBIN1, opt->min_cnt, opt->mid_cnt);
+	if (ch) ch = yak_ch_restore_core(ch, opt->fn_bin_yak[1], YAK_LOAD_TRIOBIN2, opt->min_cnt, opt->mid_cnt);
+	if (ch == 0) {
+		fprintf(stderr, "ERROR: failed to load the yak dumps\n");
+		return 1;
+	}
+	ret = ha_triobin_dump1(ch, opt->min_cnt, opt->mid_cnt, fn);
+	yak_ch_destroy(ch);
+	return ret == 0? 0 : 1;
+}
+
 static int ha_triobin_set_list(const cstr_ht_t *h, const char *fn, int flag)
 {
 	gzFile fp;
@@ -351,6 +536,6 @@ void ha_triobin(const hifiasm_opt_t *opt)
 	memset(R_INF.trio_flag, AMBIGU, R_INF.total_reads * sizeof(uint8_t));
 	if (opt->fn_bin_list[0] && opt->fn_bin_list[1])
 		ha_triobin_list(opt);
-	if (opt->fn_bin_yak[0] && opt->fn_bin_yak[1])
+	if ((opt->fn_bin_yak[0] && opt->fn_bin_yak[1]) || opt->fn_trio_idx)
 		ha_triobin_yak(opt);
 }
@@ -22,16 +22,12 @@ KSORT_INIT(or_xs, overlap_region, oreg_xs_lt)
 #define oreg_ss_lt(a, b) ((a).shared_seed > (b).shared_seed) // in the decending order
 KSORT_INIT(or_ss, overlap_region, oreg_ss_lt)
 
-typedef struct {
-	int n, good;
-	const ha_idxpos_t *a;
-} seed1_t;
-
 struct ha_abuf_s {
 	uint64_t n_a, m_a;
 	uint32_t old_mz_m;
 	ha_mz1_v mz;
-	seed1_t *seed;
+	const ha_idxpos_t **seed; // positions of each minimizer
+	int *seed_n; // number of positions
 	anchor1_t *a;
 };
 
@@ -42,12 +38,12 @@ ha_abuf_t *ha_abuf_init(void)
 
 void ha_abuf_destroy(ha_abuf_t *ab)
 {
-	free(ab->seed); free(ab->a); free(ab->mz.a); free(ab);
+	free(ab->seed); free(ab->seed_n); free(ab->a); free(ab->mz.a); free(ab);
 }
 
 uint64_t ha_abuf_mem(const ha_abuf_t *ab)
 {
-	return ab->m_a * sizeof(anchor1_t) + ab->mz.m * (sizeof(ha_mz1_t) + sizeof(seed1_t)) + sizeof(ha_abuf_t);
+	return ab->m_a * sizeof(anchor1_t) + ab->mz.m * (sizeof(ha_mz1_t) + sizeof(ha_idxpos_t*) + sizeof(int)) + sizeof(ha_abuf_t);
 }
 
 static int ha_ov_type(const overlap_region *r, uint32_t len)
@@ -57,10 +53,32 @@ static int ha_ov_type(const overlap_region *r, uint32_t len)
 	else return r->x_pos_s == 0? 0 : 1;
 }
 
+static uint64_t ha_abuf_get_seeds(ha_abuf_t *ab) // look up the minimizers in ab->mz; return the number of anchors
+{
+	extern ha_pt_t *ha_idx;
+	if (ab->mz.m > ab->old_mz_m) {
+		ab->old_mz_m = ab->mz.m;
+		REALLOC(ab->seed, ab->old_mz_m);
+		REALLOC(ab->seed_n, ab->old_mz_m);
+	}
+	return ha_pt_get_batch(ha_idx, ab->mz.n, ab->mz.a, ab->seed, ab->seed_n);
+}
+
+uint64_t ha_get_n_anchors(ha_abuf_t *ab, int64_t rid, UC_Read *ucr) // as ha_get_new_candidates() but only count the anchors
+{
+	extern void *ha_flt_tab;
+	ab->mz.n = 0;
+	if (!ha_mzc_get(rid, &ab->mz)) {
+		recover_UC_Read(ucr, &R_INF, rid);
+		ha_sketch(ucr->seq, ucr->length, asm_opt.mz_win, asm_opt.k_mer_length, 0, !(asm_opt.flag & HA_F_NO_HPC), &ab->mz, ha_flt_tab);
+		ha_mzc_put(rid, ab->mz.a, ab->mz.n);
+	}
+	return ha_abuf_get_seeds(ab);
+}
+
 void ha_get_new_candidates(ha_abuf_t *ab, int64_t rid, UC_Read *ucr, overlap_region_alloc *overlap_list, Candidates_list *cl, double bw_thres, int max_n_chain, int keep_whole_chain)
 {
 	extern void *ha_flt_tab;
-	extern ha_pt_t *ha_idx;
 	uint32_t i, rlen;
 	uint64_t k, l;
 	double low_occ = asm_opt.hom_cov * HA_KMER_GOOD_RATIO;
@@ -74,34 +92,26 @@ void ha_get_new_candidates(ha_abuf_t *ab, int64_t rid, UC_Read *ucr, overlap_reg
 	rlen = Get_READ_LENGTH(R_INF, rid); // read length
 
 	// get the list of anchors
-	ha_sketch(ucr->seq, ucr->length, asm_opt.mz_win, asm_opt.k_mer_length, 0, !(asm_opt.flag & HA_F_NO_HPC), &ab->mz, ha_flt_tab);
-	if (ab->mz.m > ab->old_mz_m) {
-		ab->old_mz_m = ab->mz.m;
-		REALLOC(ab->seed, ab->old_mz_m);
-	}
-	for (i = 0, ab->n_a = 0; i < ab->mz.n; ++i) {
-		int n;
-		ab->seed[i].a = ha_pt_get(ha_idx, ab->mz.a[i].x, &n);
-		ab->seed[i].n = n;
-		ab->seed[i].good = (n > low_occ && n < high_occ);
-		ab->n_a += n;
+	if (!ha_mzc_get(rid, &ab->mz)) {
+		ha_sketch(ucr->seq, ucr->length, asm_opt.mz_win, asm_opt.k_mer_length, 0, !(asm_opt.flag & HA_F_NO_HPC), &ab->mz, ha_flt_tab);
+		ha_mzc_put(rid, ab->mz.a, ab->mz.n);
 	}
+	ab->n_a = ha_abuf_get_seeds(ab);
 	if (ab->n_a > ab->m_a) {
 		ab->m_a = ab->n_a;
 		kroundup64(ab->m_a);
 		REALLOC(ab->a, ab->m_a);
 	}
 	for (i = 0, k = 0; i < ab->mz.n; ++i) {
-		int j;
+		int j, n = ab->seed_n[i], good = (n > low_occ && n < high_occ);
 		ha_mz1_t *z = &ab->mz.a[i];
-		seed1_t *s = &ab->seed[i];
-		for (j = 0; j < s->n; ++j) {
-			const ha_idxpos_t *y = &s->a[j];
+		for (j = 0; j < n; ++j) {
+			const ha_idxpos_t *y = &ab->seed[i][j];
 			anchor1_t *an = &ab->a[k++];
 			uint8_t rev = z->rev == y->rev? 0 : 1;
 			an->other_off = y->pos;
 			an->self_off = rev? ucr->length - 1 - (z->pos + 1 - z->span) : z->pos;
-			an->good = s->good;
+			an->good = good;
 			an->srt = (uint64_t)y->rid<<33 | (uint64_t)rev<<32 | an->other_off;
 		}
 	}
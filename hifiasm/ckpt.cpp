@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "htab.h"
+
+/*
+ * A checkpoint is a file written by one of the existing writers followed by
+ * a fixed-size trailer. The readers never look past what they wrote, so the
+ * layout before the trailer is unchanged. The trailer records the format
+ * version, the stage, a fingerprint of the input and of the options the
+ * stage depends on, and the CRC32 of everything before it. A file killed
+ * while being written has no valid trailer and is simply recomputed.
+ */
+
+#define HA_CKPT_MAGIC "HAck"
+#define HA_CKPT_TRAILER 32 // magic[4], version, stage, crc (all uint32_t), fingerprint, length (both uint64_t)
+
+static uint64_t ha_ckpt_fp_stage[HA_CKPT_GRAPH + 1];
+
+static uint32_t ha_crc_str(uint32_t crc, const char *s)
+{
+	return crc32(crc, (const Bytef*)s, strlen(s) + 1);
+}
+
+static uint32_t ha_crc_opt(uint32_t crc, const char *fmt, ...)
+{
+	char buf[1024];
+	va_list ap;
+	va_start(ap, fmt);
+	vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	return ha_crc_str(crc, buf);
+}
+
+void ha_ckpt_init(const hifiasm_opt_t *opt)
+{
+	uint32_t in = crc32(0L, Z_NULL, 0), ec, ov, gr;
+	int i;
+	if (opt->mem_reads) { // reads are in memory; checksum them
+		const ha_mem_reads_t *m = opt->mem_reads;
+		int64_t j;
+		for (j = 0; j < m->n; ++j) {
+			in = ha_crc_str(in, m->name[j]);
+			in = crc32(in, (const Bytef*)m->seq[j], m->len[j]);
+		}
+	} else {
+		for (i = 0; i < opt->num_reads; ++i) { // name, size and modification time of input files
+			struct stat st;
+			in = ha_crc_str(in, opt->read_file_names[i]);
+			if (stat(opt->read_file_names[i], &st) == 0)
+				in = ha_crc_opt(in, "%lld %lld", (long long)st.st_size, (long long)st.st_mtime);
+		}
+	}
+	ec = ha_crc_opt(in, "ec %d %d %d %d %g %g %d %d %d", opt->k_mer_length, opt->mz_win, opt->bf_shift, opt->adapterLen,
+			opt->high_factor, opt->max_ov_diff_ec, opt->max_n_chain, opt->max_cov, opt->flag & (HA_F_NO_HPC|HA_F_NO_KMER_FLT|HA_F_TARGETED));
+	ov = ha_crc_opt(ec, "ovlp %d %g", opt->number_of_round, opt->max_ov_diff_final);
+	gr = ha_crc_opt(ov, "graph %d %d %d %d %d %d %g %g %g %lld", opt->min_overlap_coverage, opt->min_overlap_Len, opt->max_hang_Len,
+			opt->clean_round, opt->gap_fuzz, opt->max_short_tip, opt->min_drop_rate, opt->max_drop_rate, opt->max_hang_rate,
+			opt->large_pop_bubble_size);
+	for (i = 0; i < 2; ++i) {
+		gr = ha_crc_str(gr, opt->fn_bin_yak[i]? opt->fn_bin_yak[i] : "");
+		gr = ha_crc_str(gr, opt->fn_bin_list[i]? opt->fn_bin_list[i] : "");
+	}
+	gr = ha_crc_opt(gr, "%d %d", opt->min_cnt, opt->mid_cnt);
+	ha_ckpt_fp_stage[HA_CKPT_EC]    = (uint64_t)in << 32 | ec;
+	ha_ckpt_fp_stage[HA_CKPT_OVLP]  = (uint64_t)in << 32 | ov;
+	ha_ckpt_fp_stage[HA_CKPT_GRAPH] = (uint64_t)in << 32 | gr;
+}
+
+static int ha_crc_file(FILE *fp, uint64_t len, uint32_t *crc)
+{
+	uint8_t *buf;
+	uint64_t n = 0;
+	size_t l;
+	*crc = crc32(0L, Z_NULL, 0);
+	MALLOC(buf, 1<<20);
+	while (n < len && (l = fread(buf, 1, len - n < 1<<20? len - n : 1<<20, fp)) > 0)
+		*crc = crc32(*crc, buf, l), n += l;
+	free(buf);
+	return n == len? 0 : -1;
+}
+
+int ha_ckpt_seal(const char *fn, int stage)
+{
+	FILE *fp;
+	struct stat st;
+	uint32_t x[4];
+	uint64_t y[2];
+	int ret = -1;
+	if (stat(fn, &st) != 0 || (fp = fopen(fn, "r+b")) == 0) return -1;
+	memcpy(x, HA_CKPT_MAGIC, 4);
+	x[1] = HA_CKPT_VERSION, x[2] = stage;
+	y[0] = ha_ckpt_fp_stage[stage], y[1] = st.st_size;
+	if (ha_crc_file(fp, y[1], &x[3]) == 0 && fseek(fp, 0, SEEK_END) == 0
+		&& fwrite(x, 4, 4, fp) == 4 && fwrite(y, 8, 2, fp) == 2)
+		ret = 0;
+	if (fclose(fp) != 0) ret = -1;
+	if (ret < 0) fprintf(stderr, "[W::%s] failed to write the checkpoint trailer to '%s'\n", __func__, fn);
+	return ret;
+}
+
+int ha_ckpt_check(const char *fn, int stage)
+{
+	FILE *fp;
+	struct stat st;
+	uint32_t x[4], crc;
+	uint64_t y[2];
+	const char *msg = 0;
+	if (stat(fn, &st) != 0 || (fp = fopen(fn, "rb")) == 0) return 0;
+	if (st.st_size < HA_CKPT_TRAILER || fseek(fp, st.st_size - HA_CKPT_TRAILER, SEEK_SET) != 0
+		|| fread(x, 4, 4, fp) != 4 || fread(y, 8, 2, fp) != 2 || memcmp(x, HA_CKPT_MAGIC, 4) != 0)
+		msg = "not a checkpoint or incomplete";
+	else if (x[1] != HA_CKPT_VERSION)
+		msg = "written by a different version";
+	else if (x[2] != (uint32_t)stage || y[1] != (uint64_t)st.st_size - HA_CKPT_TRAILER)
+		msg = "corrupted";
+	else if (y[0] != ha_ckpt_fp_stage[stage])
+		msg = "made from different reads or options";
+	else if (fseek(fp, 0, SEEK_SET) != 0 || ha_crc_file(fp, y[1], &crc) != 0 || crc != x[3])
+		msg = "checksum mismatch";
+	fclose(fp);
+	if (msg) fprintf(stderr, "[W::%s] ignored '%s': %s\n", __func__, fn, msg);
+	return msg? 0 : 1;
+}
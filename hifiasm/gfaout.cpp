@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <zlib.h>
+#include "htab.h"
+#include "kthread.h"
+
+/*
+ * GFA writer. Callers format lines into memory, possibly from several
+ * threads, and hand them over in file order. The output is plain text or,
+ * with --gfa-gz, BGZF: the text is cut into 0xff00-byte blocks, each deflated
+ * as its own gzip member and compressed in parallel, so the file can be read
+ * by gzip/bgzip and seeked by virtual offset. With --gfa-idx, the offset of
+ * every S-line is written to FILE.gfai as "name<TAB>length<TAB>offset";
+ * for BGZF files the offset is virtual (block_offset<<16 | offset_in_block).
+ */
+
+#define HA_BGZF_BLK   0xff00  // uncompressed bytes per BGZF block
+#define HA_BGZF_MAX   0x10000 // max size of a compressed BGZF block
+#define HA_GFA_FLUSH  (1<<24) // plain text is written in chunks of this size
+
+struct ha_gfa_out_s {
+	FILE *fp;
+	char *fn;
+	int is_gz, is_idx;
+	uint64_t u_off, c_off; // uncompressed and compressed bytes so far
+	ha_gfa_buf_t buf; // pending uncompressed text
+	uint64_t *blk; // compressed offset of each BGZF block
+	size_t n_blk, m_blk;
+	ha_gfa_buf_t name; // segment names, NUL-separated
+	uint64_t *seg; // uncompressed offset and length of each segment, in pairs
+	size_t n_seg, m_seg;
+};
+
+void ha_gfa_puts(ha_gfa_buf_t *b, const char *s, size_t l)
+{
+	if (b->l + l + 1 > b->m) {
+		b->m = b->l + l + 1;
+		kroundup64(b->m);
+		REALLOC(b->s, b->m);
+	}
+	memcpy(b->s + b->l, s, l);
+	b->l += l;
+	b->s[b->l] = 0;
+}
+
+void ha_gfa_printf(ha_gfa_buf_t *b, const char *fmt, ...)
+{
+	va_list ap;
+	int l;
+	va_start(ap, fmt);
+	l = vsnprintf(b->s? b->s + b->l : 0, b->m - b->l, fmt, ap);
+	va_end(ap);
+	if (b->l + l + 1 > b->m) {
+		b->m = b->l + l + 1;
+		kroundup64(b->m);
+		REALLOC(b->s, b->m);
+		va_start(ap, fmt);
+		vsnprintf(b->s + b->l, b->m - b->l, fmt, ap);
+		va_end(ap);
+	}
+	b->l += l;
+}
+
+// skip a variant if any comma-separated token of --skip-gfa equals it or one of its dot-separated parts
+static int ha_gfa_skip(const char *variant)
+{
+	const char *p, *q, *r, *s;
+	if (asm_opt.skip_gfa == 0) return 0;
+	for (p = asm_opt.skip_gfa; *p; p = *q? q + 1 : q) {
+		size_t l;
+		for (q = p; *q && *q != ','; ++q);
+		l = q - p;
+		if (l == 0) continue;
+		if (strlen(variant) == l && strncmp(variant, p, l) == 0) return 1;
+		for (r = variant; *r; r = *s? s + 1 : s) {
+			for (s = r; *s && *s != '.'; ++s);
+			if ((size_t)(s - r) == l && strncmp(r, p, l) == 0) return 1;
+		}
+	}
+	return 0;
+}
+
+ha_gfa_out_t *ha_gfa_open(const char *prefix, const char *variant)
+{
+	ha_gfa_out_t *o;
+	if (ha_gfa_skip(variant)) return 0;
+	CALLOC(o, 1);
+	o->is_gz = !!(asm_opt.flag & HA_F_GFA_GZ);
+	o->is_idx = !!(asm_opt.flag & HA_F_GFA_IDX);
+	MALLOC(o->fn, strlen(prefix) + strlen(variant) + 10);
+	sprintf(o->fn, "%s.%s.gfa%s", prefix, variant, o->is_gz? ".gz" : "");
+	if ((o->fp = fopen(o->fn, "wb")) == 0) {
+		fprintf(stderr, "[E::%s] failed to open '%s' for writing\n", __func__, o->fn);
+		free(o->fn); free(o);
+		return 0;
+	}
+	return o;
+}
+
+static int ha_bgzf_block(uint8_t *dst, const uint8_t *src, int l)
+{
+	static const uint8_t hdr[18] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 0, 0 };
+	int level = Z_DEFAULT_COMPRESSION, ret, n;
+	uint32_t crc;
+	z_stream zs;
+	for (;;) {
+		memset(&zs, 0, sizeof(zs));
+		zs.next_in = (Bytef*)src, zs.avail_in = l;
+		zs.next_out = dst + 18, zs.avail_out = HA_BGZF_MAX - 18 - 8;
+		deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+		ret = deflate(&zs, Z_FINISH);
+		n = zs.total_out;
+		deflateEnd(&zs);
+		if (ret == Z_STREAM_END || level == 0) break;
+		level = 0; // incompressible: store the block
+	}
+	memcpy(dst, hdr, 18);
+	n += 18 + 8;
+	dst[16] = (n - 1) & 0xff, dst[17] = (n - 1) >> 8;
+	crc = crc32(crc32(0L, Z_NULL, 0), src, l);
+	dst[n-8] = crc, dst[n-7] = crc>>8, dst[n-6] = crc>>16, dst[n-5] = crc>>24;
+	dst[n-4] = l, dst[n-3] = l>>8, dst[n-2] = l>>16, dst[n-1] = l>>24;
+	return n;
+}
+
+typedef struct {
+	const uint8_t *src;
+	uint8_t *dst;
+	int n_src; // bytes in the last block
+	long n;
+	int *len;
+} ha_bgzf_aux_t;
+
+static void worker_bgzf(void *data, long i, int tid)
+{
+	ha_bgzf_aux_t *a = (ha_bgzf_aux_t*)data;
+	a->len[i] = ha_bgzf_block(a->dst + i * HA_BGZF_MAX, a->src + i * HA_BGZF_BLK, i == a->n - 1? a->n_src : HA_BGZF_BLK);
+}
+
+static void ha_gfa_flush(ha_gfa_out_t *o, int is_final)
+{
+	ha_bgzf_aux_t a;
+	size_t rest;
+	long i;
+	if (!o->is_gz) {
+		fwrite(o->buf.s, 1, o->buf.l, o->fp);
+		o->buf.l = 0;
+		return;
+	}
+	a.n = o->buf.l / HA_BGZF_BLK, a.n_src = HA_BGZF_BLK;
+	if (is_final && o->buf.l % HA_BGZF_BLK) a.n_src = o->buf.l % HA_BGZF_BLK, ++a.n;
+	if (a.n > 0) {
+		a.src = (const uint8_t*)o->buf.s;
+		MALLOC(a.dst, a.n * HA_BGZF_MAX);
+		MALLOC(a.len, a.n);
+		kt_for(asm_opt.thread_num, worker_bgzf, &a, a.n);
+		for (i = 0; i < a.n; ++i) {
+			if (o->n_blk == o->m_blk) {
+				o->m_blk = o->m_blk? o->m_blk<<1 : 256;
+				REALLOC(o->blk, o->m_blk);
+			}
+			o->blk[o->n_blk++] = o->c_off;
+			fwrite(a.dst + i * HA_BGZF_MAX, 1, a.len[i], o->fp);
+			o->c_off += a.len[i];
+		}
+		free(a.dst); free(a.len);
+	}
+	rest = o->buf.l - (is_final? o->buf.l : (size_t)a.n * HA_BGZF_BLK);
+	if (rest) memmove(o->buf.s, o->buf.s + o->buf.l - rest, rest);
+	o->buf.l = rest;
+}
+
+void ha_gfa_write(ha_gfa_out_t *o, const char *s, size_t l)
+{
+	ha_gfa_puts(&o->buf, s, l);
+	o->u_off += l;
+	if (o->buf.l >= (o->is_gz? (size_t)HA_BGZF_BLK * 16 * asm_opt.thread_num : (size_t)HA_GFA_FLUSH))
+		ha_gfa_flush(o, 0);
+}
+
+void ha_gfa_seg(ha_gfa_out_t *o, const char *name, uint32_t len)
+{
+	if (!o->is_idx) return;
+	if (o->n_seg + 2 > o->m_seg) {
+		o->m_seg = o->m_seg? o->m_seg<<1 : 256;
+		REALLOC(o->seg, o->m_seg);
+	}
+	o->seg[o->n_seg++] = o->u_off;
+	o->seg[o->n_seg++] = len;
+	ha_gfa_puts(&o->name, name, strlen(name) + 1);
+}
+
+void ha_gfa_close(ha_gfa_out_t *o)
+{
+	static const uint8_t eof[28] = { 31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 'B', 'C', 2, 0, 27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	if (o == 0) return;
+	ha_gfa_flush(o, 1);
+	if (o->is_gz) fwrite(eof, 1, 28, o->fp);
+	fclose(o->fp);
+	if (o->is_idx) {
+		char *fn;
+		FILE *fp;
+		MALLOC(fn, strlen(o->fn) + 6);
+		sprintf(fn, "%s.gfai", o->fn);
+		if ((fp = fopen(fn, "w")) != 0) {
+			const char *name = o->name.s;
+			size_t i;
+			for (i = 0; i < o->n_seg; i += 2, name += strlen(name) + 1) {
+				uint64_t off = o->seg[i];
+				if (o->is_gz) off = o->blk[off / HA_BGZF_BLK] << 16 | off % HA_BGZF_BLK;
+				fprintf(fp, "%s\t%u\t%llu\n", name, (uint32_t)o->seg[i+1], (unsigned long long)off);
+			}
+			fclose(fp);
+		} else fprintf(stderr, "[E::%s] failed to open '%s' for writing\n", __func__, fn);
+		free(fn);
+	}
+	free(o->fn); free(o->buf.s); free(o->blk); free(o->name.s); free(o->seg);
+	free(o);
+}
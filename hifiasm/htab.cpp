@@ -14,7 +14,7 @@
 #define YAK_N_COUNTS     (1<<YAK_COUNTER_BITS)
 #define YAK_MAX_COUNT    ((1<<YAK_COUNTER_BITS)-1)
 
-const unsigned char seq_nt4_table[256] = { // translate ACGT to 0123
+const unsigned char ha_seq_nt4_table[256] = { // translate ACGT to 0123
 	0, 1, 2, 3,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
 	4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
 	4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,  4, 4, 4, 4,
@@ -35,6 +35,7 @@ const unsigned char seq_nt4_table[256] = { // translate ACGT to 0123
 
 void *ha_flt_tab;
 ha_pt_t *ha_idx;
+uint64_t *ha_rd_drop;
 
 /***************************
  * Yak specific parameters *
@@ -46,6 +47,7 @@ typedef struct {
 	int32_t pre;
 	int32_t n_thread;
 	int64_t chunk_size;
+	int64_t keep_mem; // keep minimizers from the counting pass if they take less memory than this
 } yak_copt_t;
 
 void yak_copt_init(yak_copt_t *o)
@@ -124,10 +126,18 @@ typedef struct {
 	yak_bf_t *b;
 } ha_ct1_t;
 
+typedef struct { // minimizers of a chunk of reads, grouped by bucket
+	uint64_t *off; // bucket i is a[off[i]] to a[off[i+1]]
+	ha_mz1_t *a;
+} ha_mzblk_t;
+
 typedef struct {
 	int k, pre, n_hash, n_shift;
 	uint64_t tot;
 	ha_ct1_t *h;
+	int n_blk, m_blk, keep_fail; // minimizers kept for building the position table
+	int64_t blk_mem;
+	ha_mzblk_t *blk;
 } ha_ct_t;
 
 static ha_ct_t *ha_ct_init(int k, int pre, int n_hash, int n_shift)
@@ -158,16 +168,65 @@ static void ha_ct_destroy_bf(ha_ct_t *h)
 	}
 }
 
+static void ha_ct_drop_blk(ha_ct_t *h)
+{
+	int i;
+	for (i = 0; i < h->n_blk; ++i) {
+		free(h->blk[i].off); free(h->blk[i].a);
+	}
+	free(h->blk);
+	h->blk = 0, h->n_blk = h->m_blk = 0, h->blk_mem = 0;
+}
+
+static void ha_ct_keep(ha_ct_t *h, uint64_t *off, ha_mz1_t *a, int64_t max_mem) // take the ownership of $off and $a
+{
+	int64_t mem = off[1<<h->pre] * sizeof(ha_mz1_t) + ((1<<h->pre) + 1) * sizeof(uint64_t);
+	if (h->keep_fail || h->blk_mem + mem > max_mem) { // too large; the reads will be sketched again
+		h->keep_fail = 1;
+		ha_ct_drop_blk(h);
+		free(off); free(a);
+		return;
+	}
+	if (h->n_blk == h->m_blk) {
+		h->m_blk = h->m_blk? h->m_blk<<1 : 16;
+		REALLOC(h->blk, h->m_blk);
+	}
+	h->blk[h->n_blk].off = off, h->blk[h->n_blk++].a = a;
+	h->blk_mem += mem;
+}
+
 static void ha_ct_destroy(ha_ct_t *h)
 {
 	int i;
 	if (h == 0) return;
 	ha_ct_destroy_bf(h);
+	ha_ct_drop_blk(h);
 	for (i = 0; i < 1<<h->pre; ++i)
 		yak_ct_destroy(h->h[i].h);
 	free(h->h); free(h);
 }
 
+static inline int ha_ct_insert1(const ha_ct_t *h, ha_ct1_t *g, int create_new, uint64_t x) // return 1 if $x is new
+{
+	int ins = 1, absent, n_ins = 0;
+	khint_t k;
+	if (create_new) {
+		if (g->b)
+			ins = (yak_bf_insert(g->b, x) == h->n_hash);
+		if (ins) {
+			k = yak_ct_put(g->h, x << YAK_COUNTER_BITS | (g->b? 1 : 0), &absent);
+			if (absent) ++n_ins;
+			if ((kh_key(g->h, k)&YAK_MAX_COUNT) < YAK_MAX_COUNT)
+				++kh_key(g->h, k);
+		}
+	} else {
+		k = yak_ct_get(g->h, x<<YAK_COUNTER_BITS);
+		if (k != kh_end(g->h) && (kh_key(g->h, k)&YAK_MAX_COUNT) < YAK_MAX_COUNT)
+			++kh_key(g->h, k);
+	}
+	return n_ins;
+}
+
 static int ha_ct_insert_list(ha_ct_t *h, int create_new, int n, const uint64_t *a)
 {
 	int j, mask = (1<<h->pre) - 1, n_ins = 0;
@@ -175,24 +234,21 @@ static int ha_ct_insert_list(ha_ct_t *h, int create_new, int n, const uint64_t *
 	if (n == 0) return 0;
 	g = &h->h[a[0]&mask];
 	for (j = 0; j < n; ++j) {
-		int ins = 1, absent;
-		uint64_t x = a[j] >> h->pre;
-		khint_t k;
 		if ((a[j]&mask) != (a[0]&mask)) continue;
-		if (create_new) {
-			if (g->b)
-				ins = (yak_bf_insert(g->b, x) == h->n_hash);
-			if (ins) {
-				k = yak_ct_put(g->h, x << YAK_COUNTER_BITS | (g->b? 1 : 0), &absent);
-				if (absent) ++n_ins;
-				if ((kh_key(g->h, k)&YAK_MAX_COUNT) < YAK_MAX_COUNT)
-					++kh_key(g->h, k);
-			}
-		} else {
-			k = yak_ct_get(g->h, x<<YAK_COUNTER_BITS);
-			if (k != kh_end(g->h) && (kh_key(g->h, k)&YAK_MAX_COUNT) < YAK_MAX_COUNT)
-				++kh_key(g->h, k);
-		}
+		n_ins += ha_ct_insert1(h, g, create_new, a[j] >> h->pre);
+	}
+	return n_ins;
+}
+
+static int ha_ct_insert_mz(ha_ct_t *h, int create_new, int n, const ha_mz1_t *a)
+{
+	int j, mask = (1<<h->pre) - 1, n_ins = 0;
+	ha_ct1_t *g;
+	if (n == 0) return 0;
+	g = &h->h[a[0].x&mask];
+	for (j = 0; j < n; ++j) {
+		if ((a[j].x&mask) != (a[0].x&mask)) continue;
+		n_ins += ha_ct_insert1(h, g, create_new, a[j].x >> h->pre);
 	}
 	return n_ins;
 }
@@ -358,6 +414,39 @@ int ha_pt_insert_list(ha_pt_t *h, int n, const ha_mz1_t *a)
 	}
 	return n_ins;
 }
+
+typedef struct {
+	ha_pt_t *pt;
+	int n_blk;
+	const ha_mzblk_t *blk;
+	uint64_t *n_ins;
+} pt_fill_aux_t;
+
+static void worker_pt_fill(void *data, long i, int tid) // callback for kt_for(); blocks are in the read order
+{
+	pt_fill_aux_t *a = (pt_fill_aux_t*)data;
+	int j;
+	for (j = 0; j < a->n_blk; ++j) {
+		const ha_mzblk_t *b = &a->blk[j];
+		a->n_ins[i] += ha_pt_insert_list(a->pt, b->off[i+1] - b->off[i], &b->a[b->off[i]]);
+	}
+}
+
+static void ha_pt_fill(ha_pt_t *pt, int n_blk, ha_mzblk_t *blk, int n_thread) // fill the position table with minimizers kept by ha_ct_keep(); free $blk
+{
+	pt_fill_aux_t a;
+	int i;
+	a.pt = pt, a.n_blk = n_blk, a.blk = blk;
+	CALLOC(a.n_ins, 1<<pt->pre);
+	kt_for(n_thread, worker_pt_fill, &a, 1<<pt->pre);
+	for (i = 0; i < 1<<pt->pre; ++i)
+		pt->tot_pos += a.n_ins[i];
+	free(a.n_ins);
+	for (i = 0; i < n_blk; ++i) {
+		free(blk[i].off); free(blk[i].a);
+	}
+	free(blk);
+}
 /*
 static void worker_pt_sort(void *data, long i, int tid)
 {
@@ -401,6 +490,153 @@ const ha_idxpos_t *ha_pt_get(const ha_pt_t *h, uint64_t hash, int *n)
 	return &g->a[kh_val(g->h, k)];
 }
 
+#define HA_PT_BATCH 64
+
+/*
+ * Look up $n minimizers at once: prefetch the hash buckets of a batch, then
+ * resolve the batch, so that the cache misses overlap instead of being taken
+ * one after another. Positions are prefetched only for minimizers in the
+ * table; they are not read here. Return the total number of positions.
+ */
+uint64_t ha_pt_get_batch(const ha_pt_t *h, uint32_t n, const ha_mz1_t *mz, const ha_idxpos_t **a, int *cnt)
+{
+	uint64_t mask = (1ULL<<h->pre) - 1, tot = 0;
+	uint32_t i, j, e;
+	for (i = 0; i < n; i = e) {
+		e = i + HA_PT_BATCH < n? i + HA_PT_BATCH : n;
+		for (j = i; j < e; ++j) {
+			const yak_pt_t *g = h->h[mz[j].x & mask].h;
+			if (g->keys) {
+				khint_t b = __kh_h2b((khint_t)(mz[j].x >> h->pre), g->bits);
+				__builtin_prefetch(&g->used[b>>5]);
+				__builtin_prefetch(&g->keys[b]);
+			}
+		}
+		for (j = i; j < e; ++j) {
+			a[j] = ha_pt_get(h, mz[j].x, &cnt[j]);
+			if (a[j]) __builtin_prefetch(a[j]);
+			tot += cnt[j];
+		}
+	}
+	return tot;
+}
+
+/******************************************
+ * Minimizers of reads across corrections *
+ ******************************************/
+
+/*
+ * Corrected reads are reverse complemented after each round and minimizers
+ * are not strictly strand symmetric, so each read has one slot per
+ * orientation. A read changed by correction is marked dirty and its slots are
+ * dropped on the next access. Lists are kept while they take less than 1/8 of
+ * the physical memory.
+ */
+
+#define HA_MZC_FLIP  0x1 // the read is in the other orientation
+#define HA_MZC_DIRTY 0x2 // the sequence has changed
+
+typedef struct {
+	uint32_t n[2];
+	ha_mz1_t *a[2];
+} ha_mzc1_t;
+
+typedef struct {
+	uint64_t n_read;
+	int64_t mem, max_mem;
+	uint8_t *st;
+	ha_mzc1_t *c;
+} ha_mzc_t;
+
+static ha_mzc_t *ha_mzc;
+
+void ha_mzc_init(uint64_t n_read)
+{
+	if (ha_mzc) return;
+	CALLOC(ha_mzc, 1);
+	ha_mzc->n_read = n_read;
+	ha_mzc->max_mem = yak_physmem() / 8;
+	CALLOC(ha_mzc->st, n_read);
+	CALLOC(ha_mzc->c, n_read);
+}
+
+void ha_mzc_destroy(void)
+{
+	uint64_t i;
+	if (ha_mzc == 0) return;
+	for (i = 0; i < ha_mzc->n_read; ++i) {
+		free(ha_mzc->c[i].a[0]); free(ha_mzc->c[i].a[1]);
+	}
+	free(ha_mzc->st); free(ha_mzc->c); free(ha_mzc);
+	ha_mzc = 0;
+}
+
+static void ha_mzc_drop(uint64_t rid)
+{
+	ha_mzc1_t *c = &ha_mzc->c[rid];
+	int j;
+	for (j = 0; j < 2; ++j) {
+		if (c->a[j] == 0) continue;
+		__sync_fetch_and_add(&ha_mzc->mem, -(int64_t)(c->n[j] * sizeof(ha_mz1_t)));
+		free(c->a[j]);
+		c->a[j] = 0, c->n[j] = 0;
+	}
+}
+
+void ha_mzc_mark(uint64_t rid, int changed, int flipped) // called after correcting read $rid
+{
+	if (ha_mzc == 0 || rid >= ha_mzc->n_read) return;
+	if (changed) ha_mzc->st[rid] |= HA_MZC_DIRTY;
+	if (flipped) ha_mzc->st[rid] ^= HA_MZC_FLIP;
+}
+
+static inline int ha_mzc_has(uint64_t rid)
+{
+	if (ha_mzc == 0 || rid >= ha_mzc->n_read || (ha_mzc->st[rid] & HA_MZC_DIRTY)) return 0;
+	return ha_mzc->c[rid].a[ha_mzc->st[rid] & HA_MZC_FLIP] != 0;
+}
+
+int ha_mzc_get(uint64_t rid, ha_mz1_v *p) // append the cached minimizers of read $rid to $p; return 0 if not cached
+{
+	const ha_mzc1_t *c;
+	uint32_t j, o;
+	if (ha_mzc == 0 || rid >= ha_mzc->n_read) return 0;
+	if (ha_mzc->st[rid] & HA_MZC_DIRTY) {
+		ha_mzc_drop(rid);
+		ha_mzc->st[rid] &= ~HA_MZC_DIRTY;
+		return 0;
+	}
+	o = ha_mzc->st[rid] & HA_MZC_FLIP, c = &ha_mzc->c[rid];
+	if (c->a[o] == 0) return 0;
+	if (p->n + c->n[o] > p->m) {
+		p->m = p->n + c->n[o];
+		p->m += p->m>>1;
+		REALLOC(p->a, p->m);
+	}
+	for (j = 0; j < c->n[o]; ++j) {
+		p->a[p->n] = c->a[o][j];
+		p->a[p->n++].rid = rid;
+	}
+	return 1;
+}
+
+void ha_mzc_put(uint64_t rid, const ha_mz1_t *a, uint32_t n) // cache the minimizers of read $rid in its current orientation
+{
+	ha_mzc1_t *c;
+	int64_t mem = (int64_t)n * sizeof(ha_mz1_t);
+	uint32_t o;
+	if (ha_mzc == 0 || rid >= ha_mzc->n_read || (ha_mzc->st[rid] & HA_MZC_DIRTY)) return;
+	o = ha_mzc->st[rid] & HA_MZC_FLIP, c = &ha_mzc->c[rid];
+	if (c->a[o] || n == 0) return;
+	if (__sync_fetch_and_add(&ha_mzc->mem, mem) + mem > ha_mzc->max_mem) {
+		__sync_fetch_and_add(&ha_mzc->mem, -mem);
+		return;
+	}
+	MALLOC(c->a[o], n);
+	memcpy(c->a[o], a, n * sizeof(ha_mz1_t));
+	c->n[o] = n;
+}
+
 /**********************************
  * Buffer for counting all k-mers *
  **********************************/
@@ -439,7 +675,7 @@ static void count_seq_buf(ch_buf_t *buf, int k, int p, int len, const char *seq)
 	int i, l;
 	uint64_t x[4], mask = (1ULL<<k) - 1, shift = k - 1;
 	for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < len; ++i) {
-		int c = seq_nt4_table[(uint8_t)seq[i]];
+		int c = ha_seq_nt4_table[(uint8_t)seq[i]];
 		if (c < 4) { // not an "N" base
 			x[0] = (x[0] << 1 | (c&1))  & mask;
 			x[1] = (x[1] << 1 | (c>>1)) & mask;
@@ -456,7 +692,7 @@ static void count_seq_buf_HPC(ch_buf_t *buf, int k, int p, int len, const char *
 	int i, l, last = -1;
 	uint64_t x[4], mask = (1ULL<<k) - 1, shift = k - 1;
 	for (i = l = 0, x[0] = x[1] = x[2] = x[3] = 0; i < len; ++i) {
-		int c = seq_nt4_table[(uint8_t)seq[i]];
+		int c = ha_seq_nt4_table[(uint8_t)seq[i]];
 		if (c < 4) { // not an "N" base
 			if (c != last) {
 				x[0] = (x[0] << 1 | (c&1))  & mask;
@@ -483,14 +719,20 @@ KSEQ_INIT(gzFile, gzread)
 #define HAF_RS_WRITE_SEQ 0x8
 #define HAF_RS_READ      0x10
 #define HAF_CREATE_NEW   0x20
+#define HAF_KEEP_MZ      0x40 // keep minimizers in the count table for ha_pt_fill()
+#define HAF_RS_ONLY      0x80 // only write reads to All_reads; no k-mers
+#define HAF_MZ_CACHE     0x100 // take minimizers from and save them to the cache
 
 typedef struct { // global data structure for kt_pipeline()
 	const yak_copt_t *opt;
 	const void *flt_tab;
-	int flag, create_new, is_store;
+	int flag, create_new, is_store, keep_mz;
 	uint64_t n_seq;
 	kseq_t *ks;
-	UC_Read ucr;
+	const ha_mem_reads_t *mem;
+	int64_t mem_i;
+	uint64_t n_in; // number of input reads, including dropped ones
+	const uint64_t *drop;
 	ha_ct_t *ct;
 	ha_pt_t *pt;
 	const All_reads *rs_in;
@@ -506,6 +748,9 @@ typedef struct { // data structure for each step in kt_pipeline()
 	ha_mz1_v *mz_buf;
 	ha_mz1_v *mz;
 	ch_buf_t *buf;
+	uint64_t *off; // if set, buf[] points into pool_a or pool_b
+	uint64_t *pool_a;
+	ha_mz1_t *pool_b;
 } st_data_t;
 
 static void worker_for_insert(void *data, long i, int tid) // callback for kt_for()
@@ -514,6 +759,8 @@ static void worker_for_insert(void *data, long i, int tid) // callback for kt_fo
 	ch_buf_t *b = &s->buf[i];
 	if (s->p->pt)
 		b->n_ins += ha_pt_insert_list(s->p->pt, b->n, b->b);
+	else if (b->b)
+		b->n_ins += ha_ct_insert_mz(s->p->ct, s->p->create_new, b->n, b->b);
 	else
 		b->n_ins += ha_ct_insert_list(s->p->ct, s->p->create_new, b->n, b->a);
 }
@@ -523,12 +770,35 @@ static void worker_for_mz(void *data, long i, int tid)
 	st_data_t *s = (st_data_t*)data;
 	ha_mz1_v *b = &s->mz_buf[tid];
 	s->mz_buf[tid].n = 0;
-	ha_sketch(s->seq[i], s->len[i], s->p->opt->w, s->p->opt->k, s->n_seq0 + i, s->p->opt->is_HPC, b, s->p->flt_tab);
+	if (!(s->p->flag & HAF_MZ_CACHE) || !ha_mzc_get(s->n_seq0 + i, b)) {
+		ha_sketch(s->seq[i], s->len[i], s->p->opt->w, s->p->opt->k, s->n_seq0 + i, s->p->opt->is_HPC, b, s->p->flt_tab);
+		if (s->p->flag & HAF_MZ_CACHE) ha_mzc_put(s->n_seq0 + i, b->a, b->n);
+	}
 	s->mz[i].n = s->mz[i].m = b->n;
 	MALLOC(s->mz[i].a, b->n);
 	memcpy(s->mz[i].a, b->a, b->n * sizeof(ha_mz1_t));
 }
 
+#define ha_rd_isdrop(d, i) ((d) && ((d)[(i)>>6]>>((i)&63)&1))
+
+static int read_seq(pl_data_t *p, const char **name, int *l_name, const char **seq) // from the file or from memory; dropped reads skipped
+{
+	int ret;
+	for (;;) {
+		if (p->mem) {
+			if (p->mem_i >= p->mem->n) return -1;
+			*name = p->mem->name[p->mem_i], *l_name = strlen(*name);
+			*seq = p->mem->seq[p->mem_i];
+			ret = p->mem->len[p->mem_i++];
+		} else {
+			if ((ret = kseq_read(p->ks)) < 0) return ret;
+			*name = p->ks->name.s, *l_name = p->ks->name.l, *seq = p->ks->seq.s;
+			ret = p->ks->seq.l;
+		}
+		if (!ha_rd_isdrop(p->drop, p->n_in++)) return ret;
+	}
+}
+
 static void *worker_count(void *data, int step, void *in) // callback for kt_pipeline()
 {
 	pl_data_t *p = (pl_data_t*)data;
@@ -540,16 +810,20 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 		s->n_seq0 = p->n_seq;
 		if (p->rs_in && (p->flag & HAF_RS_READ)) {
 			while (p->n_seq < p->rs_in->total_reads) {
-				int l;
-				recover_UC_Read(&p->ucr, p->rs_in, p->n_seq);
-				l = p->ucr.length;
+				int l, cached = (p->flag & HAF_MZ_CACHE) && p->opt->w > 1 && ha_mzc_has(p->n_seq);
 				if (s->n_seq == s->m_seq) {
 					s->m_seq = s->m_seq < 16? 16 : s->m_seq + (s->m_seq>>1);
 					REALLOC(s->len, s->m_seq);
 					REALLOC(s->seq, s->m_seq);
 				}
-				MALLOC(s->seq[s->n_seq], l);
-				memcpy(s->seq[s->n_seq], p->ucr.seq, l);
+				if (cached) { // no need to decode the read
+					l = Get_READ_LENGTH(*p->rs_in, p->n_seq);
+					s->seq[s->n_seq] = 0;
+				} else {
+					l = Get_READ_LENGTH(*p->rs_in, p->n_seq);
+					MALLOC(s->seq[s->n_seq], l + 4);
+					recover_UC_Read_nt4((uint8_t*)s->seq[s->n_seq], p->rs_in, p->n_seq); // ha_sketch() and counting take 0-4 codes
+				}
 				s->len[s->n_seq++] = l;
 				++p->n_seq;
 				s->sum_len += l;
@@ -558,8 +832,10 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 					break;
 			}
 		} else {
-			while ((ret = kseq_read(p->ks)) >= 0) {
-				int l = p->ks->seq.l;
+			const char *name, *seq;
+			int l_name;
+			while ((ret = read_seq(p, &name, &l_name, &seq)) >= 0) {
+				int l = ret;
 				if (p->n_seq >= 1<<28) {
 					fprintf(stderr, "ERROR: this implementation supports no more than %d reads\n", 1<<28);
 					exit(1);
@@ -567,24 +843,28 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 				if (p->rs_out) {
 					if (p->flag & HAF_RS_WRITE_LEN) {
 						assert(p->n_seq == p->rs_out->total_reads);
-						ha_insert_read_len(p->rs_out, l, p->ks->name.l);
+						ha_insert_read_len(p->rs_out, l, l_name);
 					} else if (p->flag & HAF_RS_WRITE_SEQ) {
 						int i, n_N;
 						assert(l == (int)p->rs_out->read_length[p->n_seq]);
 						for (i = n_N = 0; i < l; ++i) // count number of ambiguous bases
-							if (seq_nt4_table[(uint8_t)p->ks->seq.s[i]] >= 4)
+							if (ha_seq_nt4_table[(uint8_t)seq[i]] >= 4)
 								++n_N;
-						ha_compress_base(Get_READ(*p->rs_out, p->n_seq), p->ks->seq.s, l, &p->rs_out->N_site[p->n_seq], n_N);
-						memcpy(&p->rs_out->name[p->rs_out->name_index[p->n_seq]], p->ks->name.s, p->ks->name.l);
+						ha_compress_base(Get_READ(*p->rs_out, p->n_seq), (char*)seq, l, &p->rs_out->N_site[p->n_seq], n_N);
+						memcpy(&p->rs_out->name[p->rs_out->name_index[p->n_seq]], name, l_name);
 					}
 				}
+				if (p->flag & HAF_RS_ONLY) { // read everything in this step
+					++p->n_seq;
+					continue;
+				}
 				if (s->n_seq == s->m_seq) {
 					s->m_seq = s->m_seq < 16? 16 : s->m_seq + (s->m_seq>>1);
 					REALLOC(s->len, s->m_seq);
 					REALLOC(s->seq, s->m_seq);
 				}
 				MALLOC(s->seq[s->n_seq], l);
-				memcpy(s->seq[s->n_seq], p->ks->seq.s, l);
+				memcpy(s->seq[s->n_seq], seq, l);
 				s->len[s->n_seq++] = l;
 				++p->n_seq;
 				s->sum_len += l;
@@ -598,16 +878,15 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 	} else if (step == 1) { // step 2: extract k-mers
 		st_data_t *s = (st_data_t*)in;
 		int i, n_pre = 1<<p->opt->pre, m;
-		// allocate the k-mer buffer
 		CALLOC(s->buf, n_pre);
-		m = (int)(s->nk * 1.2 / n_pre) + 1;
-		for (i = 0; i < n_pre; ++i) {
-			s->buf[i].m = m;
-			if (p->pt) MALLOC(s->buf[i].b, m);
-			else MALLOC(s->buf[i].a, m);
-		}
-		// fill the buffer
 		if (p->opt->w == 1) { // enumerate all k-mers
+			// allocate the k-mer buffer
+			m = (int)(s->nk * 1.2 / n_pre) + 1;
+			for (i = 0; i < n_pre; ++i) {
+				s->buf[i].m = m;
+				MALLOC(s->buf[i].a, m);
+			}
+			// fill the buffer
 			for (i = 0; i < s->n_seq; ++i) {
 				if (p->opt->is_HPC)
 					count_seq_buf_HPC(s->buf, p->opt->k, p->opt->pre, s->len[i], s->seq[i]);
@@ -624,8 +903,22 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 			for (i = 0; i < p->opt->n_thread; ++i)
 				free(s->mz_buf[i].a);
 			free(s->mz_buf);
+			// count minimizers per bucket and point the buffers into one exactly sized array
+			CALLOC(s->off, n_pre + 1);
+			for (i = 0; i < s->n_seq; ++i)
+				for (j = 0; j < s->mz[i].n; ++j)
+					++s->off[(s->mz[i].a[j].x & (n_pre - 1)) + 1];
+			for (i = 0; i < n_pre; ++i)
+				s->off[i+1] += s->off[i];
+			if (p->pt || p->keep_mz) MALLOC(s->pool_b, s->off[n_pre]);
+			else MALLOC(s->pool_a, s->off[n_pre]);
+			for (i = 0; i < n_pre; ++i) {
+				s->buf[i].m = s->off[i+1] - s->off[i];
+				if (s->pool_b) s->buf[i].b = s->pool_b + s->off[i];
+				else s->buf[i].a = s->pool_a + s->off[i];
+			}
 			// insert minimizers
-			if (p->pt) {
+			if (s->pool_b) {
 				for (i = 0; i < s->n_seq; ++i)
 					for (j = 0; j < s->mz[i].n; ++j)
 						pt_insert_buf(s->buf, p->opt->pre, &s->mz[i].a[j]);
@@ -650,8 +943,13 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 		kt_for(p->opt->n_thread, worker_for_insert, s, n);
 		for (i = 0; i < n; ++i) {
 			n_ins += s->buf[i].n_ins;
-			if (p->pt) free(s->buf[i].b);
-			else free(s->buf[i].a);
+			if (s->off) continue;
+			free(s->buf[i].a);
+		}
+		if (s->off && p->keep_mz) {
+			ha_ct_keep(p->ct, s->off, s->pool_b, p->opt->keep_mem);
+		} else {
+			free(s->off); free(s->pool_a); free(s->pool_b);
 		}
 		if (p->ct) p->ct->tot += n_ins;
 		if (p->pt) p->pt->tot_pos += n_ins;
@@ -666,16 +964,19 @@ static void *worker_count(void *data, int step, void *in) // callback for kt_pip
 	return 0;
 }
 
-static ha_ct_t *yak_count(const yak_copt_t *opt, const char *fn, int flag, ha_pt_t *p0, ha_ct_t *c0, const void *flt_tab, All_reads *rs, int64_t *n_seq)
+static ha_ct_t *yak_count(const yak_copt_t *opt, const char *fn, const ha_mem_reads_t *mem, int flag, ha_pt_t *p0, ha_ct_t *c0, const void *flt_tab, All_reads *rs, int64_t *n_seq, int64_t *n_in)
 {
 	int read_rs = (rs && (flag & HAF_RS_READ));
 	pl_data_t pl;
 	gzFile fp = 0;
 	memset(&pl, 0, sizeof(pl_data_t));
 	pl.n_seq = *n_seq;
+	pl.n_in = *n_in;
+	pl.drop = ha_rd_drop;
 	if (read_rs) {
 		pl.rs_in = rs;
-		init_UC_Read(&pl.ucr);
+	} else if (mem) {
+		pl.mem = mem;
 	} else {
 		if ((fp = gzopen(fn, "r")) == 0) return 0;
 		pl.ks = kseq_init(fp);
@@ -695,21 +996,21 @@ static ha_ct_t *yak_count(const yak_copt_t *opt, const char *fn, int flag, ha_pt
 		pl.create_new = 1; // alware create new elements if the count table is empty
 		pl.ct = ha_ct_init(opt->k, opt->pre, opt->bf_n_hash, opt->bf_shift);
 	}
+	pl.keep_mz = (pl.pt == 0 && opt->w > 1 && opt->keep_mem > 0 && !pl.ct->keep_fail);
 	kt_pipeline(3, worker_count, &pl, 3);
-	if (read_rs) {
-		destory_UC_Read(&pl.ucr);
-	} else {
+	if (!read_rs && !mem) {
 		kseq_destroy(pl.ks);
 		gzclose(fp);
 	}
 	*n_seq = pl.n_seq;
+	*n_in = pl.n_in;
 	return pl.ct;
 }
 
 ha_ct_t *ha_count(const hifiasm_opt_t *asm_opt, int flag, ha_pt_t *p0, const void *flt_tab, All_reads *rs)
 {
 	int i;
-	int64_t n_seq = 0;
+	int64_t n_seq = 0, n_in = 0;
 	yak_copt_t opt;
 	ha_ct_t *h = 0;
 	assert(!(flag & HAF_RS_WRITE_LEN) || !(flag & HAF_RS_WRITE_SEQ)); // not both
@@ -725,13 +1026,169 @@ ha_ct_t *ha_count(const hifiasm_opt_t *asm_opt, int flag, ha_pt_t *p0, const voi
 	opt.w = flag & HAF_COUNT_ALL? 1 : asm_opt->mz_win;
 	opt.bf_shift = flag & HAF_COUNT_EXACT? 0 : asm_opt->bf_shift;
 	opt.n_thread = asm_opt->thread_num;
-	for (i = 0; i < asm_opt->num_reads; ++i)
-		h = yak_count(&opt, asm_opt->read_file_names[i], flag|HAF_CREATE_NEW, p0, h, flt_tab, rs, &n_seq);
+	if (flag & HAF_KEEP_MZ) opt.keep_mem = yak_physmem() / 4;
+	if (asm_opt->mem_reads)
+		h = yak_count(&opt, 0, asm_opt->mem_reads, flag|HAF_CREATE_NEW, p0, h, flt_tab, rs, &n_seq, &n_in);
+	else for (i = 0; i < asm_opt->num_reads; ++i)
+		h = yak_count(&opt, asm_opt->read_file_names[i], 0, flag|HAF_CREATE_NEW, p0, h, flt_tab, rs, &n_seq, &n_in);
 	if (h && opt.bf_shift > 0)
 		ha_ct_destroy_bf(h);
 	return h;
 }
 
+/*********************
+ * Targeted assembly *
+ *********************/
+
+KRADIX_SORT_INIT(ha32, uint32_t, generic_key, 4)
+
+typedef struct {
+	ha_mz1_v mz;
+	uint32_t n, m, *a;
+} tg_buf_t;
+
+typedef struct {
+	const hifiasm_opt_t *opt;
+	const ha_ct_t *ct;
+	int n, m;
+	int64_t sum_len;
+	int *len, *dep;
+	char **seq;
+	tg_buf_t *buf;
+} tg_step_t;
+
+static inline int ha_ct_count(const ha_ct_t *h, uint64_t x)
+{
+	const yak_ct_t *g = h->h[x & ((1ULL<<h->pre) - 1)].h;
+	khint_t k = yak_ct_get(g, x >> h->pre << YAK_COUNTER_BITS);
+	return k == kh_end(g)? 0 : kh_key(g, k) & YAK_MAX_COUNT;
+}
+
+static void worker_tg_depth(void *data, long i, int tid) // callback for kt_for(); median minimizer count of a read
+{
+	tg_step_t *s = (tg_step_t*)data;
+	tg_buf_t *b = &s->buf[tid];
+	uint32_t j;
+	b->mz.n = 0;
+	ha_sketch(s->seq[i], s->len[i], s->opt->mz_win, s->opt->k_mer_length, 0, !(s->opt->flag & HA_F_NO_HPC), &b->mz, 0);
+	if (b->mz.n > b->m) {
+		b->m = b->mz.n;
+		REALLOC(b->a, b->m);
+	}
+	for (j = 0, b->n = 0; j < b->mz.n; ++j)
+		b->a[b->n++] = ha_ct_count(s->ct, b->mz.a[j].x);
+	if (b->n == 0) {
+		s->dep[i] = 0;
+		return;
+	}
+	radix_sort_ha32(b->a, b->a + b->n);
+	s->dep[i] = b->a[b->n>>1];
+}
+
+static int tg_median(const int64_t cnt[YAK_N_COUNTS])
+{
+	int64_t tot = 0, acc = 0;
+	int i;
+	for (i = 1; i < YAK_N_COUNTS; ++i) tot += cnt[i];
+	for (i = 1; i < YAK_N_COUNTS; ++i)
+		if ((acc += cnt[i]) * 2 >= tot) break;
+	return tot? i : -1;
+}
+
+/*
+ * For reads from a small region. The depth of a read is the median count
+ * of its minimizers, which is close to the read coverage of where it comes
+ * from. The median depth replaces the genome-wide default of hom_cov, reads
+ * deeper than asm_opt->max_cov are kept with probability max_cov/depth
+ * (dropped reads are recorded in ha_rd_drop and skipped by later passes) and
+ * the bloom filter is shrunk to the number of bases kept.
+ */
+void ha_targeted_prep(hifiasm_opt_t *asm_opt)
+{
+	ha_ct_t *ct;
+	tg_step_t s;
+	int64_t cnt[YAK_N_COUNTS], cnt_kept[YAK_N_COUNTS], n_in = 0, n_drop = 0, n_bases = 0, m_drop = 0;
+	int f, i, l, bf_shift, cov, cov_kept, max_cov = asm_opt->max_cov;
+
+	ct = ha_count(asm_opt, HAF_COUNT_EXACT, NULL, NULL, NULL); // minimizer counts
+	memset(&s, 0, sizeof(tg_step_t));
+	memset(cnt, 0, sizeof(cnt));
+	memset(cnt_kept, 0, sizeof(cnt_kept));
+	s.opt = asm_opt, s.ct = ct;
+	CALLOC(s.buf, asm_opt->thread_num);
+	for (f = 0; f < (asm_opt->mem_reads? 1 : asm_opt->num_reads); ++f) {
+		pl_data_t pl;
+		gzFile fp = 0;
+		memset(&pl, 0, sizeof(pl_data_t));
+		if (asm_opt->mem_reads) {
+			pl.mem = asm_opt->mem_reads;
+		} else {
+			if ((fp = gzopen(asm_opt->read_file_names[f], "r")) == 0) continue;
+			pl.ks = kseq_init(fp);
+		}
+		do {
+			const char *name, *seq;
+			int l_name;
+			if ((l = read_seq(&pl, &name, &l_name, &seq)) >= 0) {
+				if (s.n == s.m) {
+					s.m = s.m < 16? 16 : s.m + (s.m>>1);
+					REALLOC(s.len, s.m);
+					REALLOC(s.dep, s.m);
+					REALLOC(s.seq, s.m);
+				}
+				MALLOC(s.seq[s.n], l);
+				memcpy(s.seq[s.n], seq, l);
+				s.len[s.n++] = l;
+				s.sum_len += l;
+			}
+			if (s.n > 0 && (l < 0 || s.sum_len >= 20000000)) {
+				kt_for(asm_opt->thread_num, worker_tg_depth, &s, s.n);
+				if (max_cov > 0 && n_in + s.n > m_drop * 64) {
+					int64_t old = m_drop;
+					m_drop = (n_in + s.n + 63) / 64;
+					kroundup64(m_drop);
+					REALLOC(ha_rd_drop, m_drop);
+					memset(&ha_rd_drop[old], 0, (m_drop - old) * sizeof(uint64_t));
+				}
+				for (i = 0; i < s.n; ++i, ++n_in) {
+					int d = s.dep[i];
+					++cnt[d];
+					if (max_cov > 0 && d > max_cov && (yak_hash64_64(n_in) >> 40) >= (uint64_t)((double)max_cov / d * (1<<24))) {
+						ha_rd_drop[n_in>>6] |= 1ULL << (n_in&63);
+						++n_drop;
+					} else {
+						++cnt_kept[max_cov > 0 && d > max_cov? max_cov : d];
+						n_bases += s.len[i];
+					}
+					free(s.seq[i]);
+				}
+				s.n = 0, s.sum_len = 0;
+			}
+		} while (l >= 0);
+		if (fp) {
+			kseq_destroy(pl.ks);
+			gzclose(fp);
+		}
+	}
+	for (i = 0; i < asm_opt->thread_num; ++i) {
+		free(s.buf[i].mz.a);
+		free(s.buf[i].a);
+	}
+	free(s.buf); free(s.len); free(s.dep); free(s.seq);
+	ha_ct_destroy(ct);
+
+	cov = tg_median(cnt);
+	cov_kept = tg_median(cnt_kept);
+	if (cov_kept > 0) asm_opt->hom_cov = cov_kept;
+	for (bf_shift = 1; 1LL<<bf_shift < n_bases; ++bf_shift);
+	++bf_shift; // two bits per base leaves plenty of room as most k-mers are seen many times
+	if (bf_shift < YAK_COUNTER_BITS + YAK_BLK_SHIFT) bf_shift = 0; // too few k-mers to bother
+	if (bf_shift < asm_opt->bf_shift) asm_opt->bf_shift = bf_shift;
+	fprintf(stderr, "[M::%s::%.3f*%.2f] ==> %ld reads with median depth %d; dropped %ld reads deeper than %d\n", __func__,
+			yak_realtime(), yak_cpu_usage(), (long)n_in, cov, (long)n_drop, max_cov);
+	fprintf(stderr, "[M::%s] hom_cov: %d; bloom filter bits: %d for %ld bases\n", __func__, asm_opt->hom_cov, asm_opt->bf_shift, (long)n_bases);
+}
+
 /***************************
  * High count filter table *
  ***************************/
@@ -771,6 +1228,33 @@ void ha_ft_destroy(void *h)
 	if (h) yak_ft_destroy((yak_ft_t*)h);
 }
 
+void ha_ft_dump(const void *hh, FILE *fp) // a null table is written as an empty one
+{
+	const yak_ft_t *h = (const yak_ft_t*)hh;
+	uint64_t n = h? kh_size(h) : 0;
+	khint_t k;
+	fwrite(&n, sizeof(n), 1, fp);
+	if (h == 0) return;
+	for (k = 0; k < kh_end(h); ++k)
+		if (kh_exist(h, k))
+			fwrite(&kh_key(h, k), sizeof(uint64_t), 1, fp);
+}
+
+void *ha_ft_load(FILE *fp)
+{
+	yak_ft_t *h;
+	uint64_t i, n, y;
+	int absent;
+	if (fread(&n, sizeof(n), 1, fp) != 1 || n == 0) return 0;
+	h = yak_ft_init();
+	yak_ft_resize(h, n * 2);
+	for (i = 0; i < n; ++i) {
+		if (fread(&y, sizeof(y), 1, fp) != 1) break;
+		yak_ft_put(h, y, &absent);
+	}
+	return (void*)h;
+}
+
 /*************************
  * High-level interfaces *
  *************************/
@@ -799,9 +1283,10 @@ void *ha_ft_gen(const hifiasm_opt_t *asm_opt, All_reads *rs, int *hom_cov)
 ha_pt_t *ha_pt_gen(const hifiasm_opt_t *asm_opt, const void *flt_tab, int read_from_store, All_reads *rs, int *hom_cov)
 {
 	int64_t cnt[YAK_N_COUNTS], tot_cnt;
-	int peak_hom, peak_het, i, extra_flag1, extra_flag2;
+	int peak_hom, peak_het, i, extra_flag1, extra_flag2, n_blk;
 	ha_ct_t *ct;
 	ha_pt_t *pt;
+	ha_mzblk_t *blk;
 	if (read_from_store) {
 		extra_flag1 = extra_flag2 = HAF_RS_READ;
 	} else if (rs->total_reads == 0) {
@@ -811,7 +1296,8 @@ ha_pt_t *ha_pt_gen(const hifiasm_opt_t *asm_opt, const void *flt_tab, int read_f
 		extra_flag1 = HAF_RS_WRITE_SEQ;
 		extra_flag2 = HAF_RS_READ;
 	}
-	ct = ha_count(asm_opt, HAF_COUNT_EXACT|extra_flag1, NULL, flt_tab, rs);
+	ct = ha_count(asm_opt, HAF_COUNT_EXACT|HAF_KEEP_MZ|HAF_MZ_CACHE|extra_flag1, NULL, flt_tab, rs);
+	ha_mzc_init(rs->total_reads);
 	fprintf(stderr, "[M::%s::%.3f*%.2f] ==> counted %ld distinct minimizer k-mers\n", __func__,
 			yak_realtime(), yak_cpu_usage(), (long)ct->tot);
 	ha_ct_hist(ct, cnt, asm_opt->thread_num);
@@ -828,8 +1314,17 @@ ha_pt_t *ha_pt_gen(const hifiasm_opt_t *asm_opt, const void *flt_tab, int read_f
 		ha_ct_shrink(ct, 2, YAK_MAX_COUNT - 1, asm_opt->thread_num);
 		for (i = 2, tot_cnt = 0; i <= YAK_MAX_COUNT - 1; ++i) tot_cnt += cnt[i] * i;
 	}
+	n_blk = ct->keep_fail? 0 : ct->n_blk, blk = ct->blk;
+	ct->n_blk = ct->m_blk = 0, ct->blk = 0;
 	pt = ha_pt_gen(ct, asm_opt->thread_num);
-	ha_count(asm_opt, HAF_COUNT_EXACT|extra_flag2, pt, flt_tab, rs);
+	if (n_blk > 0) { // no need to sketch the reads again
+		ha_pt_fill(pt, n_blk, blk, asm_opt->thread_num);
+		if (extra_flag2 & HAF_RS_WRITE_SEQ)
+			ha_count(asm_opt, HAF_RS_ONLY|extra_flag2, pt, flt_tab, rs);
+	} else {
+		free(blk);
+		ha_count(asm_opt, HAF_COUNT_EXACT|HAF_MZ_CACHE|extra_flag2, pt, flt_tab, rs);
+	}
 	assert((uint64_t)tot_cnt == pt->tot_pos);
 	//ha_pt_sort(pt, asm_opt->thread_num);
 	fprintf(stderr, "[M::%s::%.3f*%.2f] ==> indexed %ld positions\n", __func__,
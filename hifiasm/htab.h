@@ -22,17 +22,23 @@ typedef struct ha_pt_s ha_pt_t;
 struct ha_abuf_s;
 typedef struct ha_abuf_s ha_abuf_t;
 
-extern const unsigned char seq_nt4_table[256];
+extern const unsigned char ha_seq_nt4_table[256];
 extern void *ha_flt_tab;
 extern ha_pt_t *ha_idx;
+extern uint64_t *ha_rd_drop; // reads dropped by ha_targeted_prep(), as a bit set in the input order
+
+void ha_targeted_prep(hifiasm_opt_t *asm_opt);
 
 void *ha_ft_gen(const hifiasm_opt_t *asm_opt, All_reads *rs, int *hom_cov);
 int ha_ft_isflt(const void *hh, uint64_t y);
 void ha_ft_destroy(void *h);
+void ha_ft_dump(const void *h, FILE *fp);
+void *ha_ft_load(FILE *fp);
 
 ha_pt_t *ha_pt_gen(const hifiasm_opt_t *asm_opt, const void *flt_tab, int read_from_store, All_reads *rs, int *hom_cov);
 void ha_pt_destroy(ha_pt_t *h);
 const ha_idxpos_t *ha_pt_get(const ha_pt_t *h, uint64_t hash, int *n);
+uint64_t ha_pt_get_batch(const ha_pt_t *h, uint32_t n, const ha_mz1_t *mz, const ha_idxpos_t **a, int *cnt);
 
 ha_abuf_t *ha_abuf_init(void);
 void ha_abuf_destroy(ha_abuf_t *ab);
@@ -42,12 +48,39 @@ double yak_cputime(void);
 void yak_reset_realtime(void);
 double yak_realtime(void);
 long yak_peakrss(void);
+long yak_physmem(void);
 double yak_peakrss_in_gb(void);
 double yak_cpu_usage(void);
 
 void ha_triobin(const hifiasm_opt_t *opt);
+int ha_triobin_dump(const hifiasm_opt_t *opt, const char *fn);
+
+#define HA_CKPT_VERSION 2
+#define HA_CKPT_EC      1 // corrected reads after a round of correction
+#define HA_CKPT_OVLP    2 // corrected reads and the final overlaps
+#define HA_CKPT_GRAPH   3 // cleaned string graph
+
+void ha_ckpt_init(const hifiasm_opt_t *opt);
+int ha_ckpt_seal(const char *fn, int stage);
+int ha_ckpt_check(const char *fn, int stage);
+
+typedef struct { size_t l, m; char *s; } ha_gfa_buf_t;
+typedef struct ha_gfa_out_s ha_gfa_out_t;
+
+void ha_gfa_puts(ha_gfa_buf_t *b, const char *s, size_t l);
+void ha_gfa_printf(ha_gfa_buf_t *b, const char *fmt, ...);
+ha_gfa_out_t *ha_gfa_open(const char *prefix, const char *variant); // NULL if the variant is skipped
+void ha_gfa_write(ha_gfa_out_t *o, const char *s, size_t l);
+void ha_gfa_seg(ha_gfa_out_t *o, const char *name, uint32_t len); // index the S-line written next
+void ha_gfa_close(ha_gfa_out_t *o);
 
 void ha_sketch(const char *str, int len, int w, int k, uint32_t rid, int is_hpc, ha_mz1_v *p, const void *hf);
+
+void ha_mzc_init(uint64_t n_read);
+void ha_mzc_destroy(void);
+void ha_mzc_mark(uint64_t rid, int changed, int flipped);
+int ha_mzc_get(uint64_t rid, ha_mz1_v *p);
+void ha_mzc_put(uint64_t rid, const ha_mz1_t *a, uint32_t n);
 int ha_analyze_count(int n_cnt, const int64_t *cnt, int *peak_het);
 
 static inline uint64_t yak_hash64(uint64_t key, uint64_t mask) // invertible integer hash function
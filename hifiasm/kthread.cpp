@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <limits.h>
 #include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
 #include "kthread.h"
 
 #if (defined(WIN32) || defined(_WIN32)) && defined(_MSC_VER)
@@ -25,8 +27,26 @@ typedef struct kt_for_t {
 	ktf_worker_t *w;
 	void (*func)(void*,long,int);
 	void *data;
+	const uint32_t *order; // if not NULL, the i-th item processed is order[i]
+	double *busy;          // if not NULL, busy[tid] accumulates the time spent in func()
 } kt_for_t;
 
+static inline double ktf_realtime(void)
+{
+	struct timeval tp;
+	gettimeofday(&tp, NULL);
+	return tp.tv_sec + tp.tv_usec * 1e-6;
+}
+
+static inline void ktf_run(kt_for_t *t, long i, int tid)
+{
+	if (t->busy) {
+		double t0 = ktf_realtime();
+		t->func(t->data, t->order? t->order[i] : i, tid);
+		t->busy[tid] += ktf_realtime() - t0;
+	} else t->func(t->data, t->order? t->order[i] : i, tid);
+}
+
 static inline long steal_work(kt_for_t *t)
 {
 	int i, min_i = -1;
@@ -44,20 +64,20 @@ static void *ktf_worker(void *data)
 	for (;;) {
 		i = __sync_fetch_and_add(&w->i, w->t->n_threads);
 		if (i >= w->t->n) break;
-		w->t->func(w->t->data, i, w - w->t->w);
+		ktf_run(w->t, i, w - w->t->w);
 	}
 	while ((i = steal_work(w->t)) >= 0)
-		w->t->func(w->t->data, i, w - w->t->w);
+		ktf_run(w->t, i, w - w->t->w);
 	pthread_exit(0);
 }
 
-void kt_for(int n_threads, void (*func)(void*,long,int), void *data, long n)
+static void kt_for_core(int n_threads, void (*func)(void*,long,int), void *data, long n, const uint32_t *order, double *busy)
 {
 	if (n_threads > 1) {
 		int i;
 		kt_for_t t;
 		pthread_t *tid;
-		t.func = func, t.data = data, t.n_threads = n_threads, t.n = n;
+		t.func = func, t.data = data, t.n_threads = n_threads, t.n = n, t.order = order, t.busy = busy;
 		t.w = (ktf_worker_t*)calloc(n_threads, sizeof(ktf_worker_t));
 		tid = (pthread_t*)calloc(n_threads, sizeof(pthread_t));
 		for (i = 0; i < n_threads; ++i)
@@ -66,11 +86,26 @@ void kt_for(int n_threads, void (*func)(void*,long,int), void *data, long n)
 		for (i = 0; i < n_threads; ++i) pthread_join(tid[i], 0);
 		free(tid); free(t.w);
 	} else {
+		kt_for_t t;
 		long j;
-		for (j = 0; j < n; ++j) func(data, j, 0);
+		t.func = func, t.data = data, t.order = order, t.busy = busy;
+		for (j = 0; j < n; ++j) ktf_run(&t, j, 0);
 	}
 }
 
+void kt_for(int n_threads, void (*func)(void*,long,int), void *data, long n)
+{
+	kt_for_core(n_threads, func, data, n, 0, 0);
+}
+
+double kt_for_order(int n_threads, void (*func)(void*,long,int), void *data, long n, const uint32_t *order, double *busy)
+{
+	double t0 = ktf_realtime();
+	if (busy) memset(busy, 0, n_threads * sizeof(double));
+	kt_for_core(n_threads, func, data, n, order, busy);
+	return ktf_realtime() - t0;
+}
+
 /*****************
  * kt_pipeline() *
  *****************/
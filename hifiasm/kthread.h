@@ -1,11 +1,21 @@
 #ifndef KTHREAD_H
 #define KTHREAD_H
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void kt_for(int n_threads, void (*func)(void*,long,int), void *data, long n);
+/*
+ * kt_for() that processes order[0], order[1], ... in this order (0, 1, ... if
+ * order is NULL). Each thread walks its own stride and steals from the slowest
+ * one when done, so putting the most expensive items first leaves only cheap
+ * ones for the end. If busy is not NULL, busy[tid] gets the seconds thread tid
+ * spent in func(). Returns the wall-clock time of the call.
+ */
+double kt_for_order(int n_threads, void (*func)(void*,long,int), void *data, long n, const uint32_t *order, double *busy);
 void kt_pipeline(int n_threads, void *(*func)(void*, int, void*), void *shared_data, int n_steps);
 
 #ifdef __cplusplus
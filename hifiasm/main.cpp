@@ -12,7 +12,8 @@ int main(int argc, char *argv[])
 	yak_reset_realtime();
     init_opt(&asm_opt);
     if (!CommandLine_process(argc, argv, &asm_opt)) return 1;
-	ret = ha_assemble();
+	if (asm_opt.fn_trio_dump) ret = ha_triobin_dump(&asm_opt, asm_opt.fn_trio_dump);
+	else ret = ha_assemble();
     destory_opt(&asm_opt);
 	fprintf(stderr, "[M::%s] Version: %s\n", __func__, HA_VERSION);
 	fprintf(stderr, "[M::%s] CMD:", __func__);
@@ -50,15 +50,15 @@ void ha_sketch(const char *str, int len, int w, int k, uint32_t rid, int is_hpc,
 	kv_resize(ha_mz1_t, *p, p->n + len/w);
 
 	for (i = l = buf_pos = min_pos = 0; i < len; ++i) {
-		int c = seq_nt4_table[(uint8_t)str[i]];
+		int c = ha_seq_nt4_table[(uint8_t)str[i]];
 		ha_mz1_t info = dummy;
 		if (c < 4) { // not an ambiguous base
 			int z;
 			if (is_hpc) {
 				int skip_len = 1;
-				if (i + 1 < len && seq_nt4_table[(uint8_t)str[i + 1]] == c) {
+				if (i + 1 < len && ha_seq_nt4_table[(uint8_t)str[i + 1]] == c) {
 					for (skip_len = 2; i + skip_len < len; ++skip_len)
-						if (seq_nt4_table[(uint8_t)str[i + skip_len]] != c)
+						if (ha_seq_nt4_table[(uint8_t)str[i + skip_len]] != c)
 							break;
 					i += skip_len - 1; // put $i at the end of the current homopolymer run
 				}
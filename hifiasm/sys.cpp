@@ -1,5 +1,6 @@
 #include <sys/resource.h>
 #include <sys/time.h>
+#include <unistd.h>
 #include "htab.h"
 
 int yak_verbose = 3;
@@ -42,6 +43,11 @@ long yak_peakrss(void)
 #endif
 }
 
+long yak_physmem(void) // total physical memory in bytes
+{
+	return sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+}
+
 double yak_peakrss_in_gb(void)
 {
 	return yak_peakrss() / 1073741824.0;
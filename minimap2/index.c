@@ -4,6 +4,8 @@
 #include <io.h> // for open(2)
 #else
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #endif
 #include <fcntl.h>
 #include <stdio.h>
@@ -58,7 +60,10 @@ void mm_idx_destroy(mm_idx_t *mi)
 	uint32_t i;
 	if (mi == 0) return;
 	if (mi->h) kh_destroy(str, (khash_t(str)*)mi->h);
-	if (mi->B) {
+	if (mi->B && mi->mm) { // only the hash table headers are allocated
+		for (i = 0; i < 1U<<mi->b; ++i)
+			free(mi->B[i].h);
+	} else if (mi->B) {
 		for (i = 0; i < 1U<<mi->b; ++i) {
 			free(mi->B[i].p);
 			free(mi->B[i].a.a);
@@ -75,6 +80,9 @@ void mm_idx_destroy(mm_idx_t *mi)
 			free(mi->seq[i].name);
 		free(mi->seq);
 	} else km_destroy(mi->km);
+#if !(defined(WIN32) || defined(_WIN32))
+	if (mi->mm) munmap(mi->mm, mi->l_mm), mi->S = 0;
+#endif
 	free(mi->B); free(mi->S); free(mi);
 }
 
@@ -478,6 +486,146 @@ void mm_idx_dump(FILE *fp, const mm_idx_t *mi)
 	fflush(fp);
 }
 
+/*
+ * Memory-mappable index. All fields are native-endian and every block below
+ * starts at an 8-byte boundary:
+ *
+ *   magic[4], uint32_t {w, k, b, n_seq, flag}
+ *   uint64_t l_names, then n_seq NUL-terminated names
+ *   n_seq x {uint32_t len, is_alt}
+ *   for each bucket: uint32_t {n, n_buckets, size, n_occupied, upper_bound, 0},
+ *     p[n], and if n_buckets > 0, the khash flags, keys and vals arrays
+ *   packed sequence S
+ */
+
+static int mm_write_pad(FILE *fp, size_t l) // pad to the next 8-byte boundary after writing l bytes
+{
+	static const uint8_t zero[8] = {0,0,0,0,0,0,0,0};
+	size_t pad = (8 - (l & 7)) & 7;
+	return pad == 0 || fwrite(zero, 1, pad, fp) == pad? 0 : -1;
+}
+
+static int mm_write_block(FILE *fp, const void *p, size_t l)
+{
+	if (l > 0 && fwrite(p, 1, l, fp) != l) return -1;
+	return mm_write_pad(fp, l);
+}
+
+int mm_idx_dump_mmap(FILE *fp, const mm_idx_t *mi)
+{
+	uint64_t sum_len = 0, l_names = 0;
+	uint32_t x[6], i;
+
+	x[0] = mi->w, x[1] = mi->k, x[2] = mi->b, x[3] = mi->n_seq, x[4] = mi->flag;
+	if (fwrite(MM_IDX_MAGIC_MMAP, 1, 4, fp) != 4 || fwrite(x, 4, 5, fp) != 5) return -1;
+	for (i = 0; i < mi->n_seq; ++i)
+		l_names += (mi->seq[i].name? strlen(mi->seq[i].name) : 0) + 1;
+	if (fwrite(&l_names, 8, 1, fp) != 1) return -1;
+	for (i = 0; i < mi->n_seq; ++i) {
+		const char *name = mi->seq[i].name? mi->seq[i].name : "";
+		if (fwrite(name, 1, strlen(name) + 1, fp) != strlen(name) + 1) return -1;
+	}
+	if (mm_write_pad(fp, l_names) < 0) return -1;
+	for (i = 0; i < mi->n_seq; ++i) {
+		x[0] = mi->seq[i].len, x[1] = mi->seq[i].is_alt;
+		if (fwrite(x, 4, 2, fp) != 2) return -1;
+		sum_len += mi->seq[i].len;
+	}
+	if (mm_write_pad(fp, mi->n_seq * 8) < 0) return -1;
+	for (i = 0; i < 1U<<mi->b; ++i) {
+		const mm_idx_bucket_t *b = &mi->B[i];
+		const idxhash_t *h = (const idxhash_t*)b->h;
+		x[0] = b->n, x[5] = 0;
+		x[1] = h? h->n_buckets : 0, x[2] = h? h->size : 0;
+		x[3] = h? h->n_occupied : 0, x[4] = h? h->upper_bound : 0;
+		if (fwrite(x, 4, 6, fp) != 6) return -1;
+		if (mm_write_block(fp, b->p, (size_t)b->n * 8) < 0) return -1;
+		if (h == 0 || h->n_buckets == 0) continue;
+		if (mm_write_block(fp, h->flags, __ac_fsize(h->n_buckets) * 4) < 0) return -1;
+		if (mm_write_block(fp, h->keys, (size_t)h->n_buckets * 8) < 0) return -1;
+		if (mm_write_block(fp, h->vals, (size_t)h->n_buckets * 8) < 0) return -1;
+	}
+	if (!(mi->flag & MM_I_NO_SEQ) && mm_write_block(fp, mi->S, (sum_len + 7) / 8 * 4) < 0) return -1;
+	return fflush(fp) == 0? 0 : -1;
+}
+
+#if !(defined(WIN32) || defined(_WIN32))
+static inline const void *mm_map_block(const uint8_t **p, const uint8_t *end, size_t l)
+{
+	const uint8_t *q = *p;
+	l = (l + 7) & ~(size_t)7;
+	if ((size_t)(end - q) < l) return 0;
+	*p += l;
+	return q;
+}
+
+static mm_idx_t *mm_idx_map(FILE *fp) // the magic has been read from fp
+{
+	struct stat st;
+	int64_t off = ftell(fp) - 4;
+	uint32_t i, x[6];
+	uint64_t sum_len = 0, l_names;
+	const uint8_t *p, *end;
+	const char *names;
+	const uint32_t *lens;
+	void *mm;
+	mm_idx_t *mi;
+
+	if (off < 0 || (off & 7) || fstat(fileno(fp), &st) < 0) return 0;
+	mm = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (mm == MAP_FAILED) return 0;
+	p = (const uint8_t*)mm + off + 4, end = (const uint8_t*)mm + st.st_size;
+	if (end - p < 28) goto fail_map;
+	memcpy(x, p, 20), memcpy(&l_names, p + 20, 8), p += 28;
+	if (x[2] > 32 || (names = (const char*)mm_map_block(&p, end, l_names)) == 0) goto fail_map;
+	if ((lens = (const uint32_t*)mm_map_block(&p, end, (size_t)x[3] * 8)) == 0) goto fail_map;
+	mi = mm_idx_init(x[0], x[1], x[2], x[4]);
+	mi->mm = mm, mi->l_mm = st.st_size;
+	mi->n_seq = x[3];
+	mi->seq = (mm_idx_seq_t*)kcalloc(mi->km, mi->n_seq, sizeof(mm_idx_seq_t));
+	for (i = 0; i < mi->n_seq; ++i) {
+		mm_idx_seq_t *s = &mi->seq[i];
+		size_t l = strnlen(names, l_names);
+		if (l == l_names) goto fail;
+		if (l > 0) {
+			s->name = (char*)kmalloc(mi->km, l + 1);
+			memcpy(s->name, names, l + 1);
+		}
+		names += l + 1, l_names -= l + 1;
+		s->len = lens[i<<1], s->is_alt = lens[i<<1|1];
+		s->offset = sum_len;
+		sum_len += s->len;
+		mi->n_alt += s->is_alt;
+	}
+	for (i = 0; i < 1U<<mi->b; ++i) {
+		mm_idx_bucket_t *b = &mi->B[i];
+		const uint32_t *y;
+		idxhash_t *h;
+		if ((y = (const uint32_t*)mm_map_block(&p, end, 24)) == 0) goto fail;
+		b->n = y[0];
+		if ((b->p = (uint64_t*)mm_map_block(&p, end, (size_t)y[0] * 8)) == 0) goto fail;
+		if (y[1] == 0) continue;
+		b->h = h = (idxhash_t*)calloc(1, sizeof(idxhash_t));
+		h->n_buckets = y[1], h->size = y[2], h->n_occupied = y[3], h->upper_bound = y[4];
+		h->flags = (khint32_t*)mm_map_block(&p, end, __ac_fsize(h->n_buckets) * 4);
+		h->keys = (uint64_t*)mm_map_block(&p, end, (size_t)h->n_buckets * 8);
+		h->vals = (uint64_t*)mm_map_block(&p, end, (size_t)h->n_buckets * 8);
+		if (h->flags == 0 || h->keys == 0 || h->vals == 0) goto fail;
+	}
+	if (!(mi->flag & MM_I_NO_SEQ) && (mi->S = (uint32_t*)mm_map_block(&p, end, (sum_len + 7) / 8 * 4)) == 0)
+		goto fail;
+	fseek(fp, p - (const uint8_t*)mm, SEEK_SET);
+	return mi;
+
+fail:
+	mm_idx_destroy(mi);
+	return 0;
+fail_map:
+	munmap(mm, st.st_size);
+	return 0;
+}
+#endif
+
 mm_idx_t *mm_idx_load(FILE *fp)
 {
 	char magic[4];
@@ -486,6 +634,10 @@ mm_idx_t *mm_idx_load(FILE *fp)
 	mm_idx_t *mi;
 
 	if (fread(magic, 1, 4, fp) != 4) return 0;
+#if !(defined(WIN32) || defined(_WIN32))
+	if (strncmp(magic, MM_IDX_MAGIC_MMAP, 4) == 0)
+		return mm_idx_map(fp);
+#endif
 	if (strncmp(magic, MM_IDX_MAGIC, 4) != 0) return 0;
 	if (fread(x, 4, 5, fp) != 5) return 0;
 	mi = mm_idx_init(x[0], x[1], x[2], x[4]);
@@ -550,7 +702,7 @@ int64_t mm_idx_is_idx(const char *fn)
 		lseek(fd, 0, SEEK_SET);
 #endif // WIN32
 		ret = read(fd, magic, 4);
-		if (ret == 4 && strncmp(magic, MM_IDX_MAGIC, 4) == 0)
+		if (ret == 4 && (strncmp(magic, MM_IDX_MAGIC, 4) == 0 || strncmp(magic, MM_IDX_MAGIC_MMAP, 4) == 0))
 			is_idx = 1;
 	}
 	close(fd);
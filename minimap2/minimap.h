@@ -42,6 +42,7 @@
 #define MM_I_NO_NAME      0x4
 
 #define MM_IDX_MAGIC   "MMI\2"
+#define MM_IDX_MAGIC_MMAP "MMIM" // 8-byte aligned layout that can be used in place by mm_idx_load()
 
 #define MM_MAX_SEG       255
 
@@ -71,6 +72,8 @@ typedef struct {
 	struct mm_idx_bucket_s *B; // index (hidden)
 	struct mm_idx_intv_s *I;   // intervals (hidden)
 	void *km, *h;
+	void *mm;                  // if not NULL, S, B[].p and the hash tables point into this read-only mapping
+	size_t l_mm;
 } mm_idx_t;
 
 // minimap2 alignment
@@ -250,7 +253,8 @@ int64_t mm_idx_is_idx(const char *fn);
  *
  * Given a uni-part index, this function loads the entire index into memory.
  * Given a multi-part index, it loads one part only and places the file pointer
- * at the end of that part.
+ * at the end of that part. A file written by mm_idx_dump_mmap() is memory
+ * mapped, not read.
  *
  * @param fp         pointer to FILE object
  *
@@ -266,6 +270,21 @@ mm_idx_t *mm_idx_load(FILE *fp);
  */
 void mm_idx_dump(FILE *fp, const mm_idx_t *mi);
 
+/**
+ * Write an index in the layout of MM_IDX_MAGIC_MMAP
+ *
+ * Unlike mm_idx_dump(), the hash tables are written as they are in memory
+ * and every array is 8-byte aligned, such that mm_idx_load() maps the file
+ * read-only instead of rebuilding the index. Processes loading the same file
+ * share its pages. Such a file holds one index part only.
+ *
+ * @param fp         pointer to FILE object
+ * @param mi         minimap2 index
+ *
+ * @return 0 on success; -1 on write errors
+ */
+int mm_idx_dump_mmap(FILE *fp, const mm_idx_t *mi);
+
 /**
  * Create an index from strings in memory
  *
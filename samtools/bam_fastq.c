@@ -36,15 +36,25 @@ DEALINGS IN THE SOFTWARE.  */
 
 #include "htslib/sam.h"
 #include "htslib/klist.h"
+#include "htslib/khash.h"
 #include "htslib/kstring.h"
 #include "htslib/bgzf.h"
 #include "htslib/thread_pool.h"
 #include "samtools.h"
 #include "sam_opts.h"
+#include "bedidx.h"
 
 #define taglist_free(p)
 KLIST_INIT(ktaglist, char*, taglist_free)
 
+// Read names seen in region mode; done holds one bit per readpart written and
+// sup[] indexes the pending supplementary record of each readpart, or -1
+typedef struct {
+    int done;
+    int sup[3];
+} seen_read_t;
+KHASH_MAP_INIT_STR(seen_read, seen_read_t)
+
 #define DEFAULT_BARCODE_TAG "BC"
 #define DEFAULT_QUALITY_TAG "QT"
 #define INDEX_SEPARATOR "+"
@@ -56,7 +66,7 @@ static void bam2fq_usage(FILE *to, const char *command)
 {
     int fq = strcasecmp("fastq", command) == 0 || strcasecmp("bam2fq", command) == 0;
     fprintf(to,
-"Usage: samtools %s [options...] <in.bam>\n", command);
+"Usage: samtools %s [options...] <in.bam> [region ...]\n", command);
     fprintf(to,
 "\n"
 "Description:\n"
@@ -72,6 +82,7 @@ static void bam2fq_usage(FILE *to, const char *command)
 "  -f INT               only include reads with all  of the FLAGs in INT present [0]\n"       //   F&x == x
 "  -F INT               only include reads with none of the FLAGS in INT present [0x900]\n"       //   F&x == 0
 "  -G INT               only EXCLUDE reads with all  of the FLAGs in INT present [0]\n"       // !(F&x == x)
+"  -L FILE              only output reads overlapping regions in the BED FILE\n"
 "  -n                   don't append /1 and /2 to the read name\n"
 "  -N                   always append /1 and /2 to the read name\n");
     if (fq) fprintf(to,
@@ -91,13 +102,20 @@ static void bam2fq_usage(FILE *to, const char *command)
 "  --i2 FILE            write second index reads to FILE\n"
 "  --barcode-tag TAG    Barcode tag [default: " DEFAULT_BARCODE_TAG "]\n"
 "  --quality-tag TAG    Quality tag [default: " DEFAULT_QUALITY_TAG "]\n"
-"  --index-format STR   How to parse barcode and quality tags\n\n");
+"  --index-format STR   How to parse barcode and quality tags\n");
+    fprintf(to,
+"  --sample-file FILE   write the SM tags of @RG header lines to FILE\n\n");
     sam_global_opt_help(to, "-.--.@-.");
     fprintf(to,
 "\n"
 "The files will be automatically compressed if the file names have a .gz or .bgzf extension.\n"
 "The input to this program must be collated by name. Run 'samtools collate' or 'samtools sort -n'.\n"
 "\n"
+"If regions or a BED file are given, the input must instead be an indexed BAM or CRAM.\n"
+"Only the overlapping alignments are decoded and each read is written once: from its\n"
+"primary record if that overlaps a region, else from its longest supplementary record.\n"
+"Mates are not paired up in this mode and -F defaults to 0x100.\n"
+"\n"
 "Reads are designated READ1 if FLAG READ1 is set and READ2 is not set.\n"
 "Reads are designated READ2 if FLAG READ1 is not set and READ2 is set.\n"
 "Reads are designated READ_OTHER if FLAGs READ1 and READ2 are either both set\n"
@@ -140,6 +158,10 @@ typedef struct bam2fq_opts {
     char *index_format;
     char *extra_tags;
     char compression_level;
+    char *fn_bed;
+    char **regs; // pointer to regions in argv do not free
+    int n_regs;
+    char *fn_sample;
 } bam2fq_opts_t;
 
 typedef struct bam2fq_state {
@@ -564,15 +586,17 @@ static bool parse_opts(int argc, char *argv[], bam2fq_opts_t** opts_out)
         {"index-format", required_argument, NULL, 3},
         {"barcode-tag", required_argument, NULL, 'b'},
         {"quality-tag", required_argument, NULL, 'q'},
+        {"sample-file", required_argument, NULL, 4},
         { NULL, 0, NULL, 0 }
     };
-    while ((c = getopt_long(argc, argv, "0:1:2:o:f:F:G:niNOs:c:tT:v:@:", lopts, NULL)) > 0) {
+    while ((c = getopt_long(argc, argv, "0:1:2:o:f:F:G:niNOs:c:tT:v:L:@:", lopts, NULL)) > 0) {
         switch (c) {
             case 'b': opts->barcode_tag = strdup(optarg); break;
             case 'q': opts->quality_tag = strdup(optarg); break;
             case  1 : opts->index_file[0] = optarg; break;
             case  2 : opts->index_file[1] = optarg; break;
             case  3 : opts->index_format = strdup(optarg); break;
+            case  4 : opts->fn_sample = optarg; break;
             case '0': opts->fnr[0] = optarg; break;
             case '1': opts->fnr[1] = optarg; break;
             case '2': opts->fnr[2] = optarg; break;
@@ -585,6 +609,7 @@ static bool parse_opts(int argc, char *argv[], bam2fq_opts_t** opts_out)
                 }
                 opts->flag_off |= strtol(optarg, 0, 0); break;
             case 'G': opts->flag_alloff |= strtol(optarg, 0, 0); break;
+            case 'L': opts->fn_bed = optarg; break;
             case 'n': opts->has12 = false; break;
             case 'N': opts->has12always = true; break;
             case 'O': opts->use_oq = true; break;
@@ -669,13 +694,21 @@ static bool parse_opts(int argc, char *argv[], bam2fq_opts_t** opts_out)
         return true;
     }
 
+    opts->fn_input = argc > optind ? argv[optind] : "-";
     if (argc - optind > 1) {
-        fprintf(stderr, "Too many arguments.\n");
-        bam2fq_usage(stderr, argv[0]);
-        free_opts(opts);
-        return false;
+        opts->regs = argv + optind + 1;
+        opts->n_regs = argc - optind - 1;
+    }
+    if (opts->n_regs || opts->fn_bed) {
+        if (opts->fnse || opts->index_file[0] || opts->illumina_tag) {
+            fprintf(stderr, "Options -s, -i, --i1 and --i2 can't be used with regions\n");
+            bam2fq_usage(stderr, argv[0]);
+            free_opts(opts);
+            return false;
+        }
+        // keep supplementary records: they stand in for primaries outside the regions
+        if (!flag_off_set) opts->flag_off = BAM_FSECONDARY;
     }
-    opts->fn_input = argc > optind ? argv[optind] : "-";
     *opts_out = opts;
     return true;
 }
@@ -757,6 +790,7 @@ static bool init_state(const bam2fq_opts_t* opts, bam2fq_state_t** state_out)
 
     uint32_t rf = SAM_QNAME | SAM_FLAG | SAM_SEQ | SAM_QUAL;
     if (opts->use_oq || opts->extra_tags || opts->index_file[0]) rf |= SAM_AUX;
+    if (opts->n_regs || opts->fn_bed) rf |= SAM_RNAME | SAM_POS | SAM_CIGAR; // needed to test region overlaps
     if (hts_set_opt(state->fp, CRAM_OPT_REQUIRED_FIELDS, rf)) {
         fprintf(stderr, "Failed to set CRAM_OPT_REQUIRED_FIELDS value\n");
         free(state);
@@ -1016,6 +1050,161 @@ static bool bam2fq_mainloop(bam2fq_state_t *state, bam2fq_opts_t* opts)
     return valid;
 }
 
+static bool write_samples(const char *fn, sam_hdr_t *h)
+{
+    kstring_t sm = { 0, 0, NULL }, out = { 0, 0, NULL };
+    int i, n_rg = sam_hdr_count_lines(h, "RG");
+    bool valid = true;
+
+    for (i = 0; i < n_rg; i++) {
+        if (sam_hdr_find_tag_pos(h, "RG", i, "SM", &sm) < 0) continue;
+        fprintf(stderr, "[M::%s] read group %d has sample \"%s\"\n", __func__, i, sm.s);
+        if (kputs(sm.s, &out) < 0 || kputc('\n', &out) < 0) { valid = false; break; }
+    }
+    if (valid) {
+        FILE *fp = fopen(fn, "w");
+        if (!fp || fwrite(out.s ? out.s : "", 1, out.l, fp) != out.l) valid = false;
+        if (fp && fclose(fp) != 0) valid = false;
+    }
+    if (!valid) print_error_errno("bam2fq", "Cannot write sample file \"%s\"", fn);
+    free(sm.s);
+    free(out.s);
+    return valid;
+}
+
+static bool write_fq_record(const bam1_t *b, BGZF *fp, kstring_t *linebuf, const bam2fq_state_t *state)
+{
+    if (!bam1_to_fq(b, linebuf, state)) {
+        fprintf(stderr, "[bam2fq_region_loop] Error converting read to FASTA/Q\n");
+        return false;
+    }
+    return bgzf_write(fp, linebuf->s, linebuf->l) >= 0;
+}
+
+/*
+ * Write the reads overlapping a list of regions. As the alignments come in
+ * coordinate order, a read may turn up several times: once as its primary
+ * record, which is written as soon as it is seen, and any number of times as
+ * a supplementary record. The longest supplementary of each read is kept
+ * aside and only written at the end if the primary never showed up, i.e. if
+ * it is aligned outside the regions.
+ */
+static bool bam2fq_region_loop(bam2fq_state_t *state, bam2fq_opts_t *opts)
+{
+    void *bed = NULL;
+    hts_idx_t *idx = NULL;
+    hts_reglist_t *reglist = NULL;
+    hts_itr_multi_t *iter = NULL;
+    khash_t(seen_read) *seen = kh_init(seen_read);
+    bam1_t *b = NULL, **pend = NULL;
+    int i, r, regcount = 0, filter_op = 1;
+    int64_t n_reads = 0, n_dups = 0, n_sups = 0, n_pend = 0, m_pend = 0;
+    kstring_t linebuf = { 0, 0, NULL };
+    khint_t k;
+    bool valid = false;
+
+    if (opts->fn_bed && (bed = bed_read(opts->fn_bed)) == NULL) {
+        print_error_errno("bam2fq", "Could not read file \"%s\"", opts->fn_bed);
+        goto end;
+    }
+    if (opts->n_regs) bed = bed_hash_regions(bed, opts->regs, 0, opts->n_regs, &filter_op);
+    else bed_unify(bed);
+    if (bed == NULL || (reglist = bed_reglist(bed, filter_op ? ALL : FILTERED, &regcount)) == NULL) {
+        fprintf(stderr, "[bam2fq_region_loop] region list is empty or could not be created\n");
+        goto end;
+    }
+    if ((idx = sam_index_load(state->fp, opts->fn_input)) == NULL) {
+        print_error("bam2fq", "random alignment retrieval only works for indexed BAM or CRAM files");
+        goto end;
+    }
+    iter = sam_itr_regions(idx, state->h, reglist, regcount);
+    reglist = NULL; // owned, and freed on failure, by the iterator
+    if (iter == NULL) {
+        fprintf(stderr, "[bam2fq_region_loop] iterator could not be created\n");
+        goto end;
+    }
+
+    while (true) {
+        if (!b && (b = bam_init1()) == NULL) goto end;
+        if ((r = sam_itr_multi_next(state->fp, iter, b)) < 0) break;
+        if (filter_it_out(b, state) || b->core.l_qseq == 0) continue;
+        ++n_reads;
+
+        readpart rp = which_readpart(b);
+        int absent;
+        k = kh_put(seen_read, seen, bam_get_qname(b), &absent);
+        if (absent < 0) goto end;
+        if (absent) {
+            if ((kh_key(seen, k) = strdup(bam_get_qname(b))) == NULL) {
+                kh_del(seen_read, seen, k);
+                goto end;
+            }
+            kh_val(seen, k).done = 0;
+            kh_val(seen, k).sup[0] = kh_val(seen, k).sup[1] = kh_val(seen, k).sup[2] = -1;
+        }
+        seen_read_t *v = &kh_val(seen, k);
+        if (v->done >> rp & 1) { ++n_dups; continue; }
+
+        if (b->core.flag & BAM_FSUPPLEMENTARY) {
+            if (v->sup[rp] < 0) {
+                if (n_pend == m_pend) {
+                    m_pend = m_pend ? m_pend << 1 : 256;
+                    bam1_t **tmp = realloc(pend, m_pend * sizeof(*pend));
+                    if (!tmp) goto end;
+                    pend = tmp;
+                }
+                v->sup[rp] = n_pend;
+                pend[n_pend++] = b;
+                b = NULL;
+            } else if (pend[v->sup[rp]]->core.l_qseq < b->core.l_qseq) {
+                bam1_t *tmp = pend[v->sup[rp]];
+                pend[v->sup[rp]] = b;
+                b = tmp;
+                ++n_dups;
+            } else ++n_dups;
+            continue;
+        }
+
+        if (!write_fq_record(b, state->fpr[rp], &linebuf, state)) goto end;
+        v->done |= 1 << rp;
+        if (v->sup[rp] >= 0) { // the primary supersedes what was kept aside
+            bam_destroy1(pend[v->sup[rp]]);
+            pend[v->sup[rp]] = NULL;
+            v->sup[rp] = -1;
+            ++n_dups;
+        }
+    }
+    if (r < -1) {
+        fprintf(stderr, "[bam2fq_region_loop] retrieval of region %d failed due to truncated file or corrupt index\n", iter->curr_tid);
+        goto end;
+    }
+
+    for (i = 0; i < n_pend; i++) {
+        if (!pend[i]) continue;
+        if (!write_fq_record(pend[i], state->fpr[which_readpart(pend[i])], &linebuf, state)) goto end;
+        ++n_sups;
+    }
+    fprintf(stderr, "[M::%s] wrote %" PRId64 " reads from supplementary alignments\n", __func__, n_sups);
+    fprintf(stderr, "[M::%s] skipped %" PRId64 " duplicate alignments\n", __func__, n_dups);
+    fprintf(stderr, "[M::%s] processed %" PRId64 " reads\n", __func__, n_reads);
+    valid = true;
+
+ end:
+    if (!valid) perror("[bam2fq_region_loop] Error writing to FASTx files.");
+    for (i = 0; i < n_pend; i++) bam_destroy1(pend[i]);
+    free(pend);
+    bam_destroy1(b);
+    for (k = kh_begin(seen); k != kh_end(seen); ++k)
+        if (kh_exist(seen, k)) free((char*)kh_key(seen, k));
+    kh_destroy(seen_read, seen);
+    free(linebuf.s);
+    if (iter) hts_itr_multi_destroy(iter);
+    hts_reglist_free(reglist, regcount);
+    if (idx) hts_idx_destroy(idx);
+    if (bed) bed_destroy(bed);
+    return valid;
+}
+
 int main_bam2fq(int argc, char *argv[])
 {
     int status = EXIT_SUCCESS;
@@ -1027,7 +1216,15 @@ int main_bam2fq(int argc, char *argv[])
 
     if (!init_state(opts, &state)) return EXIT_FAILURE;
 
-    if (!bam2fq_mainloop(state,opts)) status = EXIT_FAILURE;
+    if (opts->fn_sample && !write_samples(opts->fn_sample, state->h)) status = EXIT_FAILURE;
+
+    if (status == EXIT_SUCCESS) {
+        if (opts->n_regs || opts->fn_bed) {
+            if (!bam2fq_region_loop(state, opts)) status = EXIT_FAILURE;
+        } else {
+            if (!bam2fq_mainloop(state, opts)) status = EXIT_FAILURE;
+        }
+    }
 
     if (!destroy_state(opts, state, &status)) return EXIT_FAILURE;
     sam_global_args_free(&opts->ga);
@@ -2740,6 +2740,8 @@ sub test_bam2fq
     test_cmd($opts, out=>'bam2fq/2.stdout.expected', out_map=>{'o.fq' => 'bam2fq/11.fq.expected'},cmd=>"$$opts{bin}/samtools fastq @$threads -N -o $$opts{path}/o.fq $$opts{path}/dat/bam2fq.001.sam");
     # Read 1/2 output, stdout and discard singletons/other
     test_cmd($opts, out=>'bam2fq/11.fq.expected', cmd=>"$$opts{bin}/samtools fastq @$threads -N -s $out.discard.s.fq -0 $out.discard.0.fq $$opts{path}/dat/bam2fq.001.sam");
+    # Region mode: one record per read, supplementary only if the primary is outside the region
+    test_cmd($opts, out=>'bam2fq/13.fq.expected', out_map=>{'sm.txt' => 'bam2fq/13.sm.expected'}, cmd=>"$$opts{bin}/samtools view -b -o $out.011.bam $$opts{path}/dat/bam2fq.011.sam && $$opts{bin}/samtools index $out.011.bam && $$opts{bin}/samtools fastq @$threads --sample-file $$opts{path}/sm.txt $out.011.bam ref1:1-500");
 }
 
 sub test_depad